@@ -38,20 +38,50 @@
 
 @end
 
-@interface Term (JSON)
+// A Datum that keeps the Foundation value it was made from. The JSON encoder writes the value directly,
+// the protobuf Datum tree is only built if something else (such as the protobuf protocol) asks for it.
+@interface RethinkDBValueDatum : Datum
 
-- (void) toJSON:(NSMutableData*)data;
++ (RethinkDBValueDatum*) datumWithValue:(id)value;
+// How many bytes the JSON for value takes. It is encoded in the calling thread's buffer, see -[Query encodeJSON:].
++ (NSUInteger) encodedLengthOfValue:(id)value;
+
+@property (readonly, strong) id value;
 
 @end
 
-@interface Query (JSON)
+// Stands for a value that is supplied each time a prepared query runs.
+@interface RethinkDBPlaceholder : NSObject
 
-- (NSData*) toJSON;
++ (RethinkDBPlaceholder*) placeholderWithIndex:(NSUInteger)index;
+
+@property (readonly) NSUInteger index;
 
 @end
 
-@interface Response (JSON)
+// A query encoded once, with the offsets of its placeholders, so running it again only encodes the values.
+@interface RethinkDBQueryTemplate : NSObject
+
+- (instancetype) initWithQuery:(Query*)query;
+// Splices the values into a copy of the template in the calling thread's buffer, see -[Query encodeJSON:].
+- (const uint8_t*) encodeWithValues:(NSArray*)values length:(size_t*)length;
+
+@property (readonly) NSUInteger placeholderCount;
+
+@end
 
-+ (Response*) fromJSON:(NSData*)data withToken:(int64_t)token;
+@interface Term (JSON)
+
+- (void) toJSON:(NSMutableData*)data;
+
+@end
+
+@interface Query (JSON)
+
+- (NSData*) toJSON;
+// Encodes into a buffer owned by the calling thread. The bytes are only valid until the thread encodes again.
+- (const uint8_t*) encodeJSON:(size_t*)length;
+// Like encodeJSON: but the query's term is the arena term node, see RethinkDBTermArena.
+- (const uint8_t*) encodeJSONWithNode:(struct rethinkdb_term_node*)node length:(size_t*)length;
 
 @end
@@ -28,286 +28,627 @@
 //
 
 #import "QL2+JSON.h"
+#import "RethinkDBTermArena.h"
+#import <pthread.h>
 
-static void json_encode_string(NSString *string, NSMutableData *data) {
-    char *buffer;
-    NSUInteger length = [string length];
-    unichar *ch = malloc(sizeof(unichar) * length);
-    NSUInteger out_size = 0;
-    NSUInteger out_pos = 0;
+#define INITIAL_WRITER_CAPACITY 4096
+
+// Output buffer reused by every query encoded on a thread, so encoding doesn't allocate once it has grown
+// to fit the largest query. scratch holds a string's UTF-8 bytes while they are escaped into bytes.
+typedef struct {
+    uint8_t *bytes;
+    size_t length;
+    size_t capacity;
+    uint8_t *scratch;
+    size_t scratch_capacity;
+    // set while a template is being encoded, placeholders are recorded here instead of being written
+    __unsafe_unretained NSMutableArray *slots;
+} json_writer;
+
+static pthread_key_t writer_key;
+static pthread_once_t writer_once = PTHREAD_ONCE_INIT;
+
+static void free_writer(void *value) {
+    json_writer *writer = value;
     
-    [string getCharacters: ch];
+    free(writer->bytes);
+    free(writer->scratch);
+    free(writer);
+}
+
+static void create_writer_key(void) {
+    pthread_key_create(&writer_key, free_writer);
+}
+
+static json_writer *thread_writer(void) {
+    pthread_once(&writer_once, create_writer_key);
+    json_writer *writer = pthread_getspecific(writer_key);
     
-    for(NSUInteger i = 0; i < length; i++) {
-        unichar c = ch[i];
-        
-        if(c == '"' || c == '\\' || c == '\b' || c == '\f' || c == '\n' || c == '\r' || c == '\t') {
-            out_size += 2;
-        } else if(c < 32 || c > 127) {
-            out_size += 6;
-        } else {
-            out_size++;
+    if(writer == NULL) {
+        writer = calloc(1, sizeof(json_writer));
+        writer->capacity = INITIAL_WRITER_CAPACITY;
+        writer->bytes = malloc(writer->capacity);
+        pthread_setspecific(writer_key, writer);
+    }
+    writer->length = 0;
+    writer->slots = nil;
+    
+    return writer;
+}
+
+static inline void writer_reserve(json_writer *writer, size_t extra) {
+    if(writer->length + extra > writer->capacity) {
+        size_t capacity = writer->capacity * 2;
+        while(capacity < writer->length + extra) {
+            capacity *= 2;
+        }
+        writer->bytes = realloc(writer->bytes, capacity);
+        writer->capacity = capacity;
+    }
+}
+
+static inline void writer_append(json_writer *writer, const void *bytes, size_t length) {
+    writer_reserve(writer, length);
+    memcpy(writer->bytes + writer->length, bytes, length);
+    writer->length += length;
+}
+
+static inline void writer_append_char(json_writer *writer, uint8_t c) {
+    writer_reserve(writer, 1);
+    writer->bytes[writer->length++] = c;
+}
+
+static void writer_append_integer(json_writer *writer, long long value) {
+    char buffer[24];
+    char *p = buffer + sizeof(buffer);
+    unsigned long long magnitude = value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+    
+    do {
+        *--p = '0' + (magnitude % 10);
+        magnitude /= 10;
+    } while(magnitude);
+    if(value < 0) {
+        *--p = '-';
+    }
+    
+    writer_append(writer, p, buffer + sizeof(buffer) - p);
+}
+
+// Writes the shortest decimal that reads back as exactly the same double.
+static void writer_append_double(json_writer *writer, double value) {
+    char buffer[32];
+    int length;
+    
+    if(!isfinite(value)) {
+        @throw [NSException exceptionWithName: NSInvalidArgumentException reason: @"JSON can't represent NaN or infinity" userInfo: nil];
+    }
+    
+    if(value == trunc(value) && fabs(value) < 9007199254740992.0) {
+        writer_append_integer(writer, (long long)value);
+        return;
+    }
+    
+    for(int precision = 15; precision <= 17; precision++) {
+        length = snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+        if(precision == 17 || strtod(buffer, NULL) == value) {
+            break;
         }
     }
     
-    buffer = malloc(out_size);
-    out_pos = 0;
-    for(NSUInteger i = 0; i < length; i++) {
-        unichar c = ch[i];
+    writer_append(writer, buffer, length);
+}
 
+static const char hex_digits[] = "0123456789abcdef";
+
+// 1 for the bytes that have to be escaped inside a JSON string
+static const uint8_t needs_escape[256] = {
+    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1, 1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+    0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,1,0,0,0,
+};
+
+static void writer_append_escaped(json_writer *writer, const uint8_t *bytes, size_t length) {
+    const uint8_t *end = bytes + length;
+    
+    // worst case every byte becomes a six character \u escape
+    writer_reserve(writer, length * 6 + 2);
+    uint8_t *out = writer->bytes + writer->length;
+    
+    *out++ = '"';
+    while(bytes < end) {
+        const uint8_t *run = bytes;
+        while(bytes < end && !needs_escape[*bytes]) {
+            bytes++;
+        }
+        memcpy(out, run, bytes - run);
+        out += bytes - run;
+        
+        if(bytes == end) {
+            break;
+        }
+        
+        uint8_t c = *bytes++;
+        *out++ = '\\';
         switch (c) {
-            case '"':
-                buffer[out_pos++] = '\\';
-                buffer[out_pos++] = '"';
-                break;
-            case '\\':
-                buffer[out_pos++] = '\\';
-                buffer[out_pos++] = '\\';
-                break;
-            case '\b':
-                buffer[out_pos++] = '\\';
-                buffer[out_pos++] = 'b';
-                break;
-            case '\f':
-                buffer[out_pos++] = '\\';
-                buffer[out_pos++] = 'f';
-                break;
-            case '\n':
-                buffer[out_pos++] = '\\';
-                buffer[out_pos++] = 'n';
-                break;
-            case '\r':
-                buffer[out_pos++] = '\\';
-                buffer[out_pos++] = 'r';
-                break;
-            case '\t':
-                buffer[out_pos++] = '\\';
-                buffer[out_pos++] = 't';
-                break;
-                
+            case '"':  *out++ = '"'; break;
+            case '\\': *out++ = '\\'; break;
+            case '\b': *out++ = 'b'; break;
+            case '\f': *out++ = 'f'; break;
+            case '\n': *out++ = 'n'; break;
+            case '\r': *out++ = 'r'; break;
+            case '\t': *out++ = 't'; break;
             default:
-                if(c < 32 || c > 127) {
-                    sprintf(&buffer[out_pos], "\\u%04x", c);
-                    out_pos += 6;
-                } else {
-                    buffer[out_pos++] = c;
-                }
+                *out++ = 'u';
+                *out++ = '0';
+                *out++ = '0';
+                *out++ = hex_digits[c >> 4];
+                *out++ = hex_digits[c & 0xF];
                 break;
         }
     }
-    free(ch);
-    
-    [data appendBytes: "\"" length: 1];
-    [data appendBytes: buffer length: out_size];
-    [data appendBytes: "\"" length: 1];
+    *out++ = '"';
     
-    free(buffer);
+    writer->length = out - writer->bytes;
 }
 
-@implementation Datum (JSON)
+// Strings go out as raw UTF-8, only quotes, backslashes and control characters are escaped.
+static void writer_append_string(json_writer *writer, NSString *string) {
+    CFStringRef cf_string = (__bridge CFStringRef)string;
+    const char *direct = CFStringGetCStringPtr(cf_string, kCFStringEncodingUTF8);
+    
+    // the direct pointer is only used for plain ASCII, where characters and bytes line up
+    if(direct && strlen(direct) == (size_t)CFStringGetLength(cf_string)) {
+        writer_append_escaped(writer, (const uint8_t*)direct, strlen(direct));
+        return;
+    }
+    
+    CFIndex length = CFStringGetLength(cf_string);
+    size_t max_size = (size_t)length * 3;
+    if(max_size > writer->scratch_capacity) {
+        writer->scratch = realloc(writer->scratch, max_size);
+        writer->scratch_capacity = max_size;
+    }
+    
+    CFIndex used = 0;
+    // unpaired surrogates can't be written as UTF-8, they become '?'
+    CFStringGetBytes(cf_string, CFRangeMake(0, length), kCFStringEncodingUTF8, '?', false, writer->scratch, (CFIndex)max_size, &used);
+    writer_append_escaped(writer, writer->scratch, (size_t)used);
+}
 
-+ (Datum*) datumFromNSObject:(id) object {
-    Datum_Builder* result = [Datum_Builder new];
+// Streams a Foundation value straight to JSON, following the same rules as +[Datum datumFromNSObject:].
+static void writer_append_object(json_writer *writer, id object) {
+    BOOL first = YES;
     
-    if(object == nil || [object isKindOfClass: [NSNull class]]) {
-        result.type = Datum_DatumTypeRNull;
-    } else if([object isKindOfClass: [NSString class]]) {
-        result.type = Datum_DatumTypeRStr;
-        result.rStr = object;
+    if([object isKindOfClass: [NSString class]]) {
+        writer_append_string(writer, object);
+    } else if([object isKindOfClass: [RethinkDBPlaceholder class]]) {
+        if(writer->slots == nil) {
+            @throw [NSException exceptionWithName: NSInvalidArgumentException reason: @"Placeholders can only be used in prepared queries" userInfo: nil];
+        }
+        [writer->slots addObject: [NSValue valueWithRange: NSMakeRange(writer->length, [object index])]];
     } else if([object isKindOfClass: [NSNumber class]]) {
-        NSNumber* num = (NSNumber*)object;
-        
-        if (num == (void*)kCFBooleanFalse || num == (void*)kCFBooleanTrue) {
-            result.type = Datum_DatumTypeRBool;
-            result.rBool = [num boolValue];
+        if(object == (void*)kCFBooleanTrue) {
+            writer_append(writer, "true", 4);
+        } else if(object == (void*)kCFBooleanFalse) {
+            writer_append(writer, "false", 5);
+        } else if(CFNumberIsFloatType((__bridge CFNumberRef)object) || *[object objCType] == 'Q') {
+            writer_append_double(writer, [object doubleValue]);
         } else {
-            result.type = Datum_DatumTypeRNum;
-            result.rNum = [object doubleValue];
+            writer_append_integer(writer, [object longLongValue]);
         }
     } else if([object isKindOfClass: [NSArray class]]) {
-        NSArray* array = (NSArray*)object;
-        result.type = Datum_DatumTypeRArray;
-        for(id obj in array) {
-            [result addRArray: [self datumFromNSObject: obj]];
+        // Term_TermTypeMakeArray
+        writer_append(writer, "[2,[", 4);
+        for (id element in object) {
+            if(first) {
+                first = NO;
+            } else {
+                writer_append_char(writer, ',');
+            }
+            writer_append_object(writer, element);
         }
+        writer_append(writer, "]]", 2);
     } else if([object isKindOfClass: [NSDictionary class]]) {
-        NSDictionary* dict = (NSDictionary*)object;
-        result.type = Datum_DatumTypeRObject;
-        
-        [dict enumerateKeysAndObjectsUsingBlock:^(NSString* key, id obj, BOOL *stop) {
-            Datum_AssocPair_Builder* pair = [Datum_AssocPair_Builder new];
-            pair.key = key;
-            pair.val = [self datumFromNSObject: obj];
-            
-            [result addRObject: [pair build]];
-        }];
+        writer_append_char(writer, '{');
+        for (NSString *key in object) {
+            if(first) {
+                first = NO;
+            } else {
+                writer_append_char(writer, ',');
+            }
+            writer_append_string(writer, key);
+            writer_append_char(writer, ':');
+            writer_append_object(writer, [object objectForKey: key]);
+        }
+        writer_append_char(writer, '}');
+    } else {
+        // nil, NSNull and anything datumFromNSObject: leaves untyped
+        writer_append(writer, "null", 4);
     }
-    return [result build];
 }
 
-- (void) toJSON:(NSMutableData *)data {
-    NSData *tmp;
-    NSNumber *num;
+static void writer_append_datum(json_writer *writer, Datum *datum) {
     BOOL first = YES;
     
-    switch ([self type]) {
+    if([datum isKindOfClass: [RethinkDBValueDatum class]]) {
+        writer_append_object(writer, [(RethinkDBValueDatum*)datum value]);
+        return;
+    }
+    
+    switch ([datum type]) {
         case Datum_DatumTypeRNull:
-            [data appendBytes: "null" length: 4];
+            writer_append(writer, "null", 4);
             break;
             
         case Datum_DatumTypeRBool:
-            if([self rBool]) {
-                [data appendBytes: "true" length: 4];
+            if([datum rBool]) {
+                writer_append(writer, "true", 4);
             } else {
-                [data appendBytes: "false" length: 5];
+                writer_append(writer, "false", 5);
             }
             break;
             
         case Datum_DatumTypeRNum:
-            num = [NSNumber numberWithDouble: [self rNum]];
-            tmp = [[num stringValue] dataUsingEncoding: NSUTF8StringEncoding];
-            [data appendData: tmp];
+            writer_append_double(writer, [datum rNum]);
             break;
-
+            
         case Datum_DatumTypeRStr:
-            json_encode_string([self rStr], data);
+            writer_append_string(writer, [datum rStr]);
             break;
             
         case Datum_DatumTypeRArray:
             // Term_TermTypeMakeArray
-            [data appendBytes: "[2,[" length: 4];
-            for (Term *arg in [self rArray]) {
+            writer_append(writer, "[2,[", 4);
+            for (Datum *element in [datum rArray]) {
                 if(first) {
                     first = NO;
                 } else {
-                    [data appendBytes: "," length: 1];
+                    writer_append_char(writer, ',');
                 }
                 
-                [arg toJSON: data];
+                writer_append_datum(writer, element);
             }
-            [data appendBytes: "]]" length: 2];
+            writer_append(writer, "]]", 2);
             break;
             
         case Datum_DatumTypeRObject:
-            [data appendBytes: "{" length: 1];
-            
-            for (Datum_AssocPair *pair in [self rObject]) {
+            writer_append_char(writer, '{');
+            for (Datum_AssocPair *pair in [datum rObject]) {
                 if(first) {
                     first = NO;
                 } else {
-                    [data appendBytes: "," length: 1];
+                    writer_append_char(writer, ',');
                 }
                 
-                json_encode_string([pair key], data);
-                [data appendBytes: ":" length: 1];
-                [[pair val] toJSON: data];
+                writer_append_string(writer, [pair key]);
+                writer_append_char(writer, ':');
+                writer_append_datum(writer, [pair val]);
             }
-            
-            [data appendBytes: "}" length: 1];
+            writer_append_char(writer, '}');
             break;
 /*
             Datum_DatumTypeRJson = 7,
  */
-
+            
         default:
             @throw @"Unhandled datum type";
             break;
     }
 }
 
-@end
+static void writer_append_term(json_writer *writer, Term *term) {
+    BOOL first = YES;
+    
+    if([term type] == Term_TermTypeDatum) {
+        writer_append_datum(writer, [term datum]);
+        return;
+    }
+    
+    writer_append_char(writer, '[');
+    writer_append_integer(writer, [term type]);
+    writer_append(writer, ",[", 2);
+    for (Term *arg in [term args]) {
+        if(first) {
+            first = NO;
+        } else {
+            writer_append_char(writer, ',');
+        }
+        writer_append_term(writer, arg);
+    }
+    writer_append_char(writer, ']');
+    
+    if([[term optargs] count]) {
+        first = YES;
+        writer_append(writer, ",{", 2);
+        for (Term_AssocPair *pair in [term optargs]) {
+            if(first) {
+                first = NO;
+            } else {
+                writer_append_char(writer, ',');
+            }
+            writer_append_string(writer, [pair key]);
+            writer_append_char(writer, ':');
+            writer_append_term(writer, [pair val]);
+        }
+        writer_append_char(writer, '}');
+    }
+    writer_append_char(writer, ']');
+}
 
-@implementation Term (JSON)
+static void writer_append_node(json_writer *writer, rethinkdb_term_node *node) {
+    if(node->type == 0) {
+        if([node->value isKindOfClass: [Term class]]) {
+            writer_append_term(writer, node->value);
+        } else {
+            writer_append_object(writer, node->value);
+        }
+        return;
+    }
+    
+    writer_append_char(writer, '[');
+    writer_append_integer(writer, node->type);
+    writer_append(writer, ",[", 2);
+    for(uint32_t i = 0; i < node->arg_count; i++) {
+        if(i > 0) {
+            writer_append_char(writer, ',');
+        }
+        writer_append_node(writer, node->args[i]);
+    }
+    writer_append_char(writer, ']');
+    
+    if(node->optarg_count) {
+        writer_append(writer, ",{", 2);
+        for(uint32_t i = 0; i < node->optarg_count; i++) {
+            if(i > 0) {
+                writer_append_char(writer, ',');
+            }
+            writer_append_string(writer, node->optarg_keys[i]);
+            writer_append_char(writer, ':');
+            writer_append_node(writer, node->optarg_values[i]);
+        }
+        writer_append_char(writer, '}');
+    }
+    writer_append_char(writer, ']');
+}
 
-- (void) encodeArguments:(NSMutableData*) data {
+// The term comes from node when it is given, otherwise from the query.
+static void writer_append_query(json_writer *writer, Query *query, rethinkdb_term_node *node) {
     BOOL first = YES;
     
-    [data appendBytes: ",[" length: 2];
-    for (Term *arg in [self args]) {
+    writer_append_char(writer, '[');
+    writer_append_integer(writer, [query type]);
+    if(node == NULL && ![query hasQuery]) {
+        // CONTINUE, STOP and NOREPLY_WAIT carry nothing but their type
+        writer_append_char(writer, ']');
+        return;
+    }
+    writer_append_char(writer, ',');
+    if(node) {
+        writer_append_node(writer, node);
+    } else {
+        writer_append_term(writer, [query query]);
+    }
+    writer_append(writer, ",{", 2);
+    for (Query_AssocPair *pair in [query globalOptargs]) {
         if(first) {
             first = NO;
         } else {
-            [data appendBytes: "," length: 1];
+            writer_append_char(writer, ',');
         }
-        [arg toJSON: data];
+        writer_append_string(writer, [pair key]);
+        writer_append_char(writer, ':');
+        writer_append_term(writer, [pair val]);
     }
-    [data appendBytes: "]" length: 1];
+    writer_append(writer, "}]", 2);
 }
 
-- (void) encodeOptions:(NSMutableData*) data {
+@implementation Datum (JSON)
+
++ (Datum*) datumFromNSObject:(id) object {
+    Datum_Builder* result = [Datum_Builder new];
     
+    if(object == nil || [object isKindOfClass: [NSNull class]]) {
+        result.type = Datum_DatumTypeRNull;
+    } else if([object isKindOfClass: [NSString class]]) {
+        result.type = Datum_DatumTypeRStr;
+        result.rStr = object;
+    } else if([object isKindOfClass: [NSNumber class]]) {
+        NSNumber* num = (NSNumber*)object;
+        
+        if (num == (void*)kCFBooleanFalse || num == (void*)kCFBooleanTrue) {
+            result.type = Datum_DatumTypeRBool;
+            result.rBool = [num boolValue];
+        } else {
+            result.type = Datum_DatumTypeRNum;
+            result.rNum = [object doubleValue];
+        }
+    } else if([object isKindOfClass: [NSArray class]]) {
+        NSArray* array = (NSArray*)object;
+        result.type = Datum_DatumTypeRArray;
+        for(id obj in array) {
+            [result addRArray: [self datumFromNSObject: obj]];
+        }
+    } else if([object isKindOfClass: [NSDictionary class]]) {
+        NSDictionary* dict = (NSDictionary*)object;
+        result.type = Datum_DatumTypeRObject;
+        
+        [dict enumerateKeysAndObjectsUsingBlock:^(NSString* key, id obj, BOOL *stop) {
+            Datum_AssocPair_Builder* pair = [Datum_AssocPair_Builder new];
+            pair.key = key;
+            pair.val = [self datumFromNSObject: obj];
+            
+            [result addRObject: [pair build]];
+        }];
+    }
+    return [result build];
 }
 
 - (void) toJSON:(NSMutableData *)data {
-    char buf[32];
+    json_writer *writer = thread_writer();
+    writer_append_datum(writer, self);
+    [data appendBytes: writer->bytes length: writer->length];
+}
+
+@end
+
+@implementation RethinkDBPlaceholder
+
++ (RethinkDBPlaceholder*) placeholderWithIndex:(NSUInteger)index {
+    RethinkDBPlaceholder *result = [self new];
+    result->_index = index;
     
-    if(type == Term_TermTypeDatum) {
-        [[self datum] toJSON: data];
-    } else {
-        [data appendBytes: "[" length: 1];
-        snprintf(buf, sizeof(buf), "%d", type);
-        [data appendBytes: buf length: strlen(buf)];
-        [self encodeArguments: data];
-        [self encodeOptions: data];
-        [data appendBytes: "]" length: 1];
-    }
+    return result;
 }
 
 @end
 
-@implementation Query (JSON)
+@implementation RethinkDBQueryTemplate {
+    __strong NSData *bytes;
+    // location is the offset of the slot in bytes, length is the index of the value that goes there
+    NSRange *slots;
+    NSUInteger slot_count;
+}
 
-- (void) encodeOptionsAsJson:(NSMutableData*) data {
-    BOOL first = YES;
-    [data appendBytes: "{" length: 1];
-    for (Query_AssocPair *pair in [self globalOptargs]) {
-        if(first) {
-            first = NO;
-        } else {
-            [data appendBytes: "," length: 1];
+- (instancetype) initWithQuery:(Query*)query {
+    self = [super init];
+    if(self) {
+        NSMutableArray *found = [NSMutableArray new];
+        json_writer *writer = thread_writer();
+        
+        writer->slots = found;
+        @try {
+            writer_append_query(writer, query, NULL);
+        } @finally {
+            writer->slots = nil;
         }
+        bytes = [NSData dataWithBytes: writer->bytes length: writer->length];
         
-        json_encode_string([pair key], data);
-        [data appendBytes: ":" length: 1];
-        [[pair val] toJSON: data];
+        slot_count = [found count];
+        slots = malloc(sizeof(NSRange) * MAX(slot_count, 1));
+        for(NSUInteger i = 0; i < slot_count; i++) {
+            slots[i] = [[found objectAtIndex: i] rangeValue];
+            _placeholderCount = MAX(_placeholderCount, slots[i].length + 1);
+        }
     }
-    [data appendBytes: "}" length: 1];
+    
+    return self;
 }
 
-- (NSData*) toJSON {
-    char buf[32];
-    NSMutableData *data = [NSMutableData new];
-
-    [data appendBytes: "[" length: 1];
-    snprintf(buf, sizeof(buf), "%d,", type);
-    [data appendBytes: buf length: strlen(buf)];
-    [[self query] toJSON: data];
-    [data appendBytes: "," length: 1];
-    [self encodeOptionsAsJson: data];
-    [data appendBytes: "]" length: 1];
-
-    return data;
+- (void) dealloc {
+    free(slots);
+}
+
+- (const uint8_t*) encodeWithValues:(NSArray*)values length:(size_t*)length {
+    if([values count] < _placeholderCount) {
+        @throw [NSException exceptionWithName: NSInvalidArgumentException reason: [NSString stringWithFormat: @"The query needs %lu values but only %lu were given", (unsigned long)_placeholderCount, (unsigned long)[values count]] userInfo: nil];
+    }
+    
+    json_writer *writer = thread_writer();
+    const uint8_t *template_bytes = [bytes bytes];
+    size_t position = 0;
+    
+    for(NSUInteger i = 0; i < slot_count; i++) {
+        writer_append(writer, template_bytes + position, slots[i].location - position);
+        writer_append_object(writer, [values objectAtIndex: slots[i].length]);
+        position = slots[i].location;
+    }
+    writer_append(writer, template_bytes + position, [bytes length] - position);
+    *length = writer->length;
+    
+    return writer->bytes;
 }
 
 @end
 
+@implementation RethinkDBValueDatum {
+    __strong Datum *materialized;
+    dispatch_once_t materialize_once;
+}
 
-@implementation Response (JSON)
++ (RethinkDBValueDatum*) datumWithValue:(id)value {
+    RethinkDBValueDatum *result = [self new];
+    result->_value = value;
+    
+    return result;
+}
+
++ (NSUInteger) encodedLengthOfValue:(id)value {
+    json_writer *writer = thread_writer();
+    writer_append_object(writer, value);
+    
+    return writer->length;
+}
 
-+ (Response*) fromJSON:(NSData*)data withToken:(int64_t)token {
-    Response_Builder *b = [Response_Builder new];
-    NSDictionary *json = [NSJSONSerialization JSONObjectWithData: data options: 0 error: nil];
+- (Datum*) materialized {
+    dispatch_once(&materialize_once, ^{
+        materialized = [Datum datumFromNSObject: _value];
+    });
     
-    Response_ResponseType type = [[json objectForKey: @"t"] intValue];
+    return materialized;
+}
+
+// Building a term checks every datum, a Foundation value has no required fields to miss
+- (BOOL) isInitialized {
+    return YES;
+}
+
+// Everything but the JSON encoder sees the Datum tree, built the first time it is asked for
+
+- (BOOL) hasType { return [[self materialized] hasType]; }
+- (Datum_DatumType) type { return [[self materialized] type]; }
+- (BOOL) hasRBool { return [[self materialized] hasRBool]; }
+- (BOOL) rBool { return [[self materialized] rBool]; }
+- (BOOL) hasRNum { return [[self materialized] hasRNum]; }
+- (Float64) rNum { return [[self materialized] rNum]; }
+- (BOOL) hasRStr { return [[self materialized] hasRStr]; }
+- (NSString*) rStr { return [[self materialized] rStr]; }
+- (NSArray*) rArray { return [[self materialized] rArray]; }
+- (Datum*) rArrayAtIndex:(NSUInteger)index { return [[self materialized] rArrayAtIndex: index]; }
+- (NSArray*) rObject { return [[self materialized] rObject]; }
+- (Datum_AssocPair*) rObjectAtIndex:(NSUInteger)index { return [[self materialized] rObjectAtIndex: index]; }
+- (void) writeToCodedOutputStream:(PBCodedOutputStream*)output { [[self materialized] writeToCodedOutputStream: output]; }
+- (int32_t) serializedSize { return [[self materialized] serializedSize]; }
+- (Datum_Builder*) toBuilder { return [[self materialized] toBuilder]; }
+- (void) writeDescriptionTo:(NSMutableString*)output withIndent:(NSString*)indent { [[self materialized] writeDescriptionTo: output withIndent: indent]; }
+- (BOOL) isEqual:(id)other { return [[self materialized] isEqual: other]; }
+- (NSUInteger) hash { return [[self materialized] hash]; }
+
+@end
+
+@implementation Term (JSON)
+
+- (void) toJSON:(NSMutableData *)data {
+    json_writer *writer = thread_writer();
+    writer_append_term(writer, self);
+    [data appendBytes: writer->bytes length: writer->length];
+}
+
+@end
+
+@implementation Query (JSON)
+
+- (const uint8_t*) encodeJSON:(size_t*)length {
+    json_writer *writer = thread_writer();
+    writer_append_query(writer, self, NULL);
+    *length = writer->length;
     
-    [b setToken: token];
-    [b setType: type];
+    return writer->bytes;
+}
+
+- (const uint8_t*) encodeJSONWithNode:(struct rethinkdb_term_node*)node length:(size_t*)length {
+    json_writer *writer = thread_writer();
+    writer_append_query(writer, self, node);
+    *length = writer->length;
     
-    for (id obj in [json objectForKey: @"r"]) {
-        [b addResponse: [Datum datumFromNSObject: obj]];
-    }
+    return writer->bytes;
+}
 
-    return [b build];
+- (NSData*) toJSON {
+    size_t length;
+    const uint8_t *bytes = [self encodeJSON: &length];
+    
+    return [NSData dataWithBytes: bytes length: length];
 }
 
 @end
+
@@ -33,11 +33,47 @@
 #import <ProtocolBuffers/ProtocolBuffers.h>
 #import "Ql2.pb.h"
 
+// the settings new clients and pools start with
+#define DEFAULT_BULK_INSERT_BATCH_SIZE 1000
+#define DEFAULT_BULK_INSERT_BATCH_BYTES (1024 * 1024)
+#define DEFAULT_BULK_INSERT_MAX_IN_FLIGHT 4
+#define DEFAULT_CURSOR_READ_AHEAD 1
+#define DEFAULT_STRING_INTERN_CAPACITY 1024
+#define DEFAULT_SHARED_FEED_BUFFER_SIZE 256
+
+@class RethinkDBResponse;
+
+@interface RethinkDBOperation (Private)
+
+- (id) initWithToken:(int64_t)aToken;
+
+// setting the response finishes the operation
+@property (strong) RethinkDBResponse *response;
+// metrics time stamps, 0 unless the connection collects metrics
+@property (assign) uint64_t sentAt;
+@property (assign) uint64_t receivedAt;
+
+@end
+
 @interface RethinkDbClient (Private) <NSStreamDelegate>
 
 - (instancetype) initWithConnection:(RethinkDbClient*)parent;
 
 - (RethinkDBOperation*) transmitAsync:(Query_Builder*) query;
+- (RethinkDBOperation*) run:(Term*) toRun withQuery:(Query*)query then:(RethinkDbSuccessBlock)success fail:(RethinkDbErrorBlock)error;
+- (BOOL) runNoReply:(Term*) toRun withQuery:(Query*)query error:(NSError**) error;
+- (RethinkDBOperation*) runEncoded:(const uint8_t*)bytes length:(NSUInteger)length then:(RethinkDbSuccessBlock)success fail:(RethinkDbErrorBlock)error;
+// For an encoded query with the noreply option, which the server never answers
+- (BOOL) runEncodedNoReply:(const uint8_t*)bytes length:(NSUInteger)length error:(NSError**)error;
+// Blocks until the query start sent is answered, unless start returns nil because it failed straight away
+- (id) waitFor:(RethinkDBOperation* (^)(RethinkDbSuccessBlock success, RethinkDbErrorBlock fail))start error:(NSError**) error;
+- (NSInteger) nextVariable;
+- (BOOL) encodesJSON;
+// The START query for this client's term, encoded into the calling thread's buffer
+- (const uint8_t*) encodeJSON:(size_t*)length;
+
+- (NSUInteger) inFlightCount;
+- (BOOL) isConnected;
 
 - (void) addCursor:(RethinkDBCursor*)cursor;
 - (void) removeCursor:(RethinkDBCursor*)cursor;
@@ -0,0 +1,513 @@
+//
+//  RethinkDBConnectionPool.m
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright (c) 2026 Daniel Parnell
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import "RethinkDbClient.h"
+#import "RethinkDBClient-Private.h"
+#import "RethinkDBMetrics.h"
+
+#define DEFAULT_HEALTH_CHECK_INTERVAL 5.0
+#define DEFAULT_GROWTH_THRESHOLD 8
+
+static NSString* pool_error = @"RethinkDB Pool Error";
+
+@implementation RethinkDBConnectionPool {
+    NSUInteger minimum_size;
+    NSUInteger maximum_size;
+    NSUInteger next_url;
+    NSInteger variable_number;
+    BOOL growing;
+    BOOL closed;
+    
+    __strong NSArray *urls;
+    // replaced as a whole under the lock, so routing can read it without copying
+    __strong NSArray *connections;
+    __strong NSLock *lock;
+    __strong dispatch_queue_t maintenance_queue;
+    __strong dispatch_source_t health_timer;
+}
+
++ (RethinkDBConnectionPool*) poolWithURLs:(NSArray*)urls minimumSize:(NSUInteger)minimum maximumSize:(NSUInteger)maximum error:(NSError**)error {
+    return [[RethinkDBConnectionPool alloc] initWithURLs: urls minimumSize: minimum maximumSize: maximum error: error];
+}
+
++ (RethinkDBConnectionPool*) poolWithURL:(NSURL*)url minimumSize:(NSUInteger)minimum maximumSize:(NSUInteger)maximum error:(NSError**)error {
+    return [self poolWithURLs: [NSArray arrayWithObject: url] minimumSize: minimum maximumSize: maximum error: error];
+}
+
+- (id) initWithURLs:(NSArray*)someURLs minimumSize:(NSUInteger)minimum maximumSize:(NSUInteger)maximum error:(NSError**)error {
+    self = [super init];
+    
+    if(self) {
+        if([someURLs count] == 0) {
+            if(error) *error = [NSError errorWithDomain: pool_error code: NSURLErrorBadURL userInfo: [NSDictionary dictionaryWithObject: @"At least one URL is required" forKey: NSLocalizedDescriptionKey]];
+            return nil;
+        }
+        
+        urls = [someURLs copy];
+        minimum_size = MAX(minimum, 1);
+        maximum_size = MAX(maximum, minimum_size);
+        _growthThreshold = DEFAULT_GROWTH_THRESHOLD;
+        // bulk inserts are chunked by the pool itself, each batch goes to whichever connection is least loaded
+        self.bulkInsertBatchSize = DEFAULT_BULK_INSERT_BATCH_SIZE;
+        self.bulkInsertBatchBytes = DEFAULT_BULK_INSERT_BATCH_BYTES;
+        self.bulkInsertMaxInFlight = DEFAULT_BULK_INSERT_MAX_IN_FLIGHT;
+        self.cursorReadAhead = DEFAULT_CURSOR_READ_AHEAD;
+        self.stringInternCapacity = DEFAULT_STRING_INTERN_CAPACITY;
+        self.sharedFeedBufferSize = DEFAULT_SHARED_FEED_BUFFER_SIZE;
+        lock = [NSLock new];
+        connections = [NSArray array];
+        maintenance_queue = dispatch_queue_create("RethinkDB connection pool", DISPATCH_QUEUE_SERIAL);
+        
+        NSError *last_error = nil;
+        [self fillToMinimum: &last_error];
+        if([connections count] == 0) {
+            if(error) *error = last_error;
+            return nil;
+        }
+        
+        self.healthCheckInterval = DEFAULT_HEALTH_CHECK_INTERVAL;
+    }
+    
+    return self;
+}
+
+- (void)dealloc
+{
+    if(health_timer) {
+        dispatch_source_cancel(health_timer);
+    }
+}
+
+#pragma mark -
+#pragma mark Connection management
+
+- (RethinkDbClient*) openConnection:(NSError**)error {
+    NSURL *url;
+    
+    [lock lock];
+    url = [urls objectAtIndex: next_url++ % [urls count]];
+    [lock unlock];
+    
+    return [RethinkDbClient clientWithURL: url andError: error];
+}
+
+- (void) addConnection:(RethinkDbClient*)client {
+    // cursors are created by the connection that receives them
+    client.cursorReadAhead = self.cursorReadAhead;
+    client.rowMode = self.rowMode;
+    client.stringInternCapacity = self.stringInternCapacity;
+    if(self.collectsMetrics) {
+        client.collectsMetrics = YES;
+    }
+    
+    [lock lock];
+    connections = [connections arrayByAddingObject: client];
+    [lock unlock];
+}
+
+- (void) fillToMinimum:(NSError**)error {
+    // try each node once per missing connection before giving up
+    NSUInteger attempts = (minimum_size - MIN([self size], minimum_size)) * [urls count];
+    
+    while([self size] < minimum_size && attempts-- > 0 && !closed) {
+        RethinkDbClient *client = [self openConnection: error];
+        if(client) {
+            [self addConnection: client];
+        }
+    }
+}
+
+- (void) checkHealth {
+    NSMutableArray *alive = [NSMutableArray array];
+    NSMutableArray *dead = [NSMutableArray array];
+    
+    [lock lock];
+    for (RethinkDbClient *client in connections) {
+        if([client isConnected]) {
+            [alive addObject: client];
+        } else {
+            [dead addObject: client];
+        }
+    }
+    connections = [alive copy];
+    [lock unlock];
+    
+    // closing fails the queries still waiting on a dead connection, rather than leaving their callers hanging
+    for (RethinkDbClient *client in dead) {
+        [client close: nil];
+    }
+    
+    [self fillToMinimum: nil];
+}
+
+- (void) grow {
+    [lock lock];
+    BOOL can_grow = !growing && !closed && [connections count] < maximum_size;
+    if(can_grow) {
+        growing = YES;
+    }
+    [lock unlock];
+    
+    if(can_grow) {
+        dispatch_async(maintenance_queue, ^{
+            RethinkDbClient *client = [self openConnection: nil];
+            if(client) {
+                [self addConnection: client];
+            }
+            
+            [lock lock];
+            growing = NO;
+            [lock unlock];
+        });
+    }
+}
+
+- (RethinkDbClient*) leastLoadedConnection {
+    RethinkDbClient *best = nil;
+    NSUInteger best_load = NSUIntegerMax;
+    NSArray *current;
+    
+    [lock lock];
+    current = connections;
+    [lock unlock];
+    
+    for (RethinkDbClient *client in current) {
+        NSUInteger load = [client inFlightCount];
+        if(load < best_load && [client isConnected]) {
+            best = client;
+            best_load = load;
+            if(load == 0) {
+                break;
+            }
+        }
+    }
+    
+    if(best == nil || best_load >= _growthThreshold) {
+        [self grow];
+    }
+    
+    return best;
+}
+
+// Any live connection, for questions about the pool that should not open new connections as a side effect.
+- (RethinkDbClient*) connectedConnection {
+    NSArray *current;
+    
+    [lock lock];
+    current = connections;
+    [lock unlock];
+    
+    for (RethinkDbClient *client in current) {
+        if([client isConnected]) {
+            return client;
+        }
+    }
+    
+    return nil;
+}
+
+#pragma mark -
+#pragma mark Properties
+
+- (NSUInteger) size {
+    NSUInteger result;
+    
+    [lock lock];
+    result = [connections count];
+    [lock unlock];
+    
+    return result;
+}
+
+- (void) setHealthCheckInterval:(NSTimeInterval)interval {
+    _healthCheckInterval = interval;
+    
+    if(health_timer) {
+        dispatch_source_cancel(health_timer);
+        health_timer = nil;
+    }
+    
+    if(interval > 0) {
+        __weak RethinkDBConnectionPool *weak_self = self;
+        uint64_t nanos = (uint64_t)(interval * NSEC_PER_SEC);
+        
+        health_timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, maintenance_queue);
+        dispatch_source_set_timer(health_timer, dispatch_time(DISPATCH_TIME_NOW, nanos), nanos, nanos / 10);
+        dispatch_source_set_event_handler(health_timer, ^{
+            [weak_self checkHealth];
+        });
+        dispatch_resume(health_timer);
+    }
+}
+
+- (void) setCursorReadAhead:(NSUInteger)cursorReadAhead {
+    [super setCursorReadAhead: cursorReadAhead];
+    
+    [lock lock];
+    NSArray *current = connections;
+    [lock unlock];
+    
+    for (RethinkDbClient *client in current) {
+        client.cursorReadAhead = cursorReadAhead;
+    }
+}
+
+- (void) setRowMode:(RethinkDBRowMode)rowMode {
+    [super setRowMode: rowMode];
+    
+    [lock lock];
+    NSArray *current = connections;
+    [lock unlock];
+    
+    for (RethinkDbClient *client in current) {
+        client.rowMode = rowMode;
+    }
+}
+
+- (void) setStringInternCapacity:(NSUInteger)stringInternCapacity {
+    [super setStringInternCapacity: stringInternCapacity];
+    
+    [lock lock];
+    NSArray *current = connections;
+    [lock unlock];
+    
+    for (RethinkDbClient *client in current) {
+        client.stringInternCapacity = stringInternCapacity;
+    }
+}
+
+- (uint64_t) internedStringHits {
+    uint64_t result = 0;
+    NSArray *current;
+    
+    [lock lock];
+    current = connections;
+    [lock unlock];
+    
+    for (RethinkDbClient *client in current) {
+        result += client.internedStringHits;
+    }
+    
+    return result;
+}
+
+- (uint64_t) internedStringMisses {
+    uint64_t result = 0;
+    NSArray *current;
+    
+    [lock lock];
+    current = connections;
+    [lock unlock];
+    
+    for (RethinkDbClient *client in current) {
+        result += client.internedStringMisses;
+    }
+    
+    return result;
+}
+
+- (void) setCollectsMetrics:(BOOL)collectsMetrics {
+    [super setCollectsMetrics: collectsMetrics];
+    
+    [lock lock];
+    NSArray *current = connections;
+    [lock unlock];
+    
+    for (RethinkDbClient *client in current) {
+        client.collectsMetrics = collectsMetrics;
+    }
+}
+
+// The pool's own snapshot only holds what is timed before a connection is picked, such as encoding arena queries.
+- (RethinkDBMetrics*) metrics {
+    RethinkDBMetrics *result = [super metrics];
+    if(result == nil) {
+        return nil;
+    }
+    
+    [lock lock];
+    NSArray *current = connections;
+    [lock unlock];
+    
+    for (RethinkDbClient *client in current) {
+        RethinkDBMetrics *connection_metrics = [client metrics];
+        if(connection_metrics) {
+            [result addMetrics: connection_metrics];
+        }
+    }
+    
+    return result;
+}
+
+- (void) resetMetrics {
+    [super resetMetrics];
+    
+    [lock lock];
+    NSArray *current = connections;
+    [lock unlock];
+    
+    for (RethinkDbClient *client in current) {
+        [client resetMetrics];
+    }
+}
+
+#pragma mark -
+#pragma mark RethinkDbClient overrides
+
+- (NSInteger) nextVariable {
+    [lock lock];
+    NSInteger result = variable_number++;
+    [lock unlock];
+    
+    return result;
+}
+
+- (NSUInteger) inFlightCount {
+    NSUInteger result = 0;
+    NSArray *current;
+    
+    [lock lock];
+    current = connections;
+    [lock unlock];
+    
+    for (RethinkDbClient *client in current) {
+        result += [client inFlightCount];
+    }
+    
+    return result;
+}
+
+- (BOOL) isConnected {
+    return [self connectedConnection] != nil;
+}
+
+- (BOOL) encodesJSON {
+    RethinkDbClient *client = [self connectedConnection];
+    
+    return client != nil && [client encodesJSON];
+}
+
+- (NSError*) noConnectionsError {
+    return [NSError errorWithDomain: pool_error code: NSURLErrorNotConnectedToInternet userInfo: [NSDictionary dictionaryWithObject: @"no connections available" forKey: NSLocalizedDescriptionKey]];
+}
+
+- (RethinkDBOperation*) run:(Term*) toRun withQuery:(Query*)query then:(RethinkDbSuccessBlock)success fail:(RethinkDbErrorBlock)error {
+    RethinkDbClient *client = [self leastLoadedConnection];
+    
+    if(client == nil) {
+        if(error) {
+            error([self noConnectionsError]);
+        }
+        return nil;
+    }
+    
+    return [client run: toRun withQuery: query then: success fail: error];
+}
+
+- (RethinkDBOperation*) runEncoded:(const uint8_t*)bytes length:(NSUInteger)length then:(RethinkDbSuccessBlock)success fail:(RethinkDbErrorBlock)error {
+    RethinkDbClient *client = [self leastLoadedConnection];
+    
+    if(client == nil) {
+        if(error) {
+            error([self noConnectionsError]);
+        }
+        return nil;
+    }
+    
+    return [client runEncoded: bytes length: length then: success fail: error];
+}
+
+- (BOOL) runEncodedNoReply:(const uint8_t*)bytes length:(NSUInteger)length error:(NSError**)error {
+    RethinkDbClient *client = [self leastLoadedConnection];
+    
+    if(client == nil) {
+        if(error) *error = [self noConnectionsError];
+        return NO;
+    }
+    
+    return [client runEncodedNoReply: bytes length: length error: error];
+}
+
+- (BOOL) runNoReply:(Term*) toRun withQuery:(Query*)query error:(NSError**) error {
+    RethinkDbClient *client = [self leastLoadedConnection];
+    
+    if(client == nil) {
+        if(error) *error = [self noConnectionsError];
+        return NO;
+    }
+    
+    return [client runNoReply: toRun withQuery: query error: error];
+}
+
+- (BOOL) noreplyWait:(NSError**)error {
+    NSArray *current;
+    
+    [lock lock];
+    current = connections;
+    [lock unlock];
+    
+    // noreply queries may have gone out on any connection
+    for (RethinkDbClient *client in current) {
+        if([client isConnected] && ![client noreplyWait: error]) {
+            return NO;
+        }
+    }
+    
+    return YES;
+}
+
+- (BOOL) startCaptureToFile:(NSString*)path bufferSize:(NSUInteger)bufferSize error:(NSError**)error {
+    if(error) *error = [NSError errorWithDomain: pool_error code: -1 userInfo: [NSDictionary dictionaryWithObject: @"Connection pools can not be captured" forKey: NSLocalizedDescriptionKey]];
+    return NO;
+}
+
+- (BOOL) close:(NSError**)error {
+    NSArray *current;
+    
+    [lock lock];
+    closed = YES;
+    current = connections;
+    connections = [NSArray array];
+    [lock unlock];
+    
+    if(health_timer) {
+        dispatch_source_cancel(health_timer);
+        health_timer = nil;
+    }
+    
+    BOOL result = YES;
+    for (RethinkDbClient *client in current) {
+        result = [client close: error] && result;
+    }
+    
+    return result;
+}
+
+@end
@@ -33,14 +33,30 @@
 #include "RethinkDbClient.h"
 #import <ProtocolBuffers/ProtocolBuffers.h>
 #import "Ql2.pb.h"
+#import "RethinkDBResponse.h"
 
 @interface RethinkDBCursor (Private)
 
 - (instancetype)initWithClient:(RethinkDbClient*)aClient andToken:(int64_t)aToken;
 - (BOOL) fetchNextBatch;
 - (void) handleBatch;
+- (void) receiveResponse:(RethinkDBResponse*)response;
+- (NSArray*) takeBatch:(NSError**)error;
+- (void) startConsuming;
+- (void) stopConsuming;
+- (void) lockQueue;
+- (void) unlockQueue;
 
-@property (strong) Response *response;
+// how a subclass keeps the batches waiting for the consumer, always called with the queue locked
+- (void) queueBatch:(NSArray*)rows;
+- (NSArray*) dequeueBatch;
+- (NSUInteger) queuedBatchCount;
+- (void) clearQueuedBatches;
+
+// roughly how many bytes of responses are waiting in the queue
+- (NSUInteger) bufferedBytes;
+
+@property (strong) RethinkDBResponse *response;
 @property (strong) NSArray *rows;
 
 @end
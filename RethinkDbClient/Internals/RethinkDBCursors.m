@@ -33,12 +33,21 @@
 
 @implementation RethinkDBCursor {
     __weak RethinkDbClient *client;
-    __strong Response *_response;
+    __strong RethinkDBResponse *_response;
     __strong NSArray *_rows;
     RethinkDbCursorValueBlock on_row;
     RethinkDbErrorBlock on_error;
     
-    NSUInteger index;
+    // batches that have arrived but have not been handed to the consumer yet
+    __strong NSMutableArray *batches;
+    __strong NSCondition *lock;
+    __strong NSError *failure;
+    NSUInteger buffered_bytes;
+    BOOL continue_outstanding;
+    BOOL complete;
+    BOOL consuming;
+    BOOL processing;
+    BOOL stopped;
 }
 
 - (instancetype)initWithClient:(RethinkDbClient*)aClient andToken:(int64_t)aToken
@@ -47,7 +56,9 @@
     if (self) {
         client = aClient;
         _token = aToken;
-        index = 0;
+        _readAhead = aClient.cursorReadAhead;
+        batches = [NSMutableArray new];
+        lock = [NSCondition new];
     }
     return self;
 }
@@ -63,11 +74,11 @@
     _rows = rows;
 }
 
-- (Response*) response {
+- (RethinkDBResponse*) response {
     return _response;
 }
 
-- (void) setResponse:(Response *)response {
+- (void) setResponse:(RethinkDBResponse *)response {
     _response = response;
 }
 
@@ -79,17 +90,117 @@
     // do nothing
 }
 
+// Must be called with the lock held. With a read ahead of N the cursor holds at most N + 1 batches:
+// the one being processed plus N waiting, counting the one the outstanding CONTINUE will bring back.
+- (BOOL) shouldFetchNextBatch {
+    if(complete || stopped || continue_outstanding || failure) {
+        return NO;
+    }
+    
+    return [self queuedBatchCount] + (processing ? 1 : 0) < _readAhead + 1;
+}
+
+// The batches waiting for the consumer, subclasses can keep them differently. Called with the lock held.
+- (void) queueBatch:(NSArray*)rows {
+    [batches addObject: rows];
+}
+
+- (NSArray*) dequeueBatch {
+    NSArray *batch = [batches firstObject];
+    
+    if(batch) {
+        [batches removeObjectAtIndex: 0];
+    }
+    
+    return batch;
+}
+
+// how many batches count towards the read ahead
+- (NSUInteger) queuedBatchCount {
+    return [batches count];
+}
+
+- (void) clearQueuedBatches {
+    [batches removeAllObjects];
+}
+
+// Takes the next batch off the queue along with its share of the buffered bytes. Subclasses may split and
+// merge batches, so the bytes are only tracked per response and shared out evenly.
+- (NSArray*) nextQueuedBatch {
+    NSUInteger waiting = [self queuedBatchCount];
+    NSArray *batch = [self dequeueBatch];
+    
+    if(batch) {
+        buffered_bytes -= waiting > 1 ? buffered_bytes / waiting : buffered_bytes;
+    }
+    
+    return batch;
+}
+
+- (void) forgetQueuedBatches {
+    [self clearQueuedBatches];
+    buffered_bytes = 0;
+}
+
+- (NSUInteger) bufferedBytes {
+    [lock lock];
+    NSUInteger result = buffered_bytes;
+    [lock unlock];
+    
+    return result;
+}
+
+- (void) sendStop {
+    Query_Builder *qb = [Query_Builder new];
+    qb.token = self.token;
+    qb.type = Query_QueryTypeStop;
+    [client transmitAsync: qb];
+}
+
 - (BOOL) fetchNextBatch {
-    if(self.response.type == Response_ResponseTypeSuccessPartial) {
+    [lock lock];
+    BOOL fetch = [self shouldFetchNextBatch];
+    if(fetch) {
+        continue_outstanding = YES;
+    }
+    [lock unlock];
+    
+    if(fetch) {
         Query_Builder *qb = [Query_Builder new];
         qb.token = self.token;
         qb.type = Query_QueryTypeContinue;
         [client transmitAsync: qb];
-        
-        return YES;
     }
     
-    return NO;
+    return fetch;
+}
+
+- (void) receiveResponse:(RethinkDBResponse*)response {
+    BOOL drain;
+    
+    [lock lock];
+    self.response = response;
+    continue_outstanding = NO;
+    
+    if([response isError]) {
+        NSString* message = [response.results firstObject];
+        failure = [NSError errorWithDomain: @"rethinkdb" code: response.type userInfo: [NSDictionary dictionaryWithObject: message ? message : @"Cursor failed" forKey: NSLocalizedDescriptionKey]];
+        complete = YES;
+    } else {
+        [self queueBatch: response.results];
+        buffered_bytes += response.length;
+        complete = response.type != Response_ResponseTypeSuccessPartial;
+    }
+    drain = consuming && !processing;
+    [lock broadcast];
+    [lock unlock];
+    
+    // ask for the next batch straight away, the server can produce it while this one is processed
+    [self fetchNextBatch];
+    
+    if(drain) {
+        [self scheduleDrain];
+    }
 }
 
 - (BOOL) processBatch:(NSArray*) to_process {
@@ -108,21 +219,115 @@
     return continue_cursor;
 }
 
-- (void) handleBatch {
-    Response *resp = self.response;
+- (void) scheduleDrain {
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        [self handleBatch];
+    });
+}
 
-    if(resp) {
-        BOOL continue_cursor = [self processBatch: self.rows];
+- (void) handleBatch {
+    NSArray *batch;
+    BOOL stopped_here = NO;
+    
+    [lock lock];
+    if(processing || stopped || !consuming) {
+        [lock unlock];
+        return;
+    }
+    processing = YES;
+    
+    while(consuming && !stopped && (batch = [self nextQueuedBatch])) {
+        self.rows = batch;
+        [lock unlock];
         
-        if(continue_cursor) {
-            if(![self fetchNextBatch]) {
-                [self finished];
-                [client removeCursor: self];
+        // taking a batch off the queue may have made room for another one
+        [self fetchNextBatch];
+        BOOL continue_cursor = [self processBatch: batch];
+        
+        [lock lock];
+        if(!continue_cursor) {
+            stopped = YES;
+            stopped_here = !complete;
+            [self forgetQueuedBatches];
+        }
+    }
+    processing = NO;
+    
+    BOOL done = (complete && consuming) || stopped;
+    NSError *error = stopped ? nil : failure;
+    [lock unlock];
+    
+    if(done) {
+        if(stopped_here) {
+            // the consumer has had enough, so the server can stop producing rows
+            [self sendStop];
+        }
+        [client removeCursor: self];
+        if(error) {
+            if(on_error) {
+                on_error(error);
             }
+        } else if(!stopped) {
+            [self finished];
         }
     } else {
-        @throw [NSException exceptionWithName: @"rethinkdb" reason: @"Unexpected batch" userInfo: nil];
+        [self fetchNextBatch];
+    }
+}
+
+// Hands the next batch to a pulling consumer, waiting for it if it has not arrived yet. The batch counts as
+// being processed until the consumer asks for another, so the cursor never holds more than readAhead + 1.
+- (NSArray*) takeBatch:(NSError**)error {
+    NSArray *batch = nil;
+    
+    [lock lock];
+    processing = NO;
+    [lock unlock];
+    [self fetchNextBatch];
+    
+    [lock lock];
+    while(!stopped && (batch = [self nextQueuedBatch]) == nil && !complete) {
+        [lock wait];
     }
+    if(batch) {
+        processing = YES;
+    }
+    NSError *batch_error = stopped ? nil : failure;
+    [lock unlock];
+    
+    if(batch) {
+        [self fetchNextBatch];
+        return batch;
+    }
+    
+    [client removeCursor: self];
+    if(batch_error && error) {
+        *error = batch_error;
+    }
+    
+    return nil;
+}
+
+- (void) startConsuming {
+    [lock lock];
+    consuming = YES;
+    [lock unlock];
+    
+    [self scheduleDrain];
+}
+
+- (void) stopConsuming {
+    [lock lock];
+    consuming = NO;
+    [lock unlock];
+}
+
+- (void) lockQueue {
+    [lock lock];
+}
+
+- (void) unlockQueue {
+    [lock unlock];
 }
 
 #pragma mark -
@@ -132,16 +337,20 @@
     on_row = row;
     on_error = error;
     
-    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
-        [self handleBatch];
-    });
+    [self startConsuming];
 }
 
 - (void) close {
-    Query_Builder *qb = [Query_Builder new];
-    qb.token = self.token;
-    qb.type = Query_QueryTypeStop;
-    [client transmitAsync: qb];
+    [lock lock];
+    BOOL was_complete = complete;
+    stopped = YES;
+    [self forgetQueuedBatches];
+    [lock broadcast];
+    [lock unlock];
+    
+    if(!was_complete) {
+        [self sendStop];
+    }
     [client removeCursor: self];
 }
 
@@ -150,12 +359,24 @@
 #pragma mark -
 #pragma mark RethinkDBSequenceCursor
 
-typedef BOOL (^BatchBlock)(NSArray *rows);
-
-
 @implementation RethinkDBSequenceCursor {
     RethinkDbDoneBlock on_done;
-    BatchBlock on_batch;
+    RethinkDbBatchBlock on_batch;
+    
+    // the batch the pull interface is reading from, only touched by the consumer
+    __strong NSArray *pull_batch;
+    NSUInteger pull_index;
+    // next:fail: pulls on this, so calls made one after another can't both be reading the batch at once
+    dispatch_queue_t pull_queue;
+}
+
+- (instancetype)initWithClient:(RethinkDbClient*)aClient andToken:(int64_t)aToken
+{
+    self = [super initWithClient: aClient andToken: aToken];
+    if (self) {
+        pull_queue = dispatch_queue_create("RethinkDB cursor next", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
 }
 
 - (BOOL) processBatch:(NSArray*) to_process {
@@ -177,10 +398,168 @@ typedef BOOL (^BatchBlock)(NSArray *rows);
     [self each: row fail: error];
 }
 
+// Fans the rows of each batch out to a worker pool of the given size. The drain loop only waits for a free
+// worker, so CONTINUE keeps being sent while the workers are busy. Results are handed to row on a serial
+// queue; when ordered, results that finish early wait in a reorder buffer and a worker is only freed once its
+// result has been delivered, so the buffer never holds more than concurrency results.
+- (void) map:(RethinkDbCursorMapBlock)work concurrency:(NSUInteger)concurrency ordered:(BOOL)ordered each:(RethinkDbCursorValueBlock)row done:(RethinkDbDoneBlock) done fail:(RethinkDbErrorBlock) error {
+    dispatch_queue_t workers = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+    dispatch_queue_t delivery = dispatch_queue_create("RethinkDB cursor delivery", DISPATCH_QUEUE_SERIAL);
+    dispatch_semaphore_t slots = dispatch_semaphore_create(MAX(concurrency, 1));
+    dispatch_group_t in_flight = dispatch_group_create();
+    NSMutableDictionary *reorder = [NSMutableDictionary new];
+    // stands in for nil results, which can't go in the reorder buffer
+    NSObject *no_result = [NSObject new];
+    __block uint64_t next_sequence = 0;
+    __block uint64_t next_delivery = 0;
+    // only changed on the delivery queue, the drain loop just stops sending rows once it is set
+    __block volatile BOOL stop = NO;
+    
+    void (^deliver)(id) = ^(id result) {
+        if(!stop && row && !row(result == no_result ? nil : result)) {
+            stop = YES;
+        }
+        dispatch_semaphore_signal(slots);
+        dispatch_group_leave(in_flight);
+    };
+    
+    on_batch = ^BOOL(NSArray *rows) {
+        for(id value in rows) {
+            dispatch_semaphore_wait(slots, DISPATCH_TIME_FOREVER);
+            if(stop) {
+                dispatch_semaphore_signal(slots);
+                return NO;
+            }
+            
+            uint64_t sequence = next_sequence++;
+            dispatch_group_enter(in_flight);
+            dispatch_async(workers, ^{
+                id result = work(value);
+                if(result == nil) {
+                    result = no_result;
+                }
+                
+                dispatch_async(delivery, ^{
+                    if(!ordered) {
+                        deliver(result);
+                        return;
+                    }
+                    
+                    [reorder setObject: result forKey: [NSNumber numberWithUnsignedLongLong: sequence]];
+                    id next;
+                    while((next = [reorder objectForKey: [NSNumber numberWithUnsignedLongLong: next_delivery]])) {
+                        [reorder removeObjectForKey: [NSNumber numberWithUnsignedLongLong: next_delivery]];
+                        next_delivery++;
+                        deliver(next);
+                    }
+                });
+            });
+        }
+        
+        return !stop;
+    };
+    
+    // done and fail wait for the rows that are still being worked on
+    on_done = ^{
+        dispatch_group_notify(in_flight, delivery, ^{
+            if(done) {
+                done();
+            }
+        });
+    };
+    [self setOnError:^(NSError *err) {
+        dispatch_group_notify(in_flight, delivery, ^{
+            if(error) {
+                error(err);
+            }
+        });
+    }];
+    [self startConsuming];
+}
+
+- (void) each:(RethinkDbCursorValueBlock)row concurrency:(NSUInteger)concurrency ordered:(BOOL)ordered done:(RethinkDbDoneBlock) done fail:(RethinkDbErrorBlock) error {
+    [self map:^id(id value) {
+        return [NSNumber numberWithBool: row(value)];
+    } concurrency: concurrency ordered: ordered each:^BOOL(NSNumber *keep_going) {
+        return [keep_going boolValue];
+    } done: done fail: error];
+}
+
+- (void) eachBatch:(RethinkDbBatchBlock)batch done:(RethinkDbDoneBlock) done fail:(RethinkDbErrorBlock) error {
+    on_batch = batch;
+    on_done = done;
+    [self setOnError: error];
+    [self startConsuming];
+}
+
 - (void) next:(RethinkDbCursorValueBlock)success fail:(RethinkDbErrorBlock) error {
-    if(error) {
-        error([NSError errorWithDomain: @"rethinkdb" code: 0 userInfo: [NSDictionary dictionaryWithObject: @"Not yet implemented" forKey: NSLocalizedDescriptionKey]]);
+    dispatch_async(pull_queue, ^{
+        NSError *failure = nil;
+        id row = [self nextRow: &failure];
+        
+        if(failure) {
+            if(error) {
+                error(failure);
+            }
+        } else if(success && !success(row) && row) {
+            [self close];
+        }
+    });
+}
+
+- (id) nextRow:(NSError**)error {
+    while(pull_index >= [pull_batch count]) {
+        pull_batch = [self takeBatch: error];
+        pull_index = 0;
+        
+        if(pull_batch == nil) {
+            return nil;
+        }
+    }
+    
+    return [pull_batch objectAtIndex: pull_index++];
+}
+
+- (NSArray*) nextBatch:(NSError**)error {
+    NSArray *batch;
+    
+    if(pull_index < [pull_batch count]) {
+        // what is left of the batch nextRow: was reading
+        batch = pull_index == 0 ? pull_batch : [pull_batch subarrayWithRange: NSMakeRange(pull_index, [pull_batch count] - pull_index)];
+    } else {
+        batch = [self takeBatch: error];
     }
+    pull_batch = batch;
+    pull_index = [batch count];
+    
+    return batch;
+}
+
+- (NSUInteger) countByEnumeratingWithState:(NSFastEnumerationState *)state objects:(id __unsafe_unretained [])buffer count:(NSUInteger)len {
+    NSUInteger count = 0;
+    
+    if(state->state == 0) {
+        // rows only ever come off the cursor, there is nothing that can mutate
+        state->mutationsPtr = &state->extra[0];
+        state->state = 1;
+    }
+    
+    while(pull_index >= [pull_batch count]) {
+        NSError *failure = nil;
+        pull_batch = [self takeBatch: &failure];
+        pull_index = 0;
+        
+        if(pull_batch == nil) {
+            _enumerationError = failure;
+            return 0;
+        }
+    }
+    while(count < len && pull_index < [pull_batch count]) {
+        buffer[count++] = [pull_batch objectAtIndex: pull_index++];
+    }
+    state->itemsPtr = buffer;
+    
+    return count;
 }
 
 - (void) toArrayThen:(RethinkDbArrayBlock)success fail:(RethinkDbErrorBlock) error {
@@ -198,27 +577,26 @@ typedef BOOL (^BatchBlock)(NSArray *rows);
     }
     
     [self setOnError: error];
-    [self handleBatch];
-    [self fetchNextBatch];
+    [self startConsuming];
 }
 
 - (NSArray*) toArray:(NSError**)error {
     __block NSArray *result = nil;
-    __block BOOL done = NO;
+    __block NSError *failure = nil;
+    dispatch_semaphore_t done = dispatch_semaphore_create(0);
     
     [self toArrayThen:^(NSArray *array) {
         result = array;
-        done = YES;
+        dispatch_semaphore_signal(done);
     } fail:^(NSError *an_error) {
-        if(error) {
-            *error = an_error;
-        }
-        
-        done = YES;
+        failure = an_error;
+        dispatch_semaphore_signal(done);
     }];
     
-    while(!done) {
-        [[NSRunLoop currentRunLoop] runUntilDate: [NSDate date]];
+    dispatch_semaphore_wait(done, DISPATCH_TIME_FOREVER);
+    
+    if(failure && error) {
+        *error = failure;
     }
     
     return result;
@@ -229,9 +607,221 @@ typedef BOOL (^BatchBlock)(NSArray *rows);
 #pragma mark -
 #pragma mark RethinkDBChangeFeed
 
-@implementation RethinkDBChangeFeed
+#define DEFAULT_MAXIMUM_PENDING_CHANGES 1000
+
+@interface RethinkDBChangeFeed ()
+
+@property (strong) NSString *state;
 
+@end
+
+@implementation RethinkDBChangeFeed {
+    // changes waiting for the consumer in the order they arrived, guarded by the cursor's lock
+    __strong NSMutableArray *pending;
+    // the latest pending change for each primary key
+    __strong NSMutableDictionary *pending_by_key;
+    // how many of the pending entries are include_states markers rather than changes
+    NSUInteger pending_states;
+    uint64_t dropped;
+}
+
+- (instancetype)initWithClient:(RethinkDbClient*)aClient andToken:(int64_t)aToken
+{
+    self = [super initWithClient: aClient andToken: aToken];
+    if (self) {
+        pending = [NSMutableArray new];
+        pending_by_key = [NSMutableDictionary new];
+        _primaryKey = @"id";
+        _maximumPending = DEFAULT_MAXIMUM_PENDING_CHANGES;
+        _overflow = RethinkDBChangeFeedMerge;
+    }
+    return self;
+}
+
+static id change_key(id change, NSString *primary_key) {
+    id value = [change objectForKey: @"new_val"];
+    
+    if(![value isKindOfClass: [NSDictionary class]]) {
+        value = [change objectForKey: @"old_val"];
+    }
+    if(![value isKindOfClass: [NSDictionary class]]) {
+        return nil;
+    }
+    
+    return [value objectForKey: primary_key];
+}
+
+// include_states sends {state: ...} on its own, without old_val or new_val
+static NSString *change_state(id change) {
+    id state = [change objectForKey: @"state"];
+    
+    if(![state isKindOfClass: [NSString class]] || [change objectForKey: @"new_val"] || [change objectForKey: @"old_val"]) {
+        return nil;
+    }
+    
+    return state;
+}
 
+- (void) dropOldest:(NSString*)primary_key {
+    // state markers are never dropped, the oldest change goes instead
+    NSUInteger index = 0;
+    while(change_state([pending objectAtIndex: index])) {
+        index++;
+    }
+    id oldest = [pending objectAtIndex: index];
+    id key = change_key(oldest, primary_key);
+    
+    [pending removeObjectAtIndex: index];
+    if(key && [pending_by_key objectForKey: key] == oldest) {
+        [pending_by_key removeObjectForKey: key];
+    }
+    dropped++;
+}
+
+// Folds change into the pending change for the same document, the way the server's squash does.
+- (void) mergeChange:(NSDictionary*)change into:(NSDictionary*)existing key:(id)key {
+    NSUInteger index = [pending indexOfObjectIdenticalTo: existing];
+    id old_val = [existing objectForKey: @"old_val"];
+    id new_val = [change objectForKey: @"new_val"];
+    
+    if(old_val == nil) {
+        old_val = [NSNull null];
+    }
+    if(new_val == nil) {
+        new_val = [NSNull null];
+    }
+    
+    if(old_val == [NSNull null] && new_val == [NSNull null]) {
+        // created and deleted again before anyone saw it
+        [pending removeObjectAtIndex: index];
+        [pending_by_key removeObjectForKey: key];
+        return;
+    }
+    
+    NSDictionary *merged = [NSDictionary dictionaryWithObjectsAndKeys: old_val, @"old_val", new_val, @"new_val", nil];
+    [pending replaceObjectAtIndex: index withObject: merged];
+    [pending_by_key setObject: merged forKey: key];
+}
+
+- (void) queueBatch:(NSArray*)changes {
+    NSString *primary_key = self.primaryKey;
+    NSUInteger maximum = self.maximumPending;
+    RethinkDBChangeFeedOverflow overflow = self.overflow;
+    BOOL squash = self.squash;
+    
+    for(id change in changes) {
+        if(![change isKindOfClass: [NSDictionary class]]) {
+            continue;
+        }
+        
+        NSString *state = change_state(change);
+        if(state) {
+            // include_states: the feed is initializing or ready. stateChanged hears about it from the drain, after
+            // the changes that came before it, so ready always follows the initial values.
+            self.state = state;
+            [pending addObject: change];
+            pending_states++;
+            continue;
+        }
+        
+        BOOL full = maximum && [pending count] - pending_states >= maximum;
+        id key = change_key(change, primary_key);
+        if(key && (squash || (full && overflow == RethinkDBChangeFeedMerge))) {
+            NSDictionary *existing = [pending_by_key objectForKey: key];
+            if(existing) {
+                [self mergeChange: change into: existing key: key];
+                continue;
+            }
+        }
+        
+        if(full) {
+            if(overflow == RethinkDBChangeFeedDropNewest) {
+                dropped++;
+                continue;
+            }
+            // merging could not make room either
+            [self dropOldest: primary_key];
+        }
+        
+        [pending addObject: change];
+        if(key) {
+            [pending_by_key setObject: change forKey: key];
+        }
+    }
+}
+
+- (NSArray*) dequeueBatch {
+    if([pending count] == 0) {
+        return nil;
+    }
+    
+    NSArray *batch = pending;
+    pending = [NSMutableArray new];
+    [pending_by_key removeAllObjects];
+    pending_states = 0;
+    
+    return batch;
+}
+
+// Hands the runs of changes to the consumer and the state markers between them to stateChanged, in order.
+- (BOOL) processBatch:(NSArray*)changes {
+    NSUInteger count = [changes count];
+    NSUInteger run_start = 0;
+    
+    for(NSUInteger i=0; i<=count; i++) {
+        NSString *state = i < count ? change_state([changes objectAtIndex: i]) : nil;
+        if(i < count && state == nil) {
+            continue;
+        }
+        
+        if(i > run_start && ![super processBatch: [changes subarrayWithRange: NSMakeRange(run_start, i - run_start)]]) {
+            return NO;
+        }
+        run_start = i + 1;
+        
+        RethinkDbStateBlock state_changed = self.stateChanged;
+        if(state && state_changed) {
+            state_changed(state);
+        }
+    }
+    
+    return YES;
+}
+
+// Pending changes are bounded by maximumPending instead, so there is always a CONTINUE waiting for the next ones.
+- (NSUInteger) queuedBatchCount {
+    return 0;
+}
+
+- (void) clearQueuedBatches {
+    [pending removeAllObjects];
+    [pending_by_key removeAllObjects];
+    pending_states = 0;
+}
+
+- (void) pause {
+    [self stopConsuming];
+}
+
+- (void) resume {
+    [self startConsuming];
+}
+
+- (NSUInteger) pendingCount {
+    [self lockQueue];
+    NSUInteger result = [pending count] - pending_states;
+    [self unlockQueue];
+    
+    return result;
+}
+
+- (uint64_t) droppedCount {
+    [self lockQueue];
+    uint64_t result = dropped;
+    [self unlockQueue];
+    
+    return result;
+}
 
 @end
 
@@ -0,0 +1,49 @@
+//
+//  RethinkDBDocumentCache.h
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright (c) 2026 Daniel Parnell
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#ifndef RethinkDbClient_RethinkDBDocumentCache_h
+#define RethinkDbClient_RethinkDBDocumentCache_h
+
+#import <Foundation/Foundation.h>
+#import "RethinkDbClient.h"
+
+// Runs the query a cache miss needs, handing the result to one of the blocks.
+typedef void (^RethinkDbCacheLoader)(RethinkDbSuccessBlock loaded, RethinkDbErrorBlock failed);
+
+@interface RethinkDBDocumentCache ()
+
+- (instancetype) initWithClient:(RethinkDbClient*)client table:(NSString*)table maximumBytes:(NSUInteger)maximumBytes timeToLive:(NSTimeInterval)timeToLive;
+
+// The operation finishes with a synthesized atom response once the document is known.
+- (RethinkDBOperation*) get:(id)key load:(RethinkDbCacheLoader)load then:(RethinkDbSuccessBlock)success fail:(RethinkDbErrorBlock)error;
+
+@end
+
+#endif
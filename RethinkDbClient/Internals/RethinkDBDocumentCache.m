@@ -0,0 +1,409 @@
+//
+//  RethinkDBDocumentCache.m
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright (c) 2026 Daniel Parnell
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#import "RethinkDBDocumentCache.h"
+#import "RethinkDBClient-Private.h"
+#import "RethinkDBResponse.h"
+
+// what a cache entry costs besides its document
+#define ENTRY_OVERHEAD 96
+// what a collection costs per element besides the element itself
+#define ELEMENT_OVERHEAD 16
+#define UNKNOWN_OBJECT_SIZE 64
+
+// A rough idea of how much memory a decoded document takes.
+static NSUInteger estimate_size(id value) {
+    if([value isKindOfClass: [NSString class]]) {
+        return 16 + [value length] * 2;
+    }
+    if([value isKindOfClass: [NSNumber class]] || value == [NSNull null]) {
+        return 16;
+    }
+    if([value isKindOfClass: [NSData class]]) {
+        return 16 + [value length];
+    }
+    if([value isKindOfClass: [NSDictionary class]]) {
+        __block NSUInteger size = 32;
+        [value enumerateKeysAndObjectsUsingBlock:^(id key, id obj, BOOL *stop) {
+            size += ELEMENT_OVERHEAD + estimate_size(key) + estimate_size(obj);
+        }];
+        return size;
+    }
+    if([value isKindOfClass: [NSArray class]]) {
+        NSUInteger size = 32;
+        for(id element in value) {
+            size += ELEMENT_OVERHEAD + estimate_size(element);
+        }
+        return size;
+    }
+    
+    return UNKNOWN_OBJECT_SIZE;
+}
+
+static RethinkDBOperation* finished_operation(id value) {
+    RethinkDBOperation *op = [[RethinkDBOperation alloc] initWithToken: 0];
+    op.response = [[RethinkDBResponse alloc] initWithToken: 0 type: Response_ResponseTypeSuccessAtom results: [NSArray arrayWithObject: value] notes: nil];
+    
+    return op;
+}
+
+// An entry in the cache and its place in the recently used list, which the cache's lock protects.
+@interface RethinkDBCacheEntry : NSObject {
+@public
+    __strong id key;
+    __strong id document;
+    NSUInteger size;
+    CFAbsoluteTime expires;
+    __unsafe_unretained RethinkDBCacheEntry *newer;
+    __unsafe_unretained RethinkDBCacheEntry *older;
+}
+@end
+
+@implementation RethinkDBCacheEntry
+@end
+
+@implementation RethinkDBDocumentCache {
+    __weak RethinkDbClient *client;
+    __strong NSLock *lock;
+    // owns the entries, the list only points at them
+    __strong NSMutableDictionary *entries;
+    __unsafe_unretained RethinkDBCacheEntry *newest;
+    __unsafe_unretained RethinkDBCacheEntry *oldest;
+    // the blocks waiting for each key that is being loaded
+    __strong NSMutableDictionary *loading;
+    // bumped by every invalidation so a load that raced one doesn't cache what it read
+    uint64_t generation;
+    __strong RethinkDBFeedSubscription *subscription;
+    
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    NSUInteger bytes_used;
+}
+
+- (instancetype) initWithClient:(RethinkDbClient*)aClient table:(NSString*)table maximumBytes:(NSUInteger)maximumBytes timeToLive:(NSTimeInterval)timeToLive {
+    self = [super init];
+    if (self) {
+        client = aClient;
+        _table = [table copy];
+        _maximumBytes = maximumBytes;
+        _timeToLive = timeToLive;
+        _primaryKey = @"id";
+        lock = [NSLock new];
+        entries = [NSMutableDictionary new];
+        loading = [NSMutableDictionary new];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [subscription cancel];
+}
+
+#pragma mark -
+#pragma mark The recently used list, all called with the lock held
+
+- (void) unlink:(RethinkDBCacheEntry*)entry {
+    if(entry->newer) {
+        entry->newer->older = entry->older;
+    } else {
+        newest = entry->older;
+    }
+    if(entry->older) {
+        entry->older->newer = entry->newer;
+    } else {
+        oldest = entry->newer;
+    }
+    entry->newer = nil;
+    entry->older = nil;
+}
+
+- (void) pushNewest:(RethinkDBCacheEntry*)entry {
+    entry->older = newest;
+    entry->newer = nil;
+    if(newest) {
+        newest->newer = entry;
+    }
+    newest = entry;
+    if(oldest == nil) {
+        oldest = entry;
+    }
+}
+
+- (void) removeEntry:(RethinkDBCacheEntry*)entry {
+    [self unlink: entry];
+    bytes_used -= entry->size;
+    [entries removeObjectForKey: entry->key];
+}
+
+- (void) storeDocument:(id)document forKey:(id)key {
+    RethinkDBCacheEntry *existing = [entries objectForKey: key];
+    if(existing) {
+        [self removeEntry: existing];
+    }
+    
+    RethinkDBCacheEntry *entry = [RethinkDBCacheEntry new];
+    entry->key = key;
+    entry->document = document;
+    entry->size = ENTRY_OVERHEAD + estimate_size(key) + estimate_size(document);
+    entry->expires = _timeToLive > 0 ? CFAbsoluteTimeGetCurrent() + _timeToLive : 0;
+    if(_maximumBytes && entry->size > _maximumBytes) {
+        // it would only push everything else out
+        return;
+    }
+    
+    [entries setObject: entry forKey: key];
+    [self pushNewest: entry];
+    bytes_used += entry->size;
+    
+    while(_maximumBytes && bytes_used > _maximumBytes && oldest) {
+        [self removeEntry: oldest];
+        evictions++;
+    }
+}
+
+#pragma mark -
+#pragma mark Lookups
+
+- (RethinkDBOperation*) get:(id)key load:(RethinkDbCacheLoader)load then:(RethinkDbSuccessBlock)success fail:(RethinkDbErrorBlock)error {
+    id document = nil;
+    BOOL first_miss = NO;
+    uint64_t started_generation;
+    RethinkDBOperation *op = nil;
+    
+    [lock lock];
+    RethinkDBCacheEntry *entry = [entries objectForKey: key];
+    if(entry && entry->expires && entry->expires < CFAbsoluteTimeGetCurrent()) {
+        [self removeEntry: entry];
+        entry = nil;
+    }
+    
+    if(entry) {
+        hits++;
+        document = entry->document;
+        [self unlink: entry];
+        [self pushNewest: entry];
+    } else {
+        misses++;
+        op = [[RethinkDBOperation alloc] initWithToken: 0];
+        
+        // everyone who misses while the document is on its way waits for the same query
+        NSMutableArray *waiters = [loading objectForKey: key];
+        if(waiters == nil) {
+            waiters = [NSMutableArray new];
+            [loading setObject: waiters forKey: key];
+            first_miss = YES;
+        }
+        [waiters addObject: [NSArray arrayWithObjects: op, success ? (id)success : [NSNull null], error ? (id)error : [NSNull null], nil]];
+    }
+    started_generation = generation;
+    [lock unlock];
+    
+    if(document) {
+        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            if(success) {
+                success(document);
+            }
+        });
+        
+        return finished_operation(document);
+    }
+    
+    if(first_miss) {
+        load(^(id loaded) {
+            [self finishLoading: key document: loaded error: nil generation: started_generation];
+        }, ^(NSError *err) {
+            [self finishLoading: key document: nil error: err generation: started_generation];
+        });
+    }
+    
+    return op;
+}
+
+- (void) finishLoading:(id)key document:(id)document error:(NSError*)error generation:(uint64_t)started_generation {
+    [lock lock];
+    NSArray *waiters = [loading objectForKey: key];
+    [loading removeObjectForKey: key];
+    if(error == nil && started_generation == generation) {
+        [self storeDocument: document ? document : [NSNull null] forKey: key];
+    }
+    [lock unlock];
+    
+    for(NSArray *waiter in waiters) {
+        RethinkDBOperation *op = [waiter objectAtIndex: 0];
+        id on_success = [waiter objectAtIndex: 1];
+        id on_error = [waiter objectAtIndex: 2];
+        
+        if(error) {
+            op.response = [[RethinkDBResponse alloc] initWithToken: 0 type: Response_ResponseTypeRuntimeError results: [NSArray arrayWithObject: [error localizedDescription]] notes: nil];
+            if(on_error != [NSNull null]) {
+                ((RethinkDbErrorBlock)on_error)(error);
+            }
+        } else {
+            id value = document ? document : [NSNull null];
+            op.response = [[RethinkDBResponse alloc] initWithToken: 0 type: Response_ResponseTypeSuccessAtom results: [NSArray arrayWithObject: value] notes: nil];
+            if(on_success != [NSNull null]) {
+                ((RethinkDbSuccessBlock)on_success)(value);
+            }
+        }
+    }
+}
+
+#pragma mark -
+#pragma mark Invalidation
+
+- (void) invalidateKey:(id)key {
+    if(key == nil) {
+        return;
+    }
+    
+    [lock lock];
+    generation++;
+    RethinkDBCacheEntry *entry = [entries objectForKey: key];
+    if(entry) {
+        [self removeEntry: entry];
+    }
+    [lock unlock];
+}
+
+- (void) invalidateAll {
+    [lock lock];
+    generation++;
+    [entries removeAllObjects];
+    newest = nil;
+    oldest = nil;
+    bytes_used = 0;
+    [lock unlock];
+}
+
+- (void) applyChange:(NSDictionary*)change {
+    if(![change isKindOfClass: [NSDictionary class]]) {
+        return;
+    }
+    
+    NSString *key_field = self.primaryKey;
+    for(NSString *side in [NSArray arrayWithObjects: @"old_val", @"new_val", nil]) {
+        id value = [change objectForKey: side];
+        if([value isKindOfClass: [NSDictionary class]]) {
+            [self invalidateKey: [value objectForKey: key_field]];
+        }
+    }
+}
+
+- (void) followChanges {
+    RethinkDbClient *owner = client;
+    
+    [lock lock];
+    BOOL following = subscription != nil;
+    [lock unlock];
+    if(following || owner == nil) {
+        return;
+    }
+    
+    __weak RethinkDBDocumentCache *weak_self = self;
+    RethinkDBFeedSubscription *changes = [[[owner table: _table] changes: nil] subscribe:^BOOL(id change) {
+        RethinkDBDocumentCache *cache = weak_self;
+        [cache applyChange: change];
+        return cache != nil;
+    } fail:^(NSError *error) {
+        // changes may have been missed, so nothing in the cache can be trusted
+        RethinkDBDocumentCache *cache = weak_self;
+        [cache invalidateAll];
+        [cache stopFollowingChanges];
+    }];
+    
+    [lock lock];
+    subscription = changes;
+    [lock unlock];
+}
+
+- (void) stopFollowingChanges {
+    [lock lock];
+    RethinkDBFeedSubscription *changes = subscription;
+    subscription = nil;
+    [lock unlock];
+    
+    [changes cancel];
+}
+
+#pragma mark -
+#pragma mark Statistics
+
+- (uint64_t) hits {
+    [lock lock];
+    uint64_t result = hits;
+    [lock unlock];
+    
+    return result;
+}
+
+- (uint64_t) misses {
+    [lock lock];
+    uint64_t result = misses;
+    [lock unlock];
+    
+    return result;
+}
+
+- (double) hitRatio {
+    [lock lock];
+    uint64_t total = hits + misses;
+    double result = total ? (double)hits / total : 0;
+    [lock unlock];
+    
+    return result;
+}
+
+- (uint64_t) evictions {
+    [lock lock];
+    uint64_t result = evictions;
+    [lock unlock];
+    
+    return result;
+}
+
+- (NSUInteger) count {
+    [lock lock];
+    NSUInteger result = [entries count];
+    [lock unlock];
+    
+    return result;
+}
+
+- (NSUInteger) bytesUsed {
+    [lock lock];
+    NSUInteger result = bytes_used;
+    [lock unlock];
+    
+    return result;
+}
+
+@end
@@ -0,0 +1,52 @@
+//
+//  RethinkDBEventLoop.h
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright (c) 2026 Daniel Parnell
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef RethinkDbClient_RethinkDBEventLoop_h
+#define RethinkDbClient_RethinkDBEventLoop_h
+
+#import <Foundation/Foundation.h>
+
+// A dedicated I/O thread running its own run loop. Each connection schedules
+// its socket streams here, so stream events no longer depend on whichever
+// thread happened to create the client, and no caller has to pump a run loop.
+@interface RethinkDBEventLoop : NSObject
+
+- (instancetype) initWithName:(NSString*)name;
+
+- (void) scheduleStream:(NSStream*)stream;
+- (void) removeStream:(NSStream*)stream;
+
+- (void) performBlock:(dispatch_block_t)block waitUntilDone:(BOOL)wait;
+- (void) stop;
+
+- (BOOL) isCurrentThread;
+
+@end
+
+#endif
@@ -0,0 +1,99 @@
+//
+//  RethinkDBEventLoop.m
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright (c) 2026 Daniel Parnell
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#import "RethinkDBEventLoop.h"
+
+@implementation RethinkDBEventLoop {
+    __strong NSThread *thread;
+    __strong NSRunLoop *run_loop;
+    __strong dispatch_semaphore_t started;
+    volatile BOOL stopped;
+}
+
+- (instancetype) initWithName:(NSString*)name {
+    self = [super init];
+    if (self) {
+        started = dispatch_semaphore_create(0);
+        thread = [[NSThread alloc] initWithTarget: self selector: @selector(threadMain) object: nil];
+        thread.name = name;
+        [thread start];
+        
+        // don't hand out the loop until its run loop exists
+        dispatch_semaphore_wait(started, DISPATCH_TIME_FOREVER);
+    }
+    return self;
+}
+
+- (void) threadMain {
+    @autoreleasepool {
+        run_loop = [NSRunLoop currentRunLoop];
+        // a run loop with no sources returns immediately, so keep a port around while idle
+        [run_loop addPort: [NSPort port] forMode: NSDefaultRunLoopMode];
+        dispatch_semaphore_signal(started);
+        
+        while(!stopped) {
+            @autoreleasepool {
+                [run_loop runMode: NSDefaultRunLoopMode beforeDate: [NSDate distantFuture]];
+            }
+        }
+    }
+}
+
+- (void) runBlock:(dispatch_block_t)block {
+    block();
+}
+
+- (void) performBlock:(dispatch_block_t)block waitUntilDone:(BOOL)wait {
+    [self performSelector: @selector(runBlock:) onThread: thread withObject: [block copy] waitUntilDone: wait];
+}
+
+- (BOOL) isCurrentThread {
+    return [NSThread currentThread] == thread;
+}
+
+- (void) scheduleStream:(NSStream*)stream {
+    [self performBlock:^{
+        [stream scheduleInRunLoop: run_loop forMode: NSDefaultRunLoopMode];
+    } waitUntilDone: YES];
+}
+
+- (void) removeStream:(NSStream*)stream {
+    [self performBlock:^{
+        [stream removeFromRunLoop: run_loop forMode: NSDefaultRunLoopMode];
+    } waitUntilDone: YES];
+}
+
+- (void) stop {
+    // performing anything on the thread wakes the run loop so it sees the flag
+    [self performBlock:^{
+        stopped = YES;
+    } waitUntilDone: NO];
+}
+
+@end
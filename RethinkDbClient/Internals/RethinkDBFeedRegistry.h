@@ -0,0 +1,48 @@
+//
+//  RethinkDBFeedRegistry.h
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright (c) 2026 Daniel Parnell
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#ifndef RethinkDbClient_RethinkDBFeedRegistry_h
+#define RethinkDbClient_RethinkDBFeedRegistry_h
+
+#import <Foundation/Foundation.h>
+#import "RethinkDbClient.h"
+
+// The change feeds a connection shares between local subscribers, keyed by the serialized changes: query.
+// The first subscriber to a query starts its feed on the server, every later one joins it, and the feed is
+// closed when the last subscriber cancels. A nil key gives the subscriber a feed of its own.
+@interface RethinkDBFeedRegistry : NSObject
+
+- (RethinkDBFeedSubscription*) subscribeTo:(RethinkDbClient*)query key:(NSData*)key bufferSize:(NSUInteger)bufferSize each:(RethinkDbCursorValueBlock)change fail:(RethinkDbErrorBlock)error;
+
+@property (readonly) NSUInteger feedCount;
+
+@end
+
+#endif
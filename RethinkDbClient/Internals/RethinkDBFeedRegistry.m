@@ -0,0 +1,377 @@
+//
+//  RethinkDBFeedRegistry.m
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright (c) 2026 Daniel Parnell
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#import "RethinkDBFeedRegistry.h"
+
+static NSString* feed_error = @"RethinkDB Feed Error";
+
+@class RethinkDBSharedFeed;
+
+@interface RethinkDBFeedRegistry (Private)
+
+- (void) removeFeed:(RethinkDBSharedFeed*)feed;
+
+@end
+
+@interface RethinkDBFeedSubscription ()
+
+- (instancetype) initWithFeed:(RethinkDBSharedFeed*)feed bufferSize:(NSUInteger)bufferSize each:(RethinkDbCursorValueBlock)change fail:(RethinkDbErrorBlock)error;
+- (void) push:(id)change;
+- (void) fail:(NSError*)error;
+
+@end
+
+#pragma mark -
+#pragma mark Shared feeds
+
+// One server side feed and the subscriptions it fans out to.
+@interface RethinkDBSharedFeed : NSObject
+
+- (instancetype) initWithRegistry:(RethinkDBFeedRegistry*)registry key:(NSData*)key;
+- (void) startWithQuery:(RethinkDbClient*)query;
+// nil once the feed has been closed
+- (RethinkDBFeedSubscription*) addSubscriberWithBufferSize:(NSUInteger)bufferSize each:(RethinkDbCursorValueBlock)change fail:(RethinkDbErrorBlock)error;
+- (void) removeSubscriber:(RethinkDBFeedSubscription*)subscription;
+
+@property (readonly) NSData *key;
+
+@end
+
+@implementation RethinkDBSharedFeed {
+    __weak RethinkDBFeedRegistry *registry;
+    __strong NSLock *lock;
+    // replaced rather than changed, so fanning out only holds the lock long enough to take a reference
+    __strong NSArray *subscribers;
+    __strong RethinkDBChangeFeed *cursor;
+    BOOL closed;
+}
+
+- (instancetype) initWithRegistry:(RethinkDBFeedRegistry*)aRegistry key:(NSData*)aKey {
+    self = [super init];
+    if (self) {
+        registry = aRegistry;
+        _key = aKey;
+        lock = [NSLock new];
+        subscribers = [NSArray array];
+    }
+    return self;
+}
+
+- (RethinkDBFeedSubscription*) addSubscriberWithBufferSize:(NSUInteger)bufferSize each:(RethinkDbCursorValueBlock)change fail:(RethinkDbErrorBlock)error {
+    RethinkDBFeedSubscription *subscription = nil;
+    
+    [lock lock];
+    if(!closed) {
+        subscription = [[RethinkDBFeedSubscription alloc] initWithFeed: self bufferSize: bufferSize each: change fail: error];
+        subscribers = [subscribers arrayByAddingObject: subscription];
+    }
+    [lock unlock];
+    
+    return subscription;
+}
+
+- (void) removeSubscriber:(RethinkDBFeedSubscription*)subscription {
+    RethinkDBChangeFeed *to_close = nil;
+    BOOL last = NO;
+    
+    [lock lock];
+    NSMutableArray *remaining = [subscribers mutableCopy];
+    [remaining removeObjectIdenticalTo: subscription];
+    subscribers = remaining;
+    if([remaining count] == 0 && !closed) {
+        closed = YES;
+        last = YES;
+        to_close = cursor;
+        // the cursor's blocks point back here, so let go of it
+        cursor = nil;
+    }
+    [lock unlock];
+    
+    if(last) {
+        [registry removeFeed: self];
+        [to_close close];
+    }
+}
+
+- (void) failWithError:(NSError*)error {
+    NSArray *current;
+    
+    [lock lock];
+    closed = YES;
+    current = subscribers;
+    subscribers = [NSArray array];
+    cursor = nil;
+    [lock unlock];
+    
+    [registry removeFeed: self];
+    for(RethinkDBFeedSubscription *subscription in current) {
+        [subscription fail: error];
+    }
+}
+
+- (void) pushChange:(id)change {
+    [lock lock];
+    NSArray *current = subscribers;
+    [lock unlock];
+    
+    for(RethinkDBFeedSubscription *subscription in current) {
+        [subscription push: change];
+    }
+}
+
+- (void) startWithQuery:(RethinkDbClient*)query {
+    // the cursor holds on to its blocks after it is closed, so they must not keep the shared feed alive
+    __weak RethinkDBSharedFeed *weak_self = self;
+    
+    [query runThen:^(id response) {
+        if(![response isKindOfClass: [RethinkDBChangeFeed class]]) {
+            [self failWithError: [NSError errorWithDomain: feed_error code: -1 userInfo: [NSDictionary dictionaryWithObject: @"The query did not return a change feed" forKey: NSLocalizedDescriptionKey]]];
+            return;
+        }
+        
+        RethinkDBChangeFeed *feed = response;
+        [lock lock];
+        BOOL already_closed = closed;
+        if(!already_closed) {
+            cursor = feed;
+        }
+        [lock unlock];
+        
+        if(already_closed) {
+            // everyone left before the server answered
+            [feed close];
+            return;
+        }
+        
+        [feed each:^BOOL(id change) {
+            RethinkDBSharedFeed *shared = weak_self;
+            [shared pushChange: change];
+            
+            return shared != nil;
+        } fail:^(NSError *error) {
+            [weak_self failWithError: error];
+        }];
+    } fail:^(NSError *error) {
+        [self failWithError: error];
+    }];
+}
+
+@end
+
+#pragma mark -
+#pragma mark Subscriptions
+
+@implementation RethinkDBFeedSubscription {
+    // keeps a feed that is not in the registry alive, the feed lets go of its subscribers as they leave
+    __strong RethinkDBSharedFeed *feed;
+    RethinkDbCursorValueBlock on_change;
+    RethinkDbErrorBlock on_error;
+    __strong NSLock *lock;
+    
+    // a ring of changes waiting for this subscriber, the oldest is overwritten when it is full
+    __strong NSMutableArray *ring;
+    NSUInteger capacity;
+    NSUInteger head;
+    NSUInteger count;
+    BOOL draining;
+    BOOL cancelled;
+    uint64_t dropped;
+}
+
+- (instancetype) initWithFeed:(RethinkDBSharedFeed*)aFeed bufferSize:(NSUInteger)bufferSize each:(RethinkDbCursorValueBlock)change fail:(RethinkDbErrorBlock)error {
+    self = [super init];
+    if (self) {
+        feed = aFeed;
+        on_change = change;
+        on_error = error;
+        lock = [NSLock new];
+        capacity = MAX(bufferSize, 1);
+        ring = [NSMutableArray arrayWithCapacity: capacity];
+        for(NSUInteger i = 0; i < capacity; i++) {
+            [ring addObject: [NSNull null]];
+        }
+    }
+    return self;
+}
+
+- (void) push:(id)change {
+    BOOL schedule;
+    
+    [lock lock];
+    if(cancelled) {
+        [lock unlock];
+        return;
+    }
+    if(count == capacity) {
+        head = (head + 1) % capacity;
+        count--;
+        dropped++;
+    }
+    [ring replaceObjectAtIndex: (head + count) % capacity withObject: change];
+    count++;
+    schedule = !draining;
+    draining = YES;
+    [lock unlock];
+    
+    if(schedule) {
+        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            [self drain];
+        });
+    }
+}
+
+// Hands the buffered changes to the subscriber one at a time, at most one drain runs per subscription.
+- (void) drain {
+    while(YES) {
+        [lock lock];
+        if(count == 0 || cancelled) {
+            draining = NO;
+            [lock unlock];
+            return;
+        }
+        id change = [ring objectAtIndex: head];
+        [ring replaceObjectAtIndex: head withObject: [NSNull null]];
+        head = (head + 1) % capacity;
+        count--;
+        [lock unlock];
+        
+        if(on_change && !on_change(change)) {
+            [self cancel];
+        }
+    }
+}
+
+- (void) fail:(NSError*)error {
+    [lock lock];
+    BOOL was_cancelled = cancelled;
+    cancelled = YES;
+    [lock unlock];
+    
+    if(!was_cancelled && on_error) {
+        on_error(error);
+    }
+}
+
+- (void) cancel {
+    [lock lock];
+    BOOL was_cancelled = cancelled;
+    cancelled = YES;
+    count = 0;
+    [lock unlock];
+    
+    if(!was_cancelled) {
+        [feed removeSubscriber: self];
+    }
+}
+
+- (uint64_t) droppedCount {
+    [lock lock];
+    uint64_t result = dropped;
+    [lock unlock];
+    
+    return result;
+}
+
+@end
+
+#pragma mark -
+#pragma mark Registry
+
+@implementation RethinkDBFeedRegistry {
+    __strong NSLock *lock;
+    __strong NSMutableDictionary *feeds;
+}
+
+- (instancetype) init {
+    self = [super init];
+    if (self) {
+        lock = [NSLock new];
+        feeds = [NSMutableDictionary new];
+    }
+    return self;
+}
+
+- (RethinkDBFeedSubscription*) subscribeTo:(RethinkDbClient*)query key:(NSData*)key bufferSize:(NSUInteger)bufferSize each:(RethinkDbCursorValueBlock)change fail:(RethinkDbErrorBlock)error {
+    RethinkDBFeedSubscription *subscription = nil;
+    RethinkDBSharedFeed *started = nil;
+    
+    if(key == nil) {
+        started = [[RethinkDBSharedFeed alloc] initWithRegistry: self key: nil];
+        subscription = [started addSubscriberWithBufferSize: bufferSize each: change fail: error];
+        [started startWithQuery: query];
+        
+        return subscription;
+    }
+    
+    [lock lock];
+    while(subscription == nil) {
+        RethinkDBSharedFeed *feed = [feeds objectForKey: key];
+        if(feed == nil) {
+            feed = [[RethinkDBSharedFeed alloc] initWithRegistry: self key: key];
+            [feeds setObject: feed forKey: key];
+            started = feed;
+        }
+        
+        subscription = [feed addSubscriberWithBufferSize: bufferSize each: change fail: error];
+        if(subscription == nil) {
+            // the feed closed between its last subscriber leaving and it being removed
+            [feeds removeObjectForKey: key];
+        }
+    }
+    [lock unlock];
+    
+    if(started) {
+        [started startWithQuery: query];
+    }
+    
+    return subscription;
+}
+
+- (void) removeFeed:(RethinkDBSharedFeed*)feed {
+    if(feed.key == nil) {
+        return;
+    }
+    
+    [lock lock];
+    if([feeds objectForKey: feed.key] == feed) {
+        [feeds removeObjectForKey: feed.key];
+    }
+    [lock unlock];
+}
+
+- (NSUInteger) feedCount {
+    [lock lock];
+    NSUInteger result = [feeds count];
+    [lock unlock];
+    
+    return result;
+}
+
+@end
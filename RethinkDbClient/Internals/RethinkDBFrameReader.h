@@ -0,0 +1,52 @@
+//
+//  RethinkDBFrameReader.h
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright (c) 2026 Daniel Parnell
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef RethinkDbClient_RethinkDBFrameReader_h
+#define RethinkDbClient_RethinkDBFrameReader_h
+
+#import <Foundation/Foundation.h>
+
+// Called for every complete frame. The bytes point into the reader's receive
+// buffer and are only valid until the block returns.
+typedef void (^RethinkDBFrameBlock)(int64_t token, const uint8_t *bytes, NSUInteger length);
+
+// Reads length prefixed frames from a socket into a single reusable receive
+// buffer and hands them out in place. JSON frames start with an 8 byte token
+// followed by a 4 byte length, protocol buffer frames only have the length.
+@interface RethinkDBFrameReader : NSObject
+
+- (instancetype) initWithTokenHeader:(BOOL)tokenHeader;
+
+- (BOOL) readFromStream:(NSInputStream*)stream frames:(RethinkDBFrameBlock)frames error:(NSError**)error;
+
+@property (readonly) NSUInteger capacity;
+
+@end
+
+#endif
@@ -0,0 +1,130 @@
+//
+//  RethinkDBFrameReader.m
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright (c) 2026 Daniel Parnell
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#import "RethinkDBFrameReader.h"
+
+#define INITIAL_CAPACITY 65536
+
+@implementation RethinkDBFrameReader {
+    uint8_t *buffer;
+    NSUInteger capacity;
+    NSUInteger read_pos;
+    NSUInteger write_pos;
+    NSUInteger header_size;
+}
+
+- (instancetype) initWithTokenHeader:(BOOL)tokenHeader {
+    self = [super init];
+    if (self) {
+        header_size = tokenHeader ? 12 : 4;
+        capacity = INITIAL_CAPACITY;
+        buffer = malloc(capacity);
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    free(buffer);
+}
+
+- (NSUInteger) capacity {
+    return capacity;
+}
+
+// Makes sure there is room for at least `needed` bytes of unread data, moving
+// what is left of a partial frame to the front before growing the buffer.
+- (void) reserve:(NSUInteger)needed {
+    if(read_pos > 0 && capacity - read_pos < needed) {
+        memmove(buffer, buffer + read_pos, write_pos - read_pos);
+        write_pos -= read_pos;
+        read_pos = 0;
+    }
+    
+    if(capacity < needed) {
+        while(capacity < needed) {
+            capacity *= 2;
+        }
+        buffer = realloc(buffer, capacity);
+    }
+}
+
+- (void) dispatchFrames:(RethinkDBFrameBlock)frames {
+    while(write_pos - read_pos >= header_size) {
+        const uint8_t *header = buffer + read_pos;
+        int64_t token = 0;
+        uint32_t length;
+        
+        if(header_size == 12) {
+            memcpy(&token, header, sizeof(token));
+            token = (int64_t)CFSwapInt64LittleToHost((uint64_t)token);
+        }
+        memcpy(&length, header + header_size - 4, sizeof(length));
+        length = CFSwapInt32LittleToHost(length);
+        
+        NSUInteger frame_size = header_size + length;
+        if(write_pos - read_pos < frame_size) {
+            // grow now so the rest of a large batch is read straight into place
+            [self reserve: frame_size];
+            return;
+        }
+        
+        frames(token, buffer + read_pos + header_size, length);
+        read_pos += frame_size;
+    }
+    
+    if(read_pos == write_pos) {
+        read_pos = 0;
+        write_pos = 0;
+    }
+}
+
+- (BOOL) readFromStream:(NSInputStream*)stream frames:(RethinkDBFrameBlock)frames error:(NSError**)error {
+    do {
+        if(write_pos == capacity) {
+            [self reserve: write_pos - read_pos + 1];
+        }
+        
+        NSInteger count = [stream read: buffer + write_pos maxLength: capacity - write_pos];
+        if(count < 0) {
+            if(error) *error = [stream streamError];
+            return NO;
+        }
+        if(count == 0) {
+            break;
+        }
+        write_pos += count;
+        
+        [self dispatchFrames: frames];
+    } while([stream hasBytesAvailable]);
+    
+    return YES;
+}
+
+@end
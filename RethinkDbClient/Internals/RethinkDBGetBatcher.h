@@ -0,0 +1,54 @@
+//
+//  RethinkDBGetBatcher.h
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright (c) 2026 Daniel Parnell
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#ifndef RethinkDbClient_RethinkDBGetBatcher_h
+#define RethinkDbClient_RethinkDBGetBatcher_h
+
+#import <Foundation/Foundation.h>
+#import "RethinkDbClient.h"
+
+// Collects the get: queries made on one table and sends them as a single getAll:. A batch is sent window
+// seconds after its first key, or as soon as it holds maximumBatchSize different keys.
+@interface RethinkDBGetBatcher : NSObject
+
+- (instancetype) initWithClient:(RethinkDbClient*)client table:(NSString*)table primaryKey:(NSString*)primaryKey window:(NSTimeInterval)window maximumBatchSize:(NSUInteger)maximumBatchSize;
+
+// The operation finishes with a synthesized atom response holding the document, or NSNull if there isn't one.
+- (RethinkDBOperation*) get:(id)key then:(RethinkDbSuccessBlock)success fail:(RethinkDbErrorBlock)error;
+// sends whatever has been collected straight away
+- (void) flush;
+
+@property (readonly) NSString *table;
+// the field results are matched to keys by
+@property (readonly) NSString *primaryKey;
+
+@end
+
+#endif
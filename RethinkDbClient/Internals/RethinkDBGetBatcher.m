@@ -0,0 +1,176 @@
+//
+//  RethinkDBGetBatcher.m
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright (c) 2026 Daniel Parnell
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#import "RethinkDBGetBatcher.h"
+#import "RethinkDBClient-Private.h"
+#import "RethinkDBResponse.h"
+
+static NSString* batch_error = @"RethinkDB Batch Error";
+
+@implementation RethinkDBGetBatcher {
+    __weak RethinkDbClient *client;
+    NSTimeInterval window;
+    NSUInteger maximum_batch_size;
+    __strong NSLock *lock;
+    __strong dispatch_queue_t timer_queue;
+    // the keys of the batch being collected in the order they were asked for, and who is waiting for each
+    __strong NSMutableArray *pending_keys;
+    __strong NSMutableDictionary *waiters;
+    // stops the timer of a batch that was sent because it filled up from sending the next one early
+    uint64_t batch_number;
+}
+
+- (instancetype) initWithClient:(RethinkDbClient*)aClient table:(NSString*)table primaryKey:(NSString*)primaryKey window:(NSTimeInterval)aWindow maximumBatchSize:(NSUInteger)maximumBatchSize {
+    self = [super init];
+    if (self) {
+        client = aClient;
+        _table = [table copy];
+        _primaryKey = primaryKey ? [primaryKey copy] : @"id";
+        window = aWindow;
+        maximum_batch_size = MAX(maximumBatchSize, 1);
+        lock = [NSLock new];
+        timer_queue = dispatch_queue_create("RethinkDBGetBatcher", DISPATCH_QUEUE_SERIAL);
+        pending_keys = [NSMutableArray new];
+        waiters = [NSMutableDictionary new];
+    }
+    return self;
+}
+
+- (RethinkDBOperation*) get:(id)key then:(RethinkDbSuccessBlock)success fail:(RethinkDbErrorBlock)error {
+    RethinkDBOperation *op = [[RethinkDBOperation alloc] initWithToken: 0];
+    NSArray *waiter = [NSArray arrayWithObjects: op, success ? (id)success : [NSNull null], error ? (id)error : [NSNull null], nil];
+    BOOL first = NO;
+    BOOL full = NO;
+    uint64_t started;
+    
+    [lock lock];
+    NSMutableArray *for_key = [waiters objectForKey: key];
+    if(for_key == nil) {
+        for_key = [NSMutableArray new];
+        [waiters setObject: for_key forKey: key];
+        [pending_keys addObject: key];
+        first = [pending_keys count] == 1;
+        full = [pending_keys count] >= maximum_batch_size;
+    }
+    [for_key addObject: waiter];
+    started = batch_number;
+    [lock unlock];
+    
+    if(full) {
+        [self flush];
+    } else if(first) {
+        // the timer keeps the batcher alive, the get: clients holding it may be gone by the time it fires
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(window * NSEC_PER_SEC)), timer_queue, ^{
+            [self flushBatch: started];
+        });
+    }
+    
+    return op;
+}
+
+- (void) flush {
+    [lock lock];
+    uint64_t current = batch_number;
+    [lock unlock];
+    
+    [self flushBatch: current];
+}
+
+- (void) flushBatch:(uint64_t)number {
+    [lock lock];
+    if(number != batch_number || [pending_keys count] == 0) {
+        [lock unlock];
+        return;
+    }
+    NSArray *keys = pending_keys;
+    NSDictionary *batch = waiters;
+    pending_keys = [NSMutableArray new];
+    waiters = [NSMutableDictionary new];
+    batch_number++;
+    [lock unlock];
+    
+    RethinkDbClient *owner = client;
+    if(owner == nil) {
+        [self finishBatch: batch documents: nil error: [NSError errorWithDomain: batch_error code: NSURLErrorNotConnectedToInternet userInfo: [NSDictionary dictionaryWithObject: @"The client has gone away" forKey: NSLocalizedDescriptionKey]]];
+        return;
+    }
+    
+    [[[owner table: _table] getAll: keys] runThen:^(id response) {
+        if([response isKindOfClass: [RethinkDBSequenceCursor class]]) {
+            [response toArrayThen:^(NSArray *array) {
+                [self finishBatch: batch documents: array error: nil];
+            } fail:^(NSError *error) {
+                [self finishBatch: batch documents: nil error: error];
+            }];
+        } else {
+            [self finishBatch: batch documents: [response isKindOfClass: [NSArray class]] ? response : nil error: nil];
+        }
+    } fail:^(NSError *error) {
+        [self finishBatch: batch documents: nil error: error];
+    }];
+}
+
+- (void) finishBatch:(NSDictionary*)batch documents:(NSArray*)documents error:(NSError*)error {
+    NSString *key_field = _primaryKey;
+    NSMutableDictionary *by_key = [NSMutableDictionary dictionaryWithCapacity: [documents count]];
+    for(id document in documents) {
+        id key = [document isKindOfClass: [NSDictionary class]] ? [document objectForKey: key_field] : nil;
+        if(key) {
+            [by_key setObject: document forKey: key];
+        }
+    }
+    
+    [batch enumerateKeysAndObjectsUsingBlock:^(id key, NSArray *for_key, BOOL *stop) {
+        id document = [by_key objectForKey: key];
+        if(document == nil) {
+            document = [NSNull null];
+        }
+        
+        for(NSArray *waiter in for_key) {
+            RethinkDBOperation *op = [waiter objectAtIndex: 0];
+            id on_success = [waiter objectAtIndex: 1];
+            id on_error = [waiter objectAtIndex: 2];
+            
+            if(error) {
+                op.response = [[RethinkDBResponse alloc] initWithToken: 0 type: Response_ResponseTypeRuntimeError results: [NSArray arrayWithObject: [error localizedDescription]] notes: nil];
+                if(on_error != [NSNull null]) {
+                    ((RethinkDbErrorBlock)on_error)(error);
+                }
+            } else {
+                op.response = [[RethinkDBResponse alloc] initWithToken: 0 type: Response_ResponseTypeSuccessAtom results: [NSArray arrayWithObject: document] notes: nil];
+                if(on_success != [NSNull null]) {
+                    ((RethinkDbSuccessBlock)on_success)(document);
+                }
+            }
+        }
+    }];
+}
+
+@end
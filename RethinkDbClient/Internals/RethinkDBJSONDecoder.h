@@ -0,0 +1,73 @@
+//
+//  RethinkDBJSONDecoder.h
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright (c) 2026 Daniel Parnell
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef RethinkDbClient_RethinkDBJSONDecoder_h
+#define RethinkDbClient_RethinkDBJSONDecoder_h
+
+#import <Foundation/Foundation.h>
+#import "RethinkDBResponse.h"
+
+@class RethinkDBStringTable;
+
+// Decodes JSON protocol frames in a single pass, building the final
+// NSDictionary/NSArray/NSString/NSNumber values directly from the bytes
+// without an intermediate NSJSONSerialization or Datum tree.
+@interface RethinkDBJSONDecoder : NSObject
+
+- (RethinkDBResponse*) decodeResponse:(const uint8_t*)bytes length:(NSUInteger)length token:(int64_t)token error:(NSError**)error;
+- (id) decodeValue:(const uint8_t*)bytes length:(NSUInteger)length error:(NSError**)error;
+
+// When set, objects and arrays in a response's results are returned as RethinkDBLazyDictionary and
+// RethinkDBLazyArray proxies that only decode the parts that are actually read.
+@property (assign) BOOL lazyRows;
+// When set, a response's results are a RethinkDBCompactBatch. Takes precedence over lazyRows.
+@property (assign) BOOL compactRows;
+// Where decodeResponse: gets object keys and string values from, nil to always make new strings.
+// Only decodeResponse: uses them, so the tables are not shared between threads.
+@property (strong) RethinkDBStringTable *keyTable;
+@property (strong) RethinkDBStringTable *valueTable;
+
+@end
+
+// An immutable dictionary over a JSON object in a response. Looking up a key compares raw key bytes and
+// decodes only that value; count and enumeration index the keys once. Nested containers are lazy as well.
+@interface RethinkDBLazyDictionary : NSDictionary
+
+- (instancetype) initWithBuffer:(NSData*)buffer range:(NSRange)range;
+
+@end
+
+// An immutable array over a JSON array in a response, decoding each element on first access.
+@interface RethinkDBLazyArray : NSArray
+
+- (instancetype) initWithBuffer:(NSData*)buffer range:(NSRange)range;
+
+@end
+
+#endif
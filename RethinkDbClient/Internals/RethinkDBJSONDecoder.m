@@ -0,0 +1,1551 @@
+//
+//  RethinkDBJSONDecoder.m
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright (c) 2026 Daniel Parnell
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#import "RethinkDBJSONDecoder.h"
+#import "RethinkDBStringTable.h"
+#import "RethinkDbClient.h"
+#import <pthread.h>
+
+#define MAX_NESTING_DEPTH 512
+#define STACK_STRING_SIZE 256
+#define STACK_NUMBER_SIZE 64
+
+static NSString* decoder_error = @"RethinkDB JSON Error";
+
+typedef struct {
+    const uint8_t *p;
+    const uint8_t *end;
+    int depth;
+    const char *error;
+    // when set, objects and arrays become lazy proxies over this copy of the bytes starting at base
+    __unsafe_unretained NSData *lazy_buffer;
+    const uint8_t *base;
+    // when set, object keys and short string values come from these tables
+    __unsafe_unretained RethinkDBStringTable *keys;
+    __unsafe_unretained RethinkDBStringTable *values;
+} json_parser;
+
+static id parse_value(json_parser *ps);
+
+static inline void skip_whitespace(json_parser *ps) {
+    while(ps->p < ps->end && (*ps->p == ' ' || *ps->p == '\n' || *ps->p == '\r' || *ps->p == '\t')) {
+        ps->p++;
+    }
+}
+
+static inline BOOL expect(json_parser *ps, uint8_t c) {
+    skip_whitespace(ps);
+    if(ps->p < ps->end && *ps->p == c) {
+        ps->p++;
+        return YES;
+    }
+    
+    ps->error = "Unexpected character";
+    return NO;
+}
+
+static inline int hex_value(uint8_t c) {
+    if(c >= '0' && c <= '9') return c - '0';
+    if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static BOOL parse_hex4(json_parser *ps, const uint8_t *q, uint32_t *out) {
+    uint32_t v = 0;
+    
+    if(ps->end - q < 4) {
+        ps->error = "Truncated unicode escape";
+        return NO;
+    }
+    for(int i = 0; i < 4; i++) {
+        int h = hex_value(q[i]);
+        if(h < 0) {
+            ps->error = "Invalid unicode escape";
+            return NO;
+        }
+        v = (v << 4) | (uint32_t)h;
+    }
+    *out = v;
+    
+    return YES;
+}
+
+static inline size_t put_utf8(uint8_t *out, uint32_t cp) {
+    if(cp < 0x80) {
+        out[0] = (uint8_t)cp;
+        return 1;
+    } else if(cp < 0x800) {
+        out[0] = (uint8_t)(0xC0 | (cp >> 6));
+        out[1] = (uint8_t)(0x80 | (cp & 0x3F));
+        return 2;
+    } else if(cp < 0x10000) {
+        out[0] = (uint8_t)(0xE0 | (cp >> 12));
+        out[1] = (uint8_t)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (uint8_t)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (uint8_t)(0xF0 | (cp >> 18));
+    out[1] = (uint8_t)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (uint8_t)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (uint8_t)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+// Unescapes the body of a string into out, which must be at least (end - start) bytes long.
+// An escape sequence is never shorter than the UTF-8 it produces, so this always fits.
+static BOOL unescape_string(json_parser *ps, const uint8_t *start, const uint8_t *end, uint8_t *out, size_t *out_length) {
+    const uint8_t *q = start;
+    size_t n = 0;
+    
+    while(q < end) {
+        uint8_t c = *q++;
+        if(c != '\\') {
+            out[n++] = c;
+            continue;
+        }
+        
+        c = *q++;
+        switch (c) {
+            case '"':  out[n++] = '"'; break;
+            case '\\': out[n++] = '\\'; break;
+            case '/':  out[n++] = '/'; break;
+            case 'b':  out[n++] = '\b'; break;
+            case 'f':  out[n++] = '\f'; break;
+            case 'n':  out[n++] = '\n'; break;
+            case 'r':  out[n++] = '\r'; break;
+            case 't':  out[n++] = '\t'; break;
+            case 'u': {
+                uint32_t cp;
+                if(!parse_hex4(ps, q, &cp)) {
+                    return NO;
+                }
+                q += 4;
+                if(cp >= 0xD800 && cp <= 0xDBFF && end - q >= 6 && q[0] == '\\' && q[1] == 'u') {
+                    uint32_t low;
+                    if(!parse_hex4(ps, q + 2, &low)) {
+                        return NO;
+                    }
+                    if(low >= 0xDC00 && low <= 0xDFFF) {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                        q += 6;
+                    }
+                }
+                n += put_utf8(&out[n], cp);
+                break;
+            }
+            default:
+                ps->error = "Invalid escape sequence";
+                return NO;
+        }
+    }
+    *out_length = n;
+    
+    return YES;
+}
+
+// Finds the closing quote of the string starting at ps->p (just after the opening quote).
+// Returns NULL if the string is not terminated, and sets *escaped if any escapes were seen.
+static const uint8_t *scan_string(json_parser *ps, BOOL *escaped) {
+    const uint8_t *q = ps->p;
+    
+    *escaped = NO;
+    while(q < ps->end) {
+        uint8_t c = *q;
+        if(c == '"') {
+            return q;
+        }
+        if(c == '\\') {
+            *escaped = YES;
+            q += 2;
+        } else {
+            q++;
+        }
+    }
+    ps->error = "Unterminated string";
+    
+    return NULL;
+}
+
+static inline NSString *make_string(const uint8_t *bytes, size_t length, RethinkDBStringTable *table) {
+    if(table) {
+        return [table stringWithBytes: bytes length: length];
+    }
+    
+    return [[NSString alloc] initWithBytes: bytes length: length encoding: NSUTF8StringEncoding];
+}
+
+static NSString *parse_string(json_parser *ps, RethinkDBStringTable *table) {
+    BOOL escaped;
+    const uint8_t *start = ++ps->p;
+    const uint8_t *close = scan_string(ps, &escaped);
+    NSString *result;
+    
+    if(close == NULL) {
+        return nil;
+    }
+    ps->p = close + 1;
+    
+    if(close == start) {
+        return @"";
+    }
+    
+    if(!escaped) {
+        result = make_string(start, close - start, table);
+    } else {
+        uint8_t stack_buffer[STACK_STRING_SIZE];
+        size_t length = close - start;
+        uint8_t *buffer = length <= STACK_STRING_SIZE ? stack_buffer : malloc(length);
+        
+        if(unescape_string(ps, start, close, buffer, &length)) {
+            result = make_string(buffer, length, table);
+        } else {
+            result = nil;
+        }
+        if(buffer != stack_buffer) {
+            free(buffer);
+        }
+    }
+    
+    if(result == nil && ps->error == NULL) {
+        ps->error = "Invalid UTF-8 in string";
+    }
+    
+    return result;
+}
+
+// Reads a number into either integer or real, whichever integral says it is.
+static BOOL read_number(json_parser *ps, BOOL *integral, long long *integer, double *real) {
+    const uint8_t *start = ps->p;
+    const uint8_t *q = start;
+    
+    *integral = YES;
+    if(q < ps->end && *q == '-') {
+        q++;
+    }
+    while(q < ps->end) {
+        uint8_t c = *q;
+        if(c >= '0' && c <= '9') {
+            q++;
+        } else if(c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
+            *integral = NO;
+            q++;
+        } else {
+            break;
+        }
+    }
+    ps->p = q;
+    
+    size_t length = q - start;
+    if(length == 0 || (length == 1 && *start == '-')) {
+        ps->error = "Invalid number";
+        return NO;
+    }
+    
+    // anything that fits comfortably in 64 bits skips strtod
+    if(*integral && length <= 18) {
+        const uint8_t *d = start;
+        BOOL negative = (*d == '-');
+        long long value = 0;
+        
+        if(negative) {
+            d++;
+        }
+        while(d < q) {
+            value = value * 10 + (*d++ - '0');
+        }
+        *integer = negative ? -value : value;
+        
+        return YES;
+    }
+    *integral = NO;
+    
+    char stack_buffer[STACK_NUMBER_SIZE];
+    char *buffer = length < STACK_NUMBER_SIZE ? stack_buffer : malloc(length + 1);
+    memcpy(buffer, start, length);
+    buffer[length] = 0;
+    
+    char *parse_end;
+    *real = strtod(buffer, &parse_end);
+    BOOL ok = (parse_end == buffer + length);
+    if(buffer != stack_buffer) {
+        free(buffer);
+    }
+    
+    if(!ok) {
+        ps->error = "Invalid number";
+    }
+    
+    return ok;
+}
+
+static NSNumber *parse_number(json_parser *ps) {
+    BOOL integral;
+    long long integer;
+    double real;
+    
+    if(!read_number(ps, &integral, &integer, &real)) {
+        return nil;
+    }
+    
+    return integral ? [NSNumber numberWithLongLong: integer] : [NSNumber numberWithDouble: real];
+}
+
+static BOOL parse_literal(json_parser *ps, const char *literal, size_t length) {
+    if((size_t)(ps->end - ps->p) >= length && memcmp(ps->p, literal, length) == 0) {
+        ps->p += length;
+        return YES;
+    }
+    ps->error = "Invalid literal";
+    
+    return NO;
+}
+
+static NSMutableArray *parse_array(json_parser *ps) {
+    NSMutableArray *result = [NSMutableArray new];
+    
+    ps->p++;
+    skip_whitespace(ps);
+    if(ps->p < ps->end && *ps->p == ']') {
+        ps->p++;
+        return result;
+    }
+    
+    while(YES) {
+        id value = parse_value(ps);
+        if(value == nil) {
+            return nil;
+        }
+        [result addObject: value];
+        
+        skip_whitespace(ps);
+        if(ps->p >= ps->end) {
+            ps->error = "Unterminated array";
+            return nil;
+        }
+        if(*ps->p == ',') {
+            ps->p++;
+        } else if(*ps->p == ']') {
+            ps->p++;
+            return result;
+        } else {
+            ps->error = "Expected ',' or ']'";
+            return nil;
+        }
+    }
+}
+
+static NSMutableDictionary *parse_object(json_parser *ps) {
+    NSMutableDictionary *result = [NSMutableDictionary new];
+    NSMutableArray *ordered_keys = [NSMutableArray new];
+    
+    ps->p++;
+    skip_whitespace(ps);
+    if(ps->p < ps->end && *ps->p == '}') {
+        ps->p++;
+        [result setObject: ordered_keys forKey: kRethinkDbOrderedKeys];
+        return result;
+    }
+    
+    while(YES) {
+        skip_whitespace(ps);
+        if(ps->p >= ps->end || *ps->p != '"') {
+            ps->error = "Expected object key";
+            return nil;
+        }
+        NSString *key = parse_string(ps, ps->keys);
+        if(key == nil || !expect(ps, ':')) {
+            return nil;
+        }
+        id value = parse_value(ps);
+        if(value == nil) {
+            return nil;
+        }
+        [result setObject: value forKey: key];
+        [ordered_keys addObject: key];
+        
+        skip_whitespace(ps);
+        if(ps->p >= ps->end) {
+            ps->error = "Unterminated object";
+            return nil;
+        }
+        if(*ps->p == ',') {
+            ps->p++;
+        } else if(*ps->p == '}') {
+            ps->p++;
+            [result setObject: ordered_keys forKey: kRethinkDbOrderedKeys];
+            return result;
+        } else {
+            ps->error = "Expected ',' or '}'";
+            return nil;
+        }
+    }
+}
+
+// Moves past the object or array starting at ps->p without decoding it. Only the nesting is checked,
+// anything else that is malformed is reported when the lazy proxy decodes that part.
+static BOOL skip_container(json_parser *ps) {
+    const uint8_t *q = ps->p;
+    int depth = 0;
+    
+    while(q < ps->end) {
+        uint8_t c = *q++;
+        if(c == '"') {
+            BOOL escaped;
+            ps->p = q;
+            q = scan_string(ps, &escaped);
+            if(q == NULL) {
+                return NO;
+            }
+            q++;
+        } else if(c == '{' || c == '[') {
+            if(++depth > MAX_NESTING_DEPTH) {
+                ps->error = "Nesting too deep";
+                return NO;
+            }
+        } else if(c == '}' || c == ']') {
+            if(--depth == 0) {
+                ps->p = q;
+                return YES;
+            }
+        }
+    }
+    ps->error = "Unterminated container";
+    
+    return NO;
+}
+
+static id parse_lazy_container(json_parser *ps) {
+    const uint8_t *start = ps->p;
+    
+    if(!skip_container(ps)) {
+        return nil;
+    }
+    
+    NSRange range = NSMakeRange(start - ps->base, ps->p - start);
+    if(*start == '{') {
+        return [[RethinkDBLazyDictionary alloc] initWithBuffer: ps->lazy_buffer range: range];
+    }
+    
+    return [[RethinkDBLazyArray alloc] initWithBuffer: ps->lazy_buffer range: range];
+}
+
+static id parse_value(json_parser *ps) {
+    id result;
+    
+    skip_whitespace(ps);
+    if(ps->p >= ps->end) {
+        ps->error = "Unexpected end of data";
+        return nil;
+    }
+    
+    switch (*ps->p) {
+        case '{':
+        case '[':
+            if(ps->lazy_buffer) {
+                return parse_lazy_container(ps);
+            }
+            if(++ps->depth > MAX_NESTING_DEPTH) {
+                ps->error = "Nesting too deep";
+                return nil;
+            }
+            result = (*ps->p == '{') ? parse_object(ps) : parse_array(ps);
+            ps->depth--;
+            return result;
+        case '"':
+            return parse_string(ps, ps->values);
+        case 't':
+            return parse_literal(ps, "true", 4) ? (__bridge id)kCFBooleanTrue : nil;
+        case 'f':
+            return parse_literal(ps, "false", 5) ? (__bridge id)kCFBooleanFalse : nil;
+        case 'n':
+            return parse_literal(ps, "null", 4) ? [NSNull null] : nil;
+        default:
+            return parse_number(ps);
+    }
+}
+
+static NSError *make_error(json_parser *ps, const uint8_t *bytes) {
+    NSString *message = [NSString stringWithFormat: @"%s at offset %ld", ps->error ? ps->error : "Invalid JSON", (long)(ps->p - bytes)];
+    
+    return [NSError errorWithDomain: decoder_error code: -1 userInfo: [NSDictionary dictionaryWithObject: message forKey: NSLocalizedDescriptionKey]];
+}
+
+// Moves past any value without building it.
+static BOOL skip_value(json_parser *ps) {
+    BOOL escaped;
+    
+    skip_whitespace(ps);
+    if(ps->p >= ps->end) {
+        ps->error = "Unexpected end of data";
+        return NO;
+    }
+    
+    switch (*ps->p) {
+        case '{':
+        case '[':
+            return skip_container(ps);
+        case '"': {
+            ps->p++;
+            const uint8_t *close = scan_string(ps, &escaped);
+            if(close == NULL) {
+                return NO;
+            }
+            ps->p = close + 1;
+            return YES;
+        }
+        default:
+            // numbers and literals end at the next delimiter
+            while(ps->p < ps->end && *ps->p != ',' && *ps->p != '}' && *ps->p != ']' && *ps->p != ' ' && *ps->p != '\n' && *ps->p != '\r' && *ps->p != '\t') {
+                ps->p++;
+            }
+            return YES;
+    }
+}
+
+#pragma mark -
+#pragma mark Lazy containers
+
+@implementation RethinkDBLazyDictionary {
+    __strong NSData *buffer;
+    NSRange range;
+    pthread_mutex_t mutex;
+    // values decoded so far
+    __strong NSMutableDictionary *values;
+    // built the first time every key is needed, maps each key to the NSRange of its value
+    __strong NSMutableArray *keys;
+    __strong NSMutableDictionary *positions;
+}
+
+- (instancetype) initWithBuffer:(NSData*)aBuffer range:(NSRange)aRange {
+    self = [super init];
+    if(self) {
+        buffer = aBuffer;
+        range = aRange;
+        pthread_mutex_init(&mutex, NULL);
+    }
+    
+    return self;
+}
+
+- (void) dealloc {
+    pthread_mutex_destroy(&mutex);
+}
+
+- (json_parser) parser {
+    const uint8_t *base = [buffer bytes];
+    json_parser ps = { base + range.location, base + NSMaxRange(range), 0, NULL, buffer, base };
+    
+    return ps;
+}
+
+// Must be called with the mutex held.
+- (id) decodeAt:(NSRange)value_range {
+    json_parser ps = [self parser];
+    ps.p = ps.base + value_range.location;
+    ps.end = ps.base + NSMaxRange(value_range);
+    
+    return parse_value(&ps);
+}
+
+// Walks the keys in order, calling found with each key's bytes and the range of its value until it returns YES.
+// Must be called with the mutex held.
+- (BOOL) scanKeys:(BOOL (^)(const uint8_t *key, size_t length, BOOL escaped, NSRange value_range))found {
+    json_parser ps = [self parser];
+    
+    ps.p++;
+    skip_whitespace(&ps);
+    if(ps.p < ps.end && *ps.p == '}') {
+        return NO;
+    }
+    
+    while(YES) {
+        BOOL escaped;
+        
+        skip_whitespace(&ps);
+        if(ps.p >= ps.end || *ps.p != '"') {
+            return NO;
+        }
+        const uint8_t *key = ++ps.p;
+        const uint8_t *close = scan_string(&ps, &escaped);
+        if(close == NULL) {
+            return NO;
+        }
+        ps.p = close + 1;
+        if(!expect(&ps, ':')) {
+            return NO;
+        }
+        skip_whitespace(&ps);
+        const uint8_t *value = ps.p;
+        if(!skip_value(&ps)) {
+            return NO;
+        }
+        
+        if(found(key, close - key, escaped, NSMakeRange(value - ps.base, ps.p - value))) {
+            return YES;
+        }
+        
+        skip_whitespace(&ps);
+        if(ps.p >= ps.end || *ps.p != ',') {
+            return NO;
+        }
+        ps.p++;
+    }
+}
+
+// Must be called with the mutex held.
+- (void) buildIndex {
+    if(keys) {
+        return;
+    }
+    
+    keys = [NSMutableArray new];
+    positions = [NSMutableDictionary new];
+    [self scanKeys:^BOOL(const uint8_t *key, size_t length, BOOL escaped, NSRange value_range) {
+        json_parser ps = [self parser];
+        ps.p = key - 1;
+        NSString *name = parse_string(&ps, nil);
+        if(name) {
+            [keys addObject: name];
+            [positions setObject: [NSValue valueWithRange: value_range] forKey: name];
+        }
+        return NO;
+    }];
+}
+
+- (id) objectForKey:(id)aKey {
+    if([kRethinkDbOrderedKeys isEqual: aKey]) {
+        pthread_mutex_lock(&mutex);
+        [self buildIndex];
+        NSArray *result = [keys copy];
+        pthread_mutex_unlock(&mutex);
+        
+        return result;
+    }
+    if(![aKey isKindOfClass: [NSString class]]) {
+        return nil;
+    }
+    
+    pthread_mutex_lock(&mutex);
+    id result = [values objectForKey: aKey];
+    if(result == nil) {
+        __block NSRange value_range = NSMakeRange(NSNotFound, 0);
+        
+        if(keys) {
+            NSValue *position = [positions objectForKey: aKey];
+            if(position) {
+                value_range = [position rangeValue];
+            }
+        } else {
+            // compare the raw key bytes, nothing is decoded for the fields we pass over
+            NSData *wanted = [aKey dataUsingEncoding: NSUTF8StringEncoding];
+            const uint8_t *wanted_bytes = [wanted bytes];
+            size_t wanted_length = [wanted length];
+            
+            [self scanKeys:^BOOL(const uint8_t *key, size_t length, BOOL escaped, NSRange found_range) {
+                BOOL match;
+                if(escaped) {
+                    json_parser ps = [self parser];
+                    ps.p = key - 1;
+                    match = [parse_string(&ps, nil) isEqualToString: aKey];
+                } else {
+                    match = length == wanted_length && memcmp(key, wanted_bytes, length) == 0;
+                }
+                if(match) {
+                    value_range = found_range;
+                }
+                return match;
+            }];
+        }
+        
+        if(value_range.location != NSNotFound) {
+            result = [self decodeAt: value_range];
+            if(result) {
+                if(values == nil) {
+                    values = [NSMutableDictionary new];
+                }
+                [values setObject: result forKey: aKey];
+            }
+        }
+    }
+    pthread_mutex_unlock(&mutex);
+    
+    return result;
+}
+
+- (NSUInteger) count {
+    pthread_mutex_lock(&mutex);
+    [self buildIndex];
+    // the eager decoder stores the ordered key list in the dictionary too
+    NSUInteger result = [keys count] + 1;
+    pthread_mutex_unlock(&mutex);
+    
+    return result;
+}
+
+- (NSEnumerator*) keyEnumerator {
+    pthread_mutex_lock(&mutex);
+    [self buildIndex];
+    NSArray *result = [keys arrayByAddingObject: kRethinkDbOrderedKeys];
+    pthread_mutex_unlock(&mutex);
+    
+    return [result objectEnumerator];
+}
+
+- (id) copyWithZone:(NSZone *)zone {
+    return self;
+}
+
+@end
+
+@implementation RethinkDBLazyArray {
+    __strong NSData *buffer;
+    NSRange range;
+    pthread_mutex_t mutex;
+    // element ranges, found the first time the array is used
+    NSRange *elements;
+    NSUInteger element_count;
+    BOOL indexed;
+    __strong NSMutableArray *values;
+}
+
+- (instancetype) initWithBuffer:(NSData*)aBuffer range:(NSRange)aRange {
+    self = [super init];
+    if(self) {
+        buffer = aBuffer;
+        range = aRange;
+        pthread_mutex_init(&mutex, NULL);
+    }
+    
+    return self;
+}
+
+- (void) dealloc {
+    free(elements);
+    pthread_mutex_destroy(&mutex);
+}
+
+// Must be called with the mutex held.
+- (void) buildIndex {
+    if(indexed) {
+        return;
+    }
+    indexed = YES;
+    
+    const uint8_t *base = [buffer bytes];
+    json_parser ps = { base + range.location + 1, base + NSMaxRange(range), 0, NULL, buffer, base };
+    NSUInteger capacity = 0;
+    
+    skip_whitespace(&ps);
+    if(ps.p < ps.end && *ps.p == ']') {
+        return;
+    }
+    
+    while(YES) {
+        skip_whitespace(&ps);
+        const uint8_t *value = ps.p;
+        if(!skip_value(&ps)) {
+            break;
+        }
+        
+        if(element_count == capacity) {
+            capacity = capacity ? capacity * 2 : 8;
+            elements = realloc(elements, capacity * sizeof(NSRange));
+        }
+        elements[element_count++] = NSMakeRange(value - base, ps.p - value);
+        
+        skip_whitespace(&ps);
+        if(ps.p >= ps.end || *ps.p != ',') {
+            break;
+        }
+        ps.p++;
+    }
+    
+    values = [NSMutableArray arrayWithCapacity: element_count];
+    for(NSUInteger i = 0; i < element_count; i++) {
+        [values addObject: [NSNull null]];
+    }
+}
+
+- (NSUInteger) count {
+    pthread_mutex_lock(&mutex);
+    [self buildIndex];
+    NSUInteger result = element_count;
+    pthread_mutex_unlock(&mutex);
+    
+    return result;
+}
+
+- (id) objectAtIndex:(NSUInteger)index {
+    pthread_mutex_lock(&mutex);
+    [self buildIndex];
+    if(index >= element_count) {
+        pthread_mutex_unlock(&mutex);
+        @throw [NSException exceptionWithName: NSRangeException reason: [NSString stringWithFormat: @"index %lu beyond bounds [0 .. %ld]", (unsigned long)index, (long)element_count - 1] userInfo: nil];
+    }
+    
+    // decoded values replace their NSNull placeholder, a JSON null decodes to the same object
+    id result = [values objectAtIndex: index];
+    if(result == [NSNull null]) {
+        const uint8_t *base = [buffer bytes];
+        json_parser ps = { base + elements[index].location, base + NSMaxRange(elements[index]), 0, NULL, buffer, base };
+        result = parse_value(&ps);
+        if(result) {
+            [values replaceObjectAtIndex: index withObject: result];
+        } else {
+            result = [NSNull null];
+        }
+    }
+    pthread_mutex_unlock(&mutex);
+    
+    return result;
+}
+
+- (id) copyWithZone:(NSZone *)zone {
+    return self;
+}
+
+@end
+
+#pragma mark -
+#pragma mark Compact batches
+
+#define COMPACT_NO_KEY UINT32_MAX
+
+typedef struct {
+    RethinkDBCompactType type;
+    // the key of an object member, COMPACT_NO_KEY otherwise
+    uint32_t key;
+    // the bytes in a string or the members of an array or object
+    uint32_t length;
+    union {
+        int64_t integer;
+        double real;
+        // where a string's bytes start in strings
+        uint32_t offset;
+        // containers: the value after the last one inside them
+        uint32_t next;
+    };
+} compact_entry;
+
+typedef struct {
+    uint32_t offset;
+    uint32_t length;
+    uint32_t hash;
+} compact_key;
+
+typedef struct {
+    compact_entry *entries;
+    uint32_t entry_count;
+    uint32_t entry_capacity;
+    uint32_t *rows;
+    uint32_t row_count;
+    uint32_t row_capacity;
+    uint8_t *strings;
+    uint32_t string_length;
+    uint32_t string_capacity;
+    compact_key *keys;
+    uint32_t key_count;
+    uint32_t key_capacity;
+    // key number + 1 for every bucket in use
+    uint32_t *key_table;
+    uint32_t key_table_size;
+    __unsafe_unretained NSMutableArray *key_names;
+} compact_buffer;
+
+static BOOL compact_grow(json_parser *ps, void **items, uint32_t *capacity, uint64_t needed, size_t size) {
+    if(needed <= *capacity) {
+        return YES;
+    }
+    
+    uint64_t new_capacity = *capacity ? *capacity : 16;
+    while(new_capacity < needed) {
+        new_capacity *= 2;
+    }
+    
+    void *grown = new_capacity <= UINT32_MAX ? realloc(*items, (size_t)new_capacity * size) : NULL;
+    if(grown == NULL) {
+        ps->error = "Batch too large";
+        return NO;
+    }
+    *items = grown;
+    *capacity = (uint32_t)new_capacity;
+    
+    return YES;
+}
+
+static inline uint32_t compact_hash(const uint8_t *bytes, size_t length) {
+    uint32_t hash = 2166136261u;
+    
+    for(size_t i = 0; i < length; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    
+    return hash;
+}
+
+static uint32_t compact_find_key(compact_buffer *b, const uint8_t *bytes, size_t length, uint32_t hash, uint32_t *bucket) {
+    uint32_t mask = b->key_table_size - 1;
+    uint32_t i = hash & mask;
+    uint32_t slot;
+    
+    while((slot = b->key_table[i]) != 0) {
+        compact_key *key = &b->keys[slot - 1];
+        if(key->hash == hash && key->length == length && memcmp(b->strings + key->offset, bytes, length) == 0) {
+            return slot - 1;
+        }
+        i = (i + 1) & mask;
+    }
+    if(bucket) {
+        *bucket = i;
+    }
+    
+    return COMPACT_NO_KEY;
+}
+
+static BOOL compact_resize_keys(json_parser *ps, compact_buffer *b) {
+    uint32_t size = b->key_table_size ? b->key_table_size * 2 : 64;
+    uint32_t *table = calloc(size, sizeof(uint32_t));
+    
+    if(table == NULL) {
+        ps->error = "Batch too large";
+        return NO;
+    }
+    for(uint32_t k = 0; k < b->key_count; k++) {
+        uint32_t i = b->keys[k].hash & (size - 1);
+        while(table[i]) {
+            i = (i + 1) & (size - 1);
+        }
+        table[i] = k + 1;
+    }
+    free(b->key_table);
+    b->key_table = table;
+    b->key_table_size = size;
+    
+    return YES;
+}
+
+// Returns the number of the key with these bytes, adding it the first time it is seen.
+static uint32_t compact_intern(json_parser *ps, compact_buffer *b, const uint8_t *bytes, size_t length) {
+    uint32_t hash = compact_hash(bytes, length);
+    uint32_t bucket;
+    
+    if(b->key_count * 2 >= b->key_table_size && !compact_resize_keys(ps, b)) {
+        return COMPACT_NO_KEY;
+    }
+    
+    uint32_t found = compact_find_key(b, bytes, length, hash, &bucket);
+    if(found != COMPACT_NO_KEY) {
+        return found;
+    }
+    
+    NSString *name = make_string(bytes, length, ps->keys);
+    if(name == nil) {
+        ps->error = "Invalid UTF-8 in string";
+        return COMPACT_NO_KEY;
+    }
+    if(!compact_grow(ps, (void**)&b->keys, &b->key_capacity, (uint64_t)b->key_count + 1, sizeof(compact_key)) ||
+       !compact_grow(ps, (void**)&b->strings, &b->string_capacity, (uint64_t)b->string_length + length, 1)) {
+        return COMPACT_NO_KEY;
+    }
+    
+    compact_key *key = &b->keys[b->key_count];
+    key->offset = b->string_length;
+    key->length = (uint32_t)length;
+    key->hash = hash;
+    memcpy(b->strings + b->string_length, bytes, length);
+    b->string_length += length;
+    b->key_table[bucket] = ++b->key_count;
+    [b->key_names addObject: name];
+    
+    return b->key_count - 1;
+}
+
+static uint32_t compact_parse_key(json_parser *ps, compact_buffer *b) {
+    BOOL escaped;
+    const uint8_t *start = ++ps->p;
+    const uint8_t *close = scan_string(ps, &escaped);
+    
+    if(close == NULL) {
+        return COMPACT_NO_KEY;
+    }
+    ps->p = close + 1;
+    
+    size_t length = close - start;
+    if(!escaped) {
+        return compact_intern(ps, b, start, length);
+    }
+    
+    uint8_t stack_buffer[STACK_STRING_SIZE];
+    uint8_t *buffer = length <= STACK_STRING_SIZE ? stack_buffer : malloc(length);
+    uint32_t result = COMPACT_NO_KEY;
+    if(unescape_string(ps, start, close, buffer, &length)) {
+        result = compact_intern(ps, b, buffer, length);
+    }
+    if(buffer != stack_buffer) {
+        free(buffer);
+    }
+    
+    return result;
+}
+
+static BOOL compact_parse_string(json_parser *ps, compact_buffer *b, uint32_t index) {
+    BOOL escaped;
+    const uint8_t *start = ++ps->p;
+    const uint8_t *close = scan_string(ps, &escaped);
+    
+    if(close == NULL) {
+        return NO;
+    }
+    ps->p = close + 1;
+    
+    size_t length = close - start;
+    if(!compact_grow(ps, (void**)&b->strings, &b->string_capacity, (uint64_t)b->string_length + length, 1)) {
+        return NO;
+    }
+    if(escaped) {
+        if(!unescape_string(ps, start, close, b->strings + b->string_length, &length)) {
+            return NO;
+        }
+    } else {
+        memcpy(b->strings + b->string_length, start, length);
+    }
+    
+    compact_entry *entry = &b->entries[index];
+    entry->type = RethinkDBCompactString;
+    entry->length = (uint32_t)length;
+    entry->offset = b->string_length;
+    b->string_length += length;
+    
+    return YES;
+}
+
+static BOOL compact_parse_value(json_parser *ps, compact_buffer *b, uint32_t key);
+
+static BOOL compact_parse_container(json_parser *ps, compact_buffer *b, uint32_t index) {
+    BOOL object = *ps->p == '{';
+    uint8_t close = object ? '}' : ']';
+    uint32_t length = 0;
+    
+    if(++ps->depth > MAX_NESTING_DEPTH) {
+        ps->error = "Nesting too deep";
+        return NO;
+    }
+    
+    ps->p++;
+    skip_whitespace(ps);
+    if(ps->p < ps->end && *ps->p == close) {
+        ps->p++;
+    } else {
+        while(YES) {
+            uint32_t member_key = COMPACT_NO_KEY;
+            
+            if(object) {
+                skip_whitespace(ps);
+                if(ps->p >= ps->end || *ps->p != '"') {
+                    ps->error = "Expected object key";
+                    return NO;
+                }
+                member_key = compact_parse_key(ps, b);
+                if(member_key == COMPACT_NO_KEY || !expect(ps, ':')) {
+                    return NO;
+                }
+            }
+            if(!compact_parse_value(ps, b, member_key)) {
+                return NO;
+            }
+            length++;
+            
+            skip_whitespace(ps);
+            if(ps->p >= ps->end) {
+                ps->error = object ? "Unterminated object" : "Unterminated array";
+                return NO;
+            }
+            if(*ps->p == ',') {
+                ps->p++;
+            } else if(*ps->p == close) {
+                ps->p++;
+                break;
+            } else {
+                ps->error = object ? "Expected ',' or '}'" : "Expected ',' or ']'";
+                return NO;
+            }
+        }
+    }
+    ps->depth--;
+    
+    // the members may have moved the entries
+    compact_entry *entry = &b->entries[index];
+    entry->type = object ? RethinkDBCompactObject : RethinkDBCompactArray;
+    entry->length = length;
+    entry->next = b->entry_count;
+    
+    return YES;
+}
+
+static BOOL compact_parse_value(json_parser *ps, compact_buffer *b, uint32_t key) {
+    skip_whitespace(ps);
+    if(ps->p >= ps->end) {
+        ps->error = "Unexpected end of data";
+        return NO;
+    }
+    if(!compact_grow(ps, (void**)&b->entries, &b->entry_capacity, (uint64_t)b->entry_count + 1, sizeof(compact_entry))) {
+        return NO;
+    }
+    
+    uint32_t index = b->entry_count++;
+    compact_entry *entry = &b->entries[index];
+    entry->key = key;
+    entry->length = 0;
+    entry->integer = 0;
+    
+    switch (*ps->p) {
+        case '{':
+        case '[':
+            return compact_parse_container(ps, b, index);
+        case '"':
+            return compact_parse_string(ps, b, index);
+        case 't':
+            entry->type = RethinkDBCompactBoolean;
+            entry->integer = 1;
+            return parse_literal(ps, "true", 4);
+        case 'f':
+            entry->type = RethinkDBCompactBoolean;
+            return parse_literal(ps, "false", 5);
+        case 'n':
+            entry->type = RethinkDBCompactNull;
+            return parse_literal(ps, "null", 4);
+        default: {
+            BOOL integral;
+            long long integer;
+            double real;
+            
+            if(!read_number(ps, &integral, &integer, &real)) {
+                return NO;
+            }
+            if(integral) {
+                entry->type = RethinkDBCompactInteger;
+                entry->integer = integer;
+            } else {
+                entry->type = RethinkDBCompactDouble;
+                entry->real = real;
+            }
+            return YES;
+        }
+    }
+}
+
+static BOOL compact_parse_rows(json_parser *ps, compact_buffer *b) {
+    ps->p++;
+    skip_whitespace(ps);
+    if(ps->p < ps->end && *ps->p == ']') {
+        ps->p++;
+        return YES;
+    }
+    
+    while(YES) {
+        if(!compact_grow(ps, (void**)&b->rows, &b->row_capacity, (uint64_t)b->row_count + 1, sizeof(uint32_t))) {
+            return NO;
+        }
+        b->rows[b->row_count++] = b->entry_count;
+        if(!compact_parse_value(ps, b, COMPACT_NO_KEY)) {
+            return NO;
+        }
+        
+        skip_whitespace(ps);
+        if(ps->p >= ps->end) {
+            ps->error = "Unterminated array";
+            return NO;
+        }
+        if(*ps->p == ',') {
+            ps->p++;
+        } else if(*ps->p == ']') {
+            ps->p++;
+            return YES;
+        } else {
+            ps->error = "Expected ',' or ']'";
+            return NO;
+        }
+    }
+}
+
+@interface RethinkDBCompactBatch ()
+
+- (instancetype) initWithParser:(json_parser*)ps;
+
+@end
+
+@implementation RethinkDBCompactBatch {
+    compact_buffer buffer;
+    __strong NSMutableArray *key_names;
+}
+
+- (instancetype) initWithParser:(json_parser*)ps {
+    self = [super init];
+    if(self) {
+        key_names = [NSMutableArray new];
+        buffer.key_names = key_names;
+        
+        if(!compact_parse_rows(ps, &buffer)) {
+            return nil;
+        }
+    }
+    
+    return self;
+}
+
+- (void) dealloc {
+    free(buffer.entries);
+    free(buffer.rows);
+    free(buffer.strings);
+    free(buffer.keys);
+    free(buffer.key_table);
+}
+
+static inline compact_entry *compact_entry_at(compact_buffer *b, NSUInteger value) {
+    if(value >= b->entry_count) {
+        @throw [NSException exceptionWithName: NSRangeException reason: [NSString stringWithFormat: @"value %lu beyond bounds [0 .. %ld]", (unsigned long)value, (long)b->entry_count - 1] userInfo: nil];
+    }
+    
+    return &b->entries[value];
+}
+
+static inline uint32_t compact_next(compact_buffer *b, uint32_t value) {
+    compact_entry *entry = &b->entries[value];
+    
+    return (entry->type == RethinkDBCompactArray || entry->type == RethinkDBCompactObject) ? entry->next : value + 1;
+}
+
+- (NSUInteger) count {
+    return buffer.row_count;
+}
+
+- (id) objectAtIndex:(NSUInteger)index {
+    return [self objectForValue: [self valueForRow: index]];
+}
+
+- (id) copyWithZone:(NSZone *)zone {
+    return self;
+}
+
+- (NSUInteger) valueForRow:(NSUInteger)row {
+    if(row >= buffer.row_count) {
+        @throw [NSException exceptionWithName: NSRangeException reason: [NSString stringWithFormat: @"index %lu beyond bounds [0 .. %ld]", (unsigned long)row, (long)buffer.row_count - 1] userInfo: nil];
+    }
+    
+    return buffer.rows[row];
+}
+
+- (RethinkDBCompactType) typeOfValue:(NSUInteger)value {
+    return compact_entry_at(&buffer, value)->type;
+}
+
+- (NSUInteger) lengthOfValue:(NSUInteger)value {
+    return compact_entry_at(&buffer, value)->length;
+}
+
+- (BOOL) boolForValue:(NSUInteger)value {
+    compact_entry *entry = compact_entry_at(&buffer, value);
+    
+    return entry->type == RethinkDBCompactBoolean && entry->integer != 0;
+}
+
+- (int64_t) integerForValue:(NSUInteger)value {
+    compact_entry *entry = compact_entry_at(&buffer, value);
+    
+    switch (entry->type) {
+        case RethinkDBCompactBoolean:
+        case RethinkDBCompactInteger:
+            return entry->integer;
+        case RethinkDBCompactDouble:
+            return (int64_t)entry->real;
+        default:
+            return 0;
+    }
+}
+
+- (double) doubleForValue:(NSUInteger)value {
+    compact_entry *entry = compact_entry_at(&buffer, value);
+    
+    switch (entry->type) {
+        case RethinkDBCompactBoolean:
+        case RethinkDBCompactInteger:
+            return (double)entry->integer;
+        case RethinkDBCompactDouble:
+            return entry->real;
+        default:
+            return 0;
+    }
+}
+
+- (const char*) bytesOfString:(NSUInteger)value length:(NSUInteger*)length {
+    compact_entry *entry = compact_entry_at(&buffer, value);
+    
+    if(entry->type != RethinkDBCompactString) {
+        *length = 0;
+        return NULL;
+    }
+    *length = entry->length;
+    
+    return (const char*)buffer.strings + entry->offset;
+}
+
+- (id) objectForValue:(NSUInteger)value {
+    compact_entry *entry = compact_entry_at(&buffer, value);
+    
+    switch (entry->type) {
+        case RethinkDBCompactNull:
+            return [NSNull null];
+        case RethinkDBCompactBoolean:
+            return (__bridge id)(entry->integer ? kCFBooleanTrue : kCFBooleanFalse);
+        case RethinkDBCompactInteger:
+            return [NSNumber numberWithLongLong: entry->integer];
+        case RethinkDBCompactDouble:
+            return [NSNumber numberWithDouble: entry->real];
+        case RethinkDBCompactString: {
+            // strings are not checked while the batch is parsed
+            NSString *result = [[NSString alloc] initWithBytes: buffer.strings + entry->offset length: entry->length encoding: NSUTF8StringEncoding];
+            return result ? result : [NSNull null];
+        }
+        case RethinkDBCompactArray: {
+            NSMutableArray *result = [NSMutableArray arrayWithCapacity: entry->length];
+            uint32_t member = (uint32_t)value + 1;
+            for(uint32_t i = 0; i < entry->length; i++) {
+                [result addObject: [self objectForValue: member]];
+                member = compact_next(&buffer, member);
+            }
+            return result;
+        }
+        case RethinkDBCompactObject: {
+            NSMutableDictionary *result = [NSMutableDictionary dictionaryWithCapacity: entry->length + 1];
+            NSMutableArray *ordered_keys = [NSMutableArray arrayWithCapacity: entry->length];
+            uint32_t member = (uint32_t)value + 1;
+            for(uint32_t i = 0; i < entry->length; i++) {
+                NSString *key = [key_names objectAtIndex: buffer.entries[member].key];
+                [result setObject: [self objectForValue: member] forKey: key];
+                [ordered_keys addObject: key];
+                member = compact_next(&buffer, member);
+            }
+            [result setObject: ordered_keys forKey: kRethinkDbOrderedKeys];
+            return result;
+        }
+    }
+    
+    return nil;
+}
+
+- (NSUInteger) keyCount {
+    return buffer.key_count;
+}
+
+- (NSString*) keyAtIndex:(NSUInteger)key {
+    return [key_names objectAtIndex: key];
+}
+
+- (NSUInteger) indexOfKey:(NSString*)key {
+    if(buffer.key_count == 0) {
+        return NSNotFound;
+    }
+    
+    const char *bytes = [key UTF8String];
+    size_t length = strlen(bytes);
+    uint32_t found = compact_find_key(&buffer, (const uint8_t*)bytes, length, compact_hash((const uint8_t*)bytes, length), NULL);
+    
+    return found == COMPACT_NO_KEY ? NSNotFound : found;
+}
+
+- (NSUInteger) memberWithKey:(NSUInteger)key inObject:(NSUInteger)object {
+    compact_entry *entry = compact_entry_at(&buffer, object);
+    
+    if(entry->type == RethinkDBCompactObject) {
+        uint32_t member = (uint32_t)object + 1;
+        for(uint32_t i = 0; i < entry->length; i++) {
+            if(buffer.entries[member].key == key) {
+                return member;
+            }
+            member = compact_next(&buffer, member);
+        }
+    }
+    
+    return NSNotFound;
+}
+
+- (NSUInteger) memberAtIndex:(NSUInteger)index ofValue:(NSUInteger)value {
+    compact_entry *entry = compact_entry_at(&buffer, value);
+    
+    if((entry->type != RethinkDBCompactArray && entry->type != RethinkDBCompactObject) || index >= entry->length) {
+        @throw [NSException exceptionWithName: NSRangeException reason: [NSString stringWithFormat: @"member %lu of a value without that many members", (unsigned long)index] userInfo: nil];
+    }
+    
+    uint32_t member = (uint32_t)value + 1;
+    while(index--) {
+        member = compact_next(&buffer, member);
+    }
+    
+    return member;
+}
+
+- (void) enumerateMembersOfValue:(NSUInteger)value usingBlock:(void (^)(NSUInteger key, NSUInteger member, BOOL *stop))block {
+    compact_entry *entry = compact_entry_at(&buffer, value);
+    BOOL stop = NO;
+    
+    if(entry->type != RethinkDBCompactArray && entry->type != RethinkDBCompactObject) {
+        return;
+    }
+    
+    uint32_t member = (uint32_t)value + 1;
+    for(uint32_t i = 0; i < entry->length && !stop; i++) {
+        uint32_t key = buffer.entries[member].key;
+        block(key == COMPACT_NO_KEY ? NSNotFound : key, member, &stop);
+        member = compact_next(&buffer, member);
+    }
+}
+
+@end
+
+#pragma mark -
+
+@implementation RethinkDBJSONDecoder
+
+- (id) decodeValue:(const uint8_t*)bytes length:(NSUInteger)length error:(NSError**)error {
+    json_parser ps = { bytes, bytes + length, 0, NULL };
+    id result = parse_value(&ps);
+    
+    if(result == nil) {
+        if(error) *error = make_error(&ps, bytes);
+    }
+    
+    return result;
+}
+
+- (RethinkDBResponse*) decodeResponse:(const uint8_t*)bytes length:(NSUInteger)length token:(int64_t)token error:(NSError**)error {
+    json_parser ps = { bytes, bytes + length, 0, NULL };
+    RethinkDBStringTable *key_table = self.keyTable;
+    RethinkDBStringTable *value_table = self.valueTable;
+    ps.keys = key_table;
+    ps.values = value_table;
+    Response_ResponseType type = 0;
+    NSArray *results = nil;
+    NSMutableArray *notes = nil;
+    
+    if(!expect(&ps, '{')) {
+        goto fail;
+    }
+    
+    skip_whitespace(&ps);
+    if(ps.p < ps.end && *ps.p == '}') {
+        ps.p++;
+    } else {
+        while(YES) {
+            BOOL escaped;
+            
+            skip_whitespace(&ps);
+            if(ps.p >= ps.end || *ps.p != '"') {
+                ps.error = "Expected object key";
+                goto fail;
+            }
+            
+            // the envelope keys are single characters, so compare the raw bytes
+            const uint8_t *key = ++ps.p;
+            const uint8_t *close = scan_string(&ps, &escaped);
+            if(close == NULL) {
+                goto fail;
+            }
+            ps.p = close + 1;
+            uint8_t key_char = (close - key == 1 && !escaped) ? key[0] : 0;
+            
+            if(!expect(&ps, ':')) {
+                goto fail;
+            }
+            skip_whitespace(&ps);
+            
+            if(key_char == 'r' && ps.p < ps.end && *ps.p == '[' && _compactRows) {
+                results = [[RethinkDBCompactBatch alloc] initWithParser: &ps];
+                if(results == nil) {
+                    goto fail;
+                }
+            } else if(key_char == 'r' && ps.p < ps.end && *ps.p == '[') {
+                NSData *lazy_buffer = nil;
+                if(_lazyRows) {
+                    // the frame lives in the connection's receive buffer, so the rows keep their own copy
+                    lazy_buffer = [NSData dataWithBytes: bytes length: length];
+                    ps.p = (const uint8_t*)[lazy_buffer bytes] + (ps.p - bytes);
+                    ps.end = (const uint8_t*)[lazy_buffer bytes] + length;
+                    ps.base = [lazy_buffer bytes];
+                    ps.lazy_buffer = lazy_buffer;
+                }
+                results = parse_array(&ps);
+                if(lazy_buffer) {
+                    ps.p = bytes + (ps.p - ps.base);
+                    ps.end = bytes + length;
+                    ps.lazy_buffer = nil;
+                }
+                if(results == nil) {
+                    goto fail;
+                }
+            } else if(key_char == 'n' && ps.p < ps.end && *ps.p == '[') {
+                notes = parse_array(&ps);
+                if(notes == nil) {
+                    goto fail;
+                }
+            } else {
+                id value = parse_value(&ps);
+                if(value == nil) {
+                    goto fail;
+                }
+                if(key_char == 't') {
+                    type = [value intValue];
+                }
+            }
+            
+            skip_whitespace(&ps);
+            if(ps.p >= ps.end) {
+                ps.error = "Unterminated response";
+                goto fail;
+            }
+            if(*ps.p == ',') {
+                ps.p++;
+            } else if(*ps.p == '}') {
+                ps.p++;
+                break;
+            } else {
+                ps.error = "Expected ',' or '}'";
+                goto fail;
+            }
+        }
+    }
+    
+    return [[RethinkDBResponse alloc] initWithToken: token type: type results: results notes: notes];
+    
+fail:
+    if(error) *error = make_error(&ps, bytes);
+    return nil;
+}
+
+@end
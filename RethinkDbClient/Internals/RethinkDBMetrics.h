@@ -0,0 +1,85 @@
+//
+//  RethinkDBMetrics.h
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright (c) 2026 Daniel Parnell
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#ifndef RethinkDbClient_RethinkDBMetrics_h
+#define RethinkDbClient_RethinkDBMetrics_h
+
+#import <Foundation/Foundation.h>
+#include <stdatomic.h>
+#include <mach/mach_time.h>
+#import "RethinkDbClient.h"
+
+// Values below 2^SUB_BUCKET_BITS get a bucket each, after that every power of two is split into
+// 2^SUB_BUCKET_BITS buckets. Anything above 2^MAX_BITS nanoseconds (about 18 minutes) lands in the last one.
+#define RETHINKDB_HISTOGRAM_SUB_BUCKET_BITS 4
+#define RETHINKDB_HISTOGRAM_MAX_BITS 40
+#define RETHINKDB_HISTOGRAM_BUCKETS ((RETHINKDB_HISTOGRAM_MAX_BITS - RETHINKDB_HISTOGRAM_SUB_BUCKET_BITS + 2) << RETHINKDB_HISTOGRAM_SUB_BUCKET_BITS)
+
+// Written with relaxed atomics from whichever thread is timing something, read by snapshots.
+typedef struct rethinkdb_histogram {
+    _Atomic uint64_t counts[RETHINKDB_HISTOGRAM_BUCKETS];
+    _Atomic uint64_t count;
+    _Atomic uint64_t sum;
+    _Atomic uint64_t maximum;
+} rethinkdb_histogram;
+
+typedef struct rethinkdb_metrics {
+    rethinkdb_histogram phases[RethinkDBLatencyPhaseCount];
+    _Atomic uint64_t queries_sent;
+    _Atomic uint64_t responses_received;
+    _Atomic uint64_t bytes_sent;
+    _Atomic uint64_t bytes_received;
+} rethinkdb_metrics;
+
+rethinkdb_metrics* rethinkdb_metrics_create(void);
+void rethinkdb_metrics_free(rethinkdb_metrics* metrics);
+void rethinkdb_metrics_reset(rethinkdb_metrics* metrics);
+// records the time since start, which came from rethinkdb_metrics_now
+void rethinkdb_metrics_record(rethinkdb_metrics* metrics, RethinkDBLatencyPhase phase, uint64_t start);
+void rethinkdb_metrics_record_between(rethinkdb_metrics* metrics, RethinkDBLatencyPhase phase, uint64_t start, uint64_t end);
+
+static inline uint64_t rethinkdb_metrics_now(void) {
+    return mach_absolute_time();
+}
+
+static inline void rethinkdb_metrics_count(_Atomic uint64_t* counter, uint64_t amount) {
+    atomic_fetch_add_explicit(counter, amount, memory_order_relaxed);
+}
+
+@interface RethinkDBMetrics ()
+
+- (instancetype) initWithMetrics:(rethinkdb_metrics*)metrics inFlightCount:(NSUInteger)inFlightCount openCursorCount:(NSUInteger)openCursorCount bufferedBatchBytes:(NSUInteger)bufferedBatchBytes;
+// an empty snapshot for a pool to add its connections to
+- (instancetype) init;
+- (void) addMetrics:(RethinkDBMetrics*)metrics;
+
+@end
+
+#endif
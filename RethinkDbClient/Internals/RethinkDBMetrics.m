@@ -0,0 +1,252 @@
+//
+//  RethinkDBMetrics.m
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright (c) 2026 Daniel Parnell
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#import "RethinkDBMetrics.h"
+
+static mach_timebase_info_data_t timebase;
+
+static inline NSUInteger bucket_for_value(uint64_t value) {
+    if(value < (1 << RETHINKDB_HISTOGRAM_SUB_BUCKET_BITS)) {
+        return (NSUInteger)value;
+    }
+    if(value >= (1ULL << RETHINKDB_HISTOGRAM_MAX_BITS)) {
+        return RETHINKDB_HISTOGRAM_BUCKETS - 1;
+    }
+    
+    int top_bit = 63 - __builtin_clzll(value);
+    int shift = top_bit - RETHINKDB_HISTOGRAM_SUB_BUCKET_BITS;
+    NSUInteger sub_bucket = (NSUInteger)(value >> shift) & ((1 << RETHINKDB_HISTOGRAM_SUB_BUCKET_BITS) - 1);
+    
+    return ((NSUInteger)(shift + 1) << RETHINKDB_HISTOGRAM_SUB_BUCKET_BITS) + sub_bucket;
+}
+
+// the smallest and largest values that land in a bucket
+static inline uint64_t bucket_lowest(NSUInteger bucket) {
+    NSUInteger group = bucket >> RETHINKDB_HISTOGRAM_SUB_BUCKET_BITS;
+    if(group == 0) {
+        return bucket;
+    }
+    
+    uint64_t sub_bucket = bucket & ((1 << RETHINKDB_HISTOGRAM_SUB_BUCKET_BITS) - 1);
+    return ((1ULL << RETHINKDB_HISTOGRAM_SUB_BUCKET_BITS) + sub_bucket) << (group - 1);
+}
+
+static inline uint64_t bucket_highest(NSUInteger bucket) {
+    NSUInteger group = bucket >> RETHINKDB_HISTOGRAM_SUB_BUCKET_BITS;
+    if(group == 0) {
+        return bucket;
+    }
+    
+    return bucket_lowest(bucket) + (1ULL << (group - 1)) - 1;
+}
+
+rethinkdb_metrics* rethinkdb_metrics_create(void) {
+    static dispatch_once_t timebase_once;
+    dispatch_once(&timebase_once, ^{
+        mach_timebase_info(&timebase);
+    });
+    
+    return calloc(1, sizeof(rethinkdb_metrics));
+}
+
+void rethinkdb_metrics_free(rethinkdb_metrics* metrics) {
+    free(metrics);
+}
+
+void rethinkdb_metrics_reset(rethinkdb_metrics* metrics) {
+    for(NSUInteger i = 0; i < RethinkDBLatencyPhaseCount; i++) {
+        rethinkdb_histogram* histogram = &metrics->phases[i];
+        for(NSUInteger b = 0; b < RETHINKDB_HISTOGRAM_BUCKETS; b++) {
+            atomic_store_explicit(&histogram->counts[b], 0, memory_order_relaxed);
+        }
+        atomic_store_explicit(&histogram->count, 0, memory_order_relaxed);
+        atomic_store_explicit(&histogram->sum, 0, memory_order_relaxed);
+        atomic_store_explicit(&histogram->maximum, 0, memory_order_relaxed);
+    }
+    atomic_store_explicit(&metrics->queries_sent, 0, memory_order_relaxed);
+    atomic_store_explicit(&metrics->responses_received, 0, memory_order_relaxed);
+    atomic_store_explicit(&metrics->bytes_sent, 0, memory_order_relaxed);
+    atomic_store_explicit(&metrics->bytes_received, 0, memory_order_relaxed);
+}
+
+void rethinkdb_metrics_record(rethinkdb_metrics* metrics, RethinkDBLatencyPhase phase, uint64_t start) {
+    rethinkdb_metrics_record_between(metrics, phase, start, mach_absolute_time());
+}
+
+void rethinkdb_metrics_record_between(rethinkdb_metrics* metrics, RethinkDBLatencyPhase phase, uint64_t start, uint64_t end) {
+    uint64_t elapsed = end > start ? (end - start) * timebase.numer / timebase.denom : 0;
+    rethinkdb_histogram* histogram = &metrics->phases[phase];
+    
+    atomic_fetch_add_explicit(&histogram->counts[bucket_for_value(elapsed)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->sum, elapsed, memory_order_relaxed);
+    
+    uint64_t maximum = atomic_load_explicit(&histogram->maximum, memory_order_relaxed);
+    while(elapsed > maximum && !atomic_compare_exchange_weak_explicit(&histogram->maximum, &maximum, elapsed, memory_order_relaxed, memory_order_relaxed)) {
+        // maximum now holds the value another thread stored, try again
+    }
+}
+
+#pragma mark -
+#pragma mark Snapshots
+
+@interface RethinkDBLatencyHistogram ()
+
+- (instancetype) initWithHistogram:(rethinkdb_histogram*)histogram;
+- (void) addHistogram:(RethinkDBLatencyHistogram*)other;
+
+@end
+
+@implementation RethinkDBLatencyHistogram {
+    uint64_t counts[RETHINKDB_HISTOGRAM_BUCKETS];
+    uint64_t sum;
+}
+
+- (instancetype) initWithHistogram:(rethinkdb_histogram*)histogram {
+    self = [super init];
+    if (self) {
+        if(histogram) {
+            for(NSUInteger b = 0; b < RETHINKDB_HISTOGRAM_BUCKETS; b++) {
+                counts[b] = atomic_load_explicit(&histogram->counts[b], memory_order_relaxed);
+                // the buckets are read one at a time, so count them rather than trusting the total
+                _count += counts[b];
+            }
+            sum = atomic_load_explicit(&histogram->sum, memory_order_relaxed);
+            _maximum = atomic_load_explicit(&histogram->maximum, memory_order_relaxed);
+        }
+    }
+    return self;
+}
+
+- (void) addHistogram:(RethinkDBLatencyHistogram*)other {
+    for(NSUInteger b = 0; b < RETHINKDB_HISTOGRAM_BUCKETS; b++) {
+        counts[b] += other->counts[b];
+    }
+    _count += other->_count;
+    sum += other->sum;
+    _maximum = MAX(_maximum, other->_maximum);
+}
+
+- (uint64_t) minimum {
+    for(NSUInteger b = 0; b < RETHINKDB_HISTOGRAM_BUCKETS; b++) {
+        if(counts[b]) {
+            return bucket_lowest(b);
+        }
+    }
+    
+    return 0;
+}
+
+- (double) mean {
+    return _count ? (double)sum / _count : 0;
+}
+
+- (uint64_t) valueAtPercentile:(double)percentile {
+    if(_count == 0) {
+        return 0;
+    }
+    
+    uint64_t wanted = (uint64_t)ceil(_count * MIN(MAX(percentile, 0), 100) / 100.0);
+    uint64_t seen = 0;
+    for(NSUInteger b = 0; b < RETHINKDB_HISTOGRAM_BUCKETS; b++) {
+        seen += counts[b];
+        if(seen >= MAX(wanted, 1)) {
+            return MIN(bucket_highest(b), _maximum);
+        }
+    }
+    
+    return _maximum;
+}
+
+- (NSString*) description {
+    return [NSString stringWithFormat: @"<RethinkDBLatencyHistogram count: %llu mean: %.0fns p50: %lluns p99: %lluns max: %lluns>",
+            _count, self.mean, [self valueAtPercentile: 50], [self valueAtPercentile: 99], _maximum];
+}
+
+@end
+
+@implementation RethinkDBMetrics {
+    __strong NSArray *histograms;
+}
+
+- (instancetype) initWithMetrics:(rethinkdb_metrics*)metrics inFlightCount:(NSUInteger)inFlightCount openCursorCount:(NSUInteger)openCursorCount bufferedBatchBytes:(NSUInteger)bufferedBatchBytes {
+    self = [super init];
+    if (self) {
+        NSMutableArray *phases = [NSMutableArray arrayWithCapacity: RethinkDBLatencyPhaseCount];
+        for(NSUInteger i = 0; i < RethinkDBLatencyPhaseCount; i++) {
+            [phases addObject: [[RethinkDBLatencyHistogram alloc] initWithHistogram: metrics ? &metrics->phases[i] : NULL]];
+        }
+        histograms = phases;
+        
+        if(metrics) {
+            _queriesSent = atomic_load_explicit(&metrics->queries_sent, memory_order_relaxed);
+            _responsesReceived = atomic_load_explicit(&metrics->responses_received, memory_order_relaxed);
+            _bytesSent = atomic_load_explicit(&metrics->bytes_sent, memory_order_relaxed);
+            _bytesReceived = atomic_load_explicit(&metrics->bytes_received, memory_order_relaxed);
+        }
+        _inFlightCount = inFlightCount;
+        _openCursorCount = openCursorCount;
+        _bufferedBatchBytes = bufferedBatchBytes;
+    }
+    return self;
+}
+
+- (instancetype) init {
+    return [self initWithMetrics: NULL inFlightCount: 0 openCursorCount: 0 bufferedBatchBytes: 0];
+}
+
+- (void) addMetrics:(RethinkDBMetrics*)metrics {
+    for(NSUInteger i = 0; i < RethinkDBLatencyPhaseCount; i++) {
+        [[histograms objectAtIndex: i] addHistogram: [metrics->histograms objectAtIndex: i]];
+    }
+    _queriesSent += metrics.queriesSent;
+    _responsesReceived += metrics.responsesReceived;
+    _bytesSent += metrics.bytesSent;
+    _bytesReceived += metrics.bytesReceived;
+    _inFlightCount += metrics.inFlightCount;
+    _openCursorCount += metrics.openCursorCount;
+    _bufferedBatchBytes += metrics.bufferedBatchBytes;
+}
+
+- (RethinkDBLatencyHistogram*) histogramForPhase:(RethinkDBLatencyPhase)phase {
+    if(phase < 0 || phase >= RethinkDBLatencyPhaseCount) {
+        return nil;
+    }
+    
+    return [histograms objectAtIndex: phase];
+}
+
+- (NSString*) description {
+    return [NSString stringWithFormat: @"<RethinkDBMetrics queries: %llu responses: %llu sent: %llu bytes received: %llu bytes in flight: %lu cursors: %lu buffered: %lu bytes round trip: %@>",
+            _queriesSent, _responsesReceived, _bytesSent, _bytesReceived, (unsigned long)_inFlightCount, (unsigned long)_openCursorCount, (unsigned long)_bufferedBatchBytes,
+            [self histogramForPhase: RethinkDBLatencyRoundTrip]];
+}
+
+@end
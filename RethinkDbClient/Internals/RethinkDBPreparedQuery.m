@@ -0,0 +1,69 @@
+//
+//  RethinkDBPreparedQuery.m
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright (c) 2026 Daniel Parnell
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#import <Foundation/Foundation.h>
+#import "RethinkDbClient.h"
+#import "RethinkDBClient-Private.h"
+#import "RethinkDBPreparedQuery-Private.h"
+
+@implementation RethinkDBPreparedQuery {
+    __strong RethinkDbClient *client;
+    __strong RethinkDBQueryTemplate *query_template;
+}
+
+- (instancetype) initWithClient:(RethinkDbClient*)aClient template:(RethinkDBQueryTemplate*)aTemplate {
+    self = [super init];
+    if(self) {
+        client = aClient;
+        query_template = aTemplate;
+    }
+    
+    return self;
+}
+
+- (NSUInteger) placeholderCount {
+    return query_template.placeholderCount;
+}
+
+- (RethinkDBOperation*) runWithValues:(NSArray*)values then:(RethinkDbSuccessBlock)success fail:(RethinkDbErrorBlock)error {
+    size_t length;
+    // the bytes live in this thread's encoding buffer, runEncoded: copies them before returning
+    const uint8_t *bytes = [query_template encodeWithValues: values length: &length];
+    
+    return [client runEncoded: bytes length: length then: success fail: error];
+}
+
+- (id) runWithValues:(NSArray*)values error:(NSError**)error {
+    return [client waitFor:^RethinkDBOperation *(RethinkDbSuccessBlock success, RethinkDbErrorBlock fail) {
+        return [self runWithValues: values then: success fail: fail];
+    } error: error];
+}
+
+@end
@@ -0,0 +1,55 @@
+//
+//  RethinkDBResponse.h
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright (c) 2026 Daniel Parnell
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef RethinkDbClient_RethinkDBResponse_h
+#define RethinkDbClient_RethinkDBResponse_h
+
+#import <Foundation/Foundation.h>
+#import "Ql2.pb.h"
+
+// A server response whose results have already been decoded into Foundation objects.
+// Both the JSON and the protocol buffer wire formats are turned into one of these
+// before they are handed to operations and cursors.
+@interface RethinkDBResponse : NSObject
+
+- (instancetype) initWithToken:(int64_t)token type:(Response_ResponseType)type results:(NSArray*)results notes:(NSArray*)notes;
+
+@property (readonly) int64_t token;
+@property (readonly) Response_ResponseType type;
+@property (readonly, strong) NSArray *results;
+@property (readonly, strong) NSArray *notes;
+// the size of the response on the wire, 0 when it is not known
+@property (assign) NSUInteger length;
+
+- (BOOL) isError;
+- (BOOL) hasNote:(Response_ResponseNote)note;
+
+@end
+
+#endif
@@ -0,0 +1,63 @@
+//
+//  RethinkDBResponse.m
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright (c) 2026 Daniel Parnell
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#import "RethinkDBResponse.h"
+
+@implementation RethinkDBResponse
+
+- (instancetype) initWithToken:(int64_t)token type:(Response_ResponseType)type results:(NSArray*)results notes:(NSArray*)notes {
+    self = [super init];
+    if (self) {
+        _token = token;
+        _type = type;
+        _results = results ? results : [NSArray array];
+        _notes = notes ? notes : [NSArray array];
+    }
+    return self;
+}
+
+- (BOOL) isError {
+    return _type == Response_ResponseTypeClientError || _type == Response_ResponseTypeCompileError || _type == Response_ResponseTypeRuntimeError;
+}
+
+- (BOOL) hasNote:(Response_ResponseNote)note {
+    for (NSNumber *n in _notes) {
+        if([n intValue] == note) {
+            return YES;
+        }
+    }
+    
+    return NO;
+}
+
+- (NSString*) description {
+    return [NSString stringWithFormat: @"<RethinkDBResponse token: %lld type: %d notes: %@ results: %@>", _token, _type, _notes, _results];
+}
+
+@end
@@ -0,0 +1,54 @@
+//
+//  RethinkDBStringTable.h
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright (c) 2026 Daniel Parnell
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#ifndef RethinkDbClient_RethinkDBStringTable_h
+#define RethinkDbClient_RethinkDBStringTable_h
+
+#import <Foundation/Foundation.h>
+
+// A fixed size cache of immutable strings looked up by their UTF-8 bytes, so that field names and other
+// strings that keep coming back share one instance. Each set of bytes can live in one of two slots and a miss
+// replaces the older one, which keeps the table at its capacity no matter how many different strings it sees.
+// Not thread safe, a table belongs to one connection's decoder.
+@interface RethinkDBStringTable : NSObject
+
+- (instancetype) initWithCapacity:(NSUInteger)capacity maximumLength:(NSUInteger)maximumLength;
+
+// nil when the bytes are not valid UTF-8. Strings longer than maximumLength are returned without being cached.
+- (NSString*) stringWithBytes:(const uint8_t*)bytes length:(NSUInteger)length;
+
+@property (readonly) NSUInteger capacity;
+@property (readonly) NSUInteger maximumLength;
+@property (readonly) uint64_t hits;
+@property (readonly) uint64_t misses;
+
+@end
+
+#endif
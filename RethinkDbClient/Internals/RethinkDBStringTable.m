@@ -0,0 +1,124 @@
+//
+//  RethinkDBStringTable.m
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright (c) 2026 Daniel Parnell
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#import "RethinkDBStringTable.h"
+
+typedef struct {
+    uint32_t hash;
+    uint32_t length;
+    CFStringRef string;
+} string_slot;
+
+@implementation RethinkDBStringTable {
+    string_slot *slots;
+    // maximumLength bytes for each slot
+    uint8_t *slot_bytes;
+    NSUInteger mask;
+}
+
+- (instancetype) initWithCapacity:(NSUInteger)capacity maximumLength:(NSUInteger)maximumLength {
+    self = [super init];
+    if (self) {
+        // a power of two, with room for the two slots of a bucket
+        NSUInteger size = 2;
+        while(size < capacity) {
+            size *= 2;
+        }
+        _capacity = size;
+        _maximumLength = maximumLength;
+        mask = size - 1;
+        slots = calloc(size, sizeof(string_slot));
+        slot_bytes = malloc(size * maximumLength);
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    for(NSUInteger i = 0; i < _capacity; i++) {
+        if(slots[i].string) {
+            CFRelease(slots[i].string);
+        }
+    }
+    free(slots);
+    free(slot_bytes);
+}
+
+static inline BOOL slot_matches(string_slot *slot, const uint8_t *slot_data, uint32_t hash, const uint8_t *bytes, NSUInteger length) {
+    return slot->string && slot->hash == hash && slot->length == length && memcmp(slot_data, bytes, length) == 0;
+}
+
+- (NSString*) stringWithBytes:(const uint8_t*)bytes length:(NSUInteger)length {
+    if(length > _maximumLength) {
+        return [[NSString alloc] initWithBytes: bytes length: length encoding: NSUTF8StringEncoding];
+    }
+    
+    uint32_t hash = 2166136261u;
+    for(NSUInteger i = 0; i < length; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    
+    NSUInteger first = hash & mask & ~(NSUInteger)1;
+    NSUInteger second = first + 1;
+    if(slot_matches(&slots[first], slot_bytes + first * _maximumLength, hash, bytes, length)) {
+        _hits++;
+        return (__bridge NSString*)slots[first].string;
+    }
+    if(slot_matches(&slots[second], slot_bytes + second * _maximumLength, hash, bytes, length)) {
+        // keep the string that was used last in the first slot
+        string_slot swap = slots[first];
+        slots[first] = slots[second];
+        slots[second] = swap;
+        memcpy(slot_bytes + second * _maximumLength, slot_bytes + first * _maximumLength, slots[second].length);
+        memcpy(slot_bytes + first * _maximumLength, bytes, length);
+        _hits++;
+        return (__bridge NSString*)slots[first].string;
+    }
+    
+    NSString *string = [[NSString alloc] initWithBytes: bytes length: length encoding: NSUTF8StringEncoding];
+    if(string == nil) {
+        return nil;
+    }
+    _misses++;
+    
+    if(slots[second].string) {
+        CFRelease(slots[second].string);
+    }
+    slots[second] = slots[first];
+    memcpy(slot_bytes + second * _maximumLength, slot_bytes + first * _maximumLength, slots[first].length);
+    slots[first].hash = hash;
+    slots[first].length = (uint32_t)length;
+    slots[first].string = CFBridgingRetain(string);
+    memcpy(slot_bytes + first * _maximumLength, bytes, length);
+    
+    return string;
+}
+
+@end
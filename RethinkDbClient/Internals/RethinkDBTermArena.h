@@ -0,0 +1,64 @@
+//
+//  RethinkDBTermArena.h
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright (c) 2026 Daniel Parnell
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#ifndef RethinkDbClient_RethinkDBTermArena_h
+#define RethinkDbClient_RethinkDBTermArena_h
+
+#import <Foundation/Foundation.h>
+#import "Ql2.pb.h"
+
+// A term in an arena. Terms with a type of 0 are values: either a Term built outside the arena or a
+// Foundation value that is written as a datum.
+typedef struct rethinkdb_term_node {
+    Term_TermType type;
+    uint32_t arg_count;
+    uint32_t optarg_count;
+    struct rethinkdb_term_node **args;
+    __unsafe_unretained NSString **optarg_keys;
+    struct rethinkdb_term_node **optarg_values;
+    __unsafe_unretained id value;
+} rethinkdb_term_node;
+
+// Allocates every term of a query from a few large blocks that are freed together when the arena goes away.
+// Objects the terms point at are kept alive by the arena. Safe to allocate from on several threads at once.
+@interface RethinkDBTermArena : NSObject
+
+- (rethinkdb_term_node*) nodeWithType:(Term_TermType)type argCount:(NSUInteger)argCount optargCount:(NSUInteger)optargCount;
+- (rethinkdb_term_node*) nodeWithValue:(id)value;
+- (void) keepObject:(id)object;
+
+// Builds the protobuf Term for code that needs one, such as the protobuf protocol.
+- (Term*) termForNode:(rethinkdb_term_node*)node;
+
+@property (readonly) NSUInteger bytesUsed;
+
+@end
+
+#endif
@@ -0,0 +1,161 @@
+//
+//  RethinkDBTermArena.m
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright (c) 2026 Daniel Parnell
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#import "RethinkDBTermArena.h"
+#import "QL2+JSON.h"
+
+#define ARENA_BLOCK_SIZE 4096
+#define ARENA_ALIGNMENT 8
+
+typedef struct arena_block {
+    struct arena_block *next;
+    size_t size;
+    size_t used;
+    uint8_t bytes[];
+} arena_block;
+
+@implementation RethinkDBTermArena {
+    arena_block *blocks;
+    CFMutableArrayRef objects;
+    // queries built from the same base on different threads allocate from its arena at the same time
+    pthread_mutex_t mutex;
+}
+
+- (instancetype) init {
+    self = [super init];
+    if(self) {
+        objects = CFArrayCreateMutable(NULL, 0, &kCFTypeArrayCallBacks);
+        pthread_mutex_init(&mutex, NULL);
+    }
+    
+    return self;
+}
+
+- (void) dealloc {
+    while(blocks) {
+        arena_block *next = blocks->next;
+        free(blocks);
+        blocks = next;
+    }
+    CFRelease(objects);
+    pthread_mutex_destroy(&mutex);
+}
+
+- (void*) allocate:(size_t)size {
+    size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    
+    pthread_mutex_lock(&mutex);
+    if(blocks == NULL || blocks->used + size > blocks->size) {
+        size_t block_size = MAX(size, ARENA_BLOCK_SIZE);
+        arena_block *block = malloc(sizeof(arena_block) + block_size);
+        block->next = blocks;
+        block->size = block_size;
+        block->used = 0;
+        blocks = block;
+    }
+    
+    void *result = blocks->bytes + blocks->used;
+    blocks->used += size;
+    _bytesUsed += size;
+    pthread_mutex_unlock(&mutex);
+    
+    return result;
+}
+
+- (void) keepObject:(id)object {
+    pthread_mutex_lock(&mutex);
+    CFArrayAppendValue(objects, (__bridge const void *)object);
+    pthread_mutex_unlock(&mutex);
+}
+
+- (NSUInteger) bytesUsed {
+    pthread_mutex_lock(&mutex);
+    NSUInteger result = _bytesUsed;
+    pthread_mutex_unlock(&mutex);
+    
+    return result;
+}
+
+- (rethinkdb_term_node*) nodeWithType:(Term_TermType)type argCount:(NSUInteger)argCount optargCount:(NSUInteger)optargCount {
+    // the node and its argument arrays sit next to each other
+    size_t size = sizeof(rethinkdb_term_node) + sizeof(void*) * (argCount + optargCount * 2);
+    rethinkdb_term_node *node = [self allocate: size];
+    void **arrays = (void**)(node + 1);
+    
+    memset(node, 0, size);
+    node->type = type;
+    node->arg_count = (uint32_t)argCount;
+    node->optarg_count = (uint32_t)optargCount;
+    node->args = (rethinkdb_term_node**)arrays;
+    node->optarg_keys = (__unsafe_unretained NSString**)(arrays + argCount);
+    node->optarg_values = (rethinkdb_term_node**)(arrays + argCount + optargCount);
+    
+    return node;
+}
+
+- (rethinkdb_term_node*) nodeWithValue:(id)value {
+    rethinkdb_term_node *node = [self nodeWithType: 0 argCount: 0 optargCount: 0];
+    
+    if(value) {
+        [self keepObject: value];
+    }
+    node->value = value;
+    
+    return node;
+}
+
+- (Term*) termForNode:(rethinkdb_term_node*)node {
+    if(node->type == 0) {
+        if([node->value isKindOfClass: [Term class]]) {
+            return node->value;
+        }
+        
+        Term_Builder* term = [Term_Builder new];
+        term.type = Term_TermTypeDatum;
+        term.datum = [RethinkDBValueDatum datumWithValue: node->value];
+        return [term build];
+    }
+    
+    Term_Builder* term = [Term_Builder new];
+    term.type = node->type;
+    for(uint32_t i = 0; i < node->arg_count; i++) {
+        [term addArgs: [self termForNode: node->args[i]]];
+    }
+    for(uint32_t i = 0; i < node->optarg_count; i++) {
+        Term_AssocPair_Builder* pair = [Term_AssocPair_Builder new];
+        pair.key = node->optarg_keys[i];
+        pair.val = [self termForNode: node->optarg_values[i]];
+        [term addOptargs: [pair build]];
+    }
+    
+    return [term build];
+}
+
+@end
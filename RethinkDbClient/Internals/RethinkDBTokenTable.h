@@ -0,0 +1,52 @@
+//
+//  RethinkDBTokenTable.h
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright (c) 2026 Daniel Parnell
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef RethinkDbClient_RethinkDBTokenTable_h
+#define RethinkDbClient_RethinkDBTokenTable_h
+
+#import <Foundation/Foundation.h>
+
+// A table of in flight objects (operations and cursors) keyed by query token.
+// The table is split into shards, each with its own lock and open addressed
+// hash, so lookups from the reader thread stay O(1) and rarely contend with
+// threads sending new queries.
+@interface RethinkDBTokenTable : NSObject
+
+- (void) setObject:(id)object forToken:(int64_t)token;
+// Stores object unless the token already has one, and returns the object the token ends up with.
+- (id) addObject:(id)object forToken:(int64_t)token;
+- (id) objectForToken:(int64_t)token;
+- (id) removeObjectForToken:(int64_t)token;
+- (NSArray*) allObjects;
+
+@property (readonly) NSUInteger count;
+
+@end
+
+#endif
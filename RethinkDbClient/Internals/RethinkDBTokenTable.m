@@ -0,0 +1,263 @@
+//
+//  RethinkDBTokenTable.m
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright (c) 2026 Daniel Parnell
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#import "RethinkDBTokenTable.h"
+#import <pthread.h>
+
+#define TOKEN_TABLE_SHARDS 16
+#define TOKEN_TABLE_INITIAL_CAPACITY 16
+
+// tokens are allocated from 1 upwards, so 0 marks a free slot and -1 a deleted one
+#define EMPTY_TOKEN 0
+#define DELETED_TOKEN -1
+
+typedef struct {
+    int64_t token;
+    void *value;
+} token_table_slot;
+
+typedef struct {
+    pthread_mutex_t lock;
+    token_table_slot *slots;
+    NSUInteger capacity;
+    NSUInteger used;
+    NSUInteger live;
+} token_table_shard;
+
+static inline NSUInteger slot_hash(int64_t token, NSUInteger capacity) {
+    // the low bits select the shard, so mix the remainder before masking
+    uint64_t h = (uint64_t)token / TOKEN_TABLE_SHARDS;
+    h *= 0x9E3779B97F4A7C15ULL;
+    return (NSUInteger)(h >> 32) & (capacity - 1);
+}
+
+static token_table_slot *shard_find(token_table_shard *shard, int64_t token) {
+    NSUInteger mask = shard->capacity - 1;
+    NSUInteger i = slot_hash(token, shard->capacity);
+    
+    while(YES) {
+        token_table_slot *slot = &shard->slots[i];
+        if(slot->token == token) {
+            return slot;
+        }
+        if(slot->token == EMPTY_TOKEN) {
+            return NULL;
+        }
+        i = (i + 1) & mask;
+    }
+}
+
+// returns NO when a deleted slot was reused, which leaves the number of used slots as it was
+static BOOL shard_insert_slot(token_table_slot *slots, NSUInteger capacity, int64_t token, void *value) {
+    NSUInteger mask = capacity - 1;
+    NSUInteger i = slot_hash(token, capacity);
+    
+    while(slots[i].token != EMPTY_TOKEN && slots[i].token != DELETED_TOKEN) {
+        i = (i + 1) & mask;
+    }
+    BOOL was_empty = slots[i].token == EMPTY_TOKEN;
+    slots[i].token = token;
+    slots[i].value = value;
+    
+    return was_empty;
+}
+
+static void shard_resize(token_table_shard *shard, NSUInteger capacity) {
+    token_table_slot *old_slots = shard->slots;
+    NSUInteger old_capacity = shard->capacity;
+    
+    shard->slots = calloc(capacity, sizeof(token_table_slot));
+    shard->capacity = capacity;
+    
+    for(NSUInteger i = 0; i < old_capacity; i++) {
+        if(old_slots[i].token > 0) {
+            shard_insert_slot(shard->slots, capacity, old_slots[i].token, old_slots[i].value);
+        }
+    }
+    shard->used = shard->live;
+    
+    free(old_slots);
+}
+
+@implementation RethinkDBTokenTable {
+    token_table_shard shards[TOKEN_TABLE_SHARDS];
+}
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        for(int i = 0; i < TOKEN_TABLE_SHARDS; i++) {
+            pthread_mutex_init(&shards[i].lock, NULL);
+            shards[i].slots = calloc(TOKEN_TABLE_INITIAL_CAPACITY, sizeof(token_table_slot));
+            shards[i].capacity = TOKEN_TABLE_INITIAL_CAPACITY;
+        }
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    for(int i = 0; i < TOKEN_TABLE_SHARDS; i++) {
+        token_table_shard *shard = &shards[i];
+        for(NSUInteger j = 0; j < shard->capacity; j++) {
+            if(shard->slots[j].token > 0) {
+                CFRelease(shard->slots[j].value);
+            }
+        }
+        free(shard->slots);
+        pthread_mutex_destroy(&shard->lock);
+    }
+}
+
+static inline token_table_shard *shard_for(token_table_shard *shards, int64_t token) {
+    return &shards[(uint64_t)token % TOKEN_TABLE_SHARDS];
+}
+
+// must be called with the shard's lock held
+static void shard_add(token_table_shard *shard, int64_t token, void *value) {
+    // keep the load factor (including deleted slots) under 1/2
+    if((shard->used + 1) * 2 > shard->capacity) {
+        shard_resize(shard, (shard->live + 1) * 4 > shard->capacity ? shard->capacity * 2 : shard->capacity);
+    }
+    if(shard_insert_slot(shard->slots, shard->capacity, token, value)) {
+        shard->used++;
+    }
+    shard->live++;
+}
+
+- (void) setObject:(id)object forToken:(int64_t)token {
+    NSParameterAssert(token > 0);
+    
+    token_table_shard *shard = shard_for(shards, token);
+    void *value = (void*)CFBridgingRetain(object);
+    void *previous = NULL;
+    
+    pthread_mutex_lock(&shard->lock);
+    token_table_slot *slot = shard_find(shard, token);
+    if(slot) {
+        previous = slot->value;
+        slot->value = value;
+    } else {
+        shard_add(shard, token, value);
+    }
+    pthread_mutex_unlock(&shard->lock);
+    
+    if(previous) {
+        CFRelease(previous);
+    }
+}
+
+- (id) addObject:(id)object forToken:(int64_t)token {
+    NSParameterAssert(token > 0);
+    
+    token_table_shard *shard = shard_for(shards, token);
+    id result = object;
+    
+    pthread_mutex_lock(&shard->lock);
+    token_table_slot *slot = shard_find(shard, token);
+    if(slot) {
+        result = (__bridge id)slot->value;
+    } else {
+        shard_add(shard, token, (void*)CFBridgingRetain(object));
+    }
+    pthread_mutex_unlock(&shard->lock);
+    
+    return result;
+}
+
+- (id) objectForToken:(int64_t)token {
+    if(token <= 0) {
+        return nil;
+    }
+    
+    token_table_shard *shard = shard_for(shards, token);
+    id result = nil;
+    
+    pthread_mutex_lock(&shard->lock);
+    token_table_slot *slot = shard_find(shard, token);
+    if(slot) {
+        result = (__bridge id)slot->value;
+    }
+    pthread_mutex_unlock(&shard->lock);
+    
+    return result;
+}
+
+- (id) removeObjectForToken:(int64_t)token {
+    if(token <= 0) {
+        return nil;
+    }
+    
+    token_table_shard *shard = shard_for(shards, token);
+    void *value = NULL;
+    
+    pthread_mutex_lock(&shard->lock);
+    token_table_slot *slot = shard_find(shard, token);
+    if(slot) {
+        value = slot->value;
+        slot->token = DELETED_TOKEN;
+        slot->value = NULL;
+        shard->live--;
+    }
+    pthread_mutex_unlock(&shard->lock);
+    
+    return value ? CFBridgingRelease(value) : nil;
+}
+
+- (NSArray*) allObjects {
+    NSMutableArray *result = [NSMutableArray new];
+    
+    for(int i = 0; i < TOKEN_TABLE_SHARDS; i++) {
+        token_table_shard *shard = &shards[i];
+        pthread_mutex_lock(&shard->lock);
+        for(NSUInteger j = 0; j < shard->capacity; j++) {
+            if(shard->slots[j].token > 0) {
+                [result addObject: (__bridge id)shard->slots[j].value];
+            }
+        }
+        pthread_mutex_unlock(&shard->lock);
+    }
+    
+    return result;
+}
+
+- (NSUInteger) count {
+    NSUInteger result = 0;
+    
+    for(int i = 0; i < TOKEN_TABLE_SHARDS; i++) {
+        pthread_mutex_lock(&shards[i].lock);
+        result += shards[i].live;
+        pthread_mutex_unlock(&shards[i].lock);
+    }
+    
+    return result;
+}
+
+@end
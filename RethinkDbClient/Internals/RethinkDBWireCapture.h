@@ -0,0 +1,79 @@
+//
+//  RethinkDBWireCapture.h
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright (c) 2026 Daniel Parnell
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#ifndef RethinkDbClient_RethinkDBWireCapture_h
+#define RethinkDbClient_RethinkDBWireCapture_h
+
+#import <Foundation/Foundation.h>
+#import "RethinkDbClient.h"
+
+// The capture file starts with an 8 byte magic, a version and the protocol the connection spoke. Each frame
+// follows as a record header and the frame's payload. Everything is little endian.
+#define RETHINKDB_CAPTURE_MAGIC "RDBWIRE1"
+#define RETHINKDB_CAPTURE_VERSION 1
+
+typedef NS_ENUM(uint8_t, RethinkDBCaptureDirection) {
+    RethinkDBCaptureQuery = 0,
+    RethinkDBCaptureResponse = 1
+};
+
+typedef struct rethinkdb_capture_file_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t protocol;
+} rethinkdb_capture_file_header;
+
+typedef struct rethinkdb_capture_record {
+    uint8_t direction;
+    uint8_t reserved[3];
+    uint32_t length;
+    int64_t token;
+    // nanoseconds since the capture started
+    uint64_t time;
+} rethinkdb_capture_record;
+
+// Copies frames into a lock free ring for each direction, which a background queue drains into the file.
+// Each ring has a single producer: queries are captured while the connection's socket lock is held and
+// responses on its I/O thread. A frame that does not fit in its ring is dropped.
+@interface RethinkDBWireCapture : NSObject
+
+- (instancetype) initWithPath:(NSString*)path protocol:(uint32_t)protocol bufferSize:(NSUInteger)bufferSize error:(NSError**)error;
+
+- (void) captureQuery:(const uint8_t*)bytes length:(NSUInteger)length token:(int64_t)token;
+- (void) captureResponse:(const uint8_t*)bytes length:(NSUInteger)length token:(int64_t)token;
+// Writes out whatever is still in the rings and closes the file. Frames captured after this are ignored.
+- (void) stop;
+
+@property (readonly) uint64_t capturedFrames;
+@property (readonly) uint64_t droppedFrames;
+
+@end
+
+#endif
@@ -0,0 +1,417 @@
+//
+//  RethinkDBWireCapture.m
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright (c) 2026 Daniel Parnell
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#import "RethinkDBWireCapture.h"
+#import "RethinkDBClient-Private.h"
+#import "RethinkDBCursors-Private.h"
+#include <stdatomic.h>
+#include <mach/mach_time.h>
+
+#define MINIMUM_RING_SIZE 4096
+// how often the rings are written out
+#define DRAIN_INTERVAL_MS 10
+
+static NSString* capture_error = @"RethinkDB Capture Error";
+
+#pragma mark -
+#pragma mark Rings
+
+// head is only moved by the consumer and tail only by the producer, both count bytes since the ring was made.
+typedef struct capture_ring {
+    uint8_t *bytes;
+    uint64_t capacity;
+    _Atomic uint64_t head;
+    _Atomic uint64_t tail;
+    _Atomic uint64_t captured;
+    _Atomic uint64_t dropped;
+} capture_ring;
+
+static void ring_init(capture_ring *ring, uint64_t capacity) {
+    ring->bytes = malloc(capacity);
+    ring->capacity = capacity;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->captured, 0);
+    atomic_init(&ring->dropped, 0);
+}
+
+static void ring_copy_in(capture_ring *ring, uint64_t position, const void *data, size_t length) {
+    uint64_t offset = position & (ring->capacity - 1);
+    size_t first = (size_t)MIN(length, ring->capacity - offset);
+    
+    memcpy(ring->bytes + offset, data, first);
+    if(first < length) {
+        memcpy(ring->bytes, (const uint8_t*)data + first, length - first);
+    }
+}
+
+static void ring_copy_out(capture_ring *ring, uint64_t position, void *data, size_t length) {
+    uint64_t offset = position & (ring->capacity - 1);
+    size_t first = (size_t)MIN(length, ring->capacity - offset);
+    
+    memcpy(data, ring->bytes + offset, first);
+    if(first < length) {
+        memcpy((uint8_t*)data + first, ring->bytes, length - first);
+    }
+}
+
+static void ring_write_out(capture_ring *ring, uint64_t position, size_t length, FILE *file) {
+    uint64_t offset = position & (ring->capacity - 1);
+    size_t first = (size_t)MIN(length, ring->capacity - offset);
+    
+    fwrite(ring->bytes + offset, 1, first, file);
+    if(first < length) {
+        fwrite(ring->bytes, 1, length - first, file);
+    }
+}
+
+static void ring_push(capture_ring *ring, const rethinkdb_capture_record *record, const uint8_t *payload) {
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint64_t needed = sizeof(*record) + record->length;
+    
+    if(ring->capacity - (tail - head) < needed) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return;
+    }
+    
+    ring_copy_in(ring, tail, record, sizeof(*record));
+    ring_copy_in(ring, tail + sizeof(*record), payload, record->length);
+    atomic_store_explicit(&ring->tail, tail + needed, memory_order_release);
+    atomic_fetch_add_explicit(&ring->captured, 1, memory_order_relaxed);
+}
+
+#pragma mark -
+#pragma mark Capture
+
+@implementation RethinkDBWireCapture {
+    capture_ring rings[2];
+    uint64_t started;
+    mach_timebase_info_data_t timebase;
+    _Atomic bool active;
+    
+    FILE *file;
+    // the rings are only drained here
+    __strong dispatch_queue_t drain_queue;
+    __strong dispatch_source_t drain_timer;
+}
+
+- (instancetype) initWithPath:(NSString*)path protocol:(uint32_t)protocol bufferSize:(NSUInteger)bufferSize error:(NSError**)error {
+    self = [super init];
+    if (self) {
+        file = fopen([path fileSystemRepresentation], "wb");
+        if(file == NULL) {
+            if(error) *error = [NSError errorWithDomain: NSPOSIXErrorDomain code: errno userInfo: [NSDictionary dictionaryWithObject: [NSString stringWithFormat: @"Could not create the capture file %@", path] forKey: NSLocalizedDescriptionKey]];
+            return nil;
+        }
+        
+        rethinkdb_capture_file_header header;
+        memcpy(header.magic, RETHINKDB_CAPTURE_MAGIC, sizeof(header.magic));
+        header.version = CFSwapInt32HostToLittle(RETHINKDB_CAPTURE_VERSION);
+        header.protocol = CFSwapInt32HostToLittle(protocol);
+        fwrite(&header, sizeof(header), 1, file);
+        
+        // the rings wrap with a mask, so round up to a power of two
+        uint64_t capacity = MINIMUM_RING_SIZE;
+        while(capacity < bufferSize) {
+            capacity <<= 1;
+        }
+        ring_init(&rings[RethinkDBCaptureQuery], capacity);
+        ring_init(&rings[RethinkDBCaptureResponse], capacity);
+        
+        mach_timebase_info(&timebase);
+        started = mach_absolute_time();
+        atomic_init(&active, true);
+        
+        drain_queue = dispatch_queue_create("RethinkDB capture queue", DISPATCH_QUEUE_SERIAL);
+        drain_timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, drain_queue);
+        dispatch_source_set_timer(drain_timer, dispatch_time(DISPATCH_TIME_NOW, DRAIN_INTERVAL_MS * NSEC_PER_MSEC), DRAIN_INTERVAL_MS * NSEC_PER_MSEC, NSEC_PER_MSEC);
+        __weak RethinkDBWireCapture *weak_self = self;
+        dispatch_source_set_event_handler(drain_timer, ^{
+            [weak_self drain];
+        });
+        dispatch_resume(drain_timer);
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [self stop];
+    free(rings[0].bytes);
+    free(rings[1].bytes);
+}
+
+- (void) capture:(RethinkDBCaptureDirection)direction bytes:(const uint8_t*)bytes length:(NSUInteger)length token:(int64_t)token {
+    if(!atomic_load_explicit(&active, memory_order_relaxed)) {
+        return;
+    }
+    
+    rethinkdb_capture_record record;
+    record.direction = direction;
+    memset(record.reserved, 0, sizeof(record.reserved));
+    record.length = (uint32_t)length;
+    record.token = token;
+    // converted to nanoseconds when the record is written out
+    record.time = mach_absolute_time() - started;
+    
+    ring_push(&rings[direction], &record, bytes);
+}
+
+- (void) captureQuery:(const uint8_t*)bytes length:(NSUInteger)length token:(int64_t)token {
+    [self capture: RethinkDBCaptureQuery bytes: bytes length: length token: token];
+}
+
+- (void) captureResponse:(const uint8_t*)bytes length:(NSUInteger)length token:(int64_t)token {
+    [self capture: RethinkDBCaptureResponse bytes: bytes length: length token: token];
+}
+
+// Only ever runs on the drain queue. Each direction is written in the order it was captured.
+- (void) drain {
+    if(file == NULL) {
+        return;
+    }
+    
+    for(int i = 0; i < 2; i++) {
+        capture_ring *ring = &rings[i];
+        uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        
+        while(head < tail) {
+            rethinkdb_capture_record record;
+            ring_copy_out(ring, head, &record, sizeof(record));
+            uint32_t length = record.length;
+            
+            record.length = CFSwapInt32HostToLittle(length);
+            record.token = (int64_t)CFSwapInt64HostToLittle((uint64_t)record.token);
+            record.time = CFSwapInt64HostToLittle(record.time * timebase.numer / timebase.denom);
+            fwrite(&record, sizeof(record), 1, file);
+            ring_write_out(ring, head + sizeof(record), length, file);
+            
+            head += sizeof(record) + length;
+        }
+        
+        atomic_store_explicit(&ring->head, head, memory_order_release);
+    }
+}
+
+- (void) stop {
+    if(!atomic_exchange(&active, false)) {
+        return;
+    }
+    
+    // stop may be called from dealloc, so the block must not retain the capture
+    __unsafe_unretained RethinkDBWireCapture *capture = self;
+    dispatch_source_cancel(drain_timer);
+    dispatch_sync(drain_queue, ^{
+        [capture drain];
+        fclose(capture->file);
+        capture->file = NULL;
+    });
+}
+
+- (uint64_t) capturedFrames {
+    return atomic_load_explicit(&rings[0].captured, memory_order_relaxed) + atomic_load_explicit(&rings[1].captured, memory_order_relaxed);
+}
+
+- (uint64_t) droppedFrames {
+    return atomic_load_explicit(&rings[0].dropped, memory_order_relaxed) + atomic_load_explicit(&rings[1].dropped, memory_order_relaxed);
+}
+
+@end
+
+#pragma mark -
+#pragma mark Replay
+
+@implementation RethinkDBCaptureReplay {
+    __strong NSData *data;
+    // offsets of the START queries' records
+    __strong NSMutableData *starts;
+    // the STARTs, by index, that had the noreply option and so never got a response
+    __strong NSMutableIndexSet *noreply_starts;
+}
+
+- (instancetype) initWithContentsOfFile:(NSString*)path error:(NSError**)error {
+    self = [super init];
+    if (self) {
+        data = [NSData dataWithContentsOfFile: path options: NSDataReadingMappedIfSafe error: error];
+        if(data == nil) {
+            return nil;
+        }
+        
+        const uint8_t *bytes = [data bytes];
+        NSUInteger length = [data length];
+        rethinkdb_capture_file_header header;
+        
+        if(length < sizeof(header)) {
+            if(error) *error = [NSError errorWithDomain: capture_error code: -1 userInfo: [NSDictionary dictionaryWithObject: @"Not a capture file" forKey: NSLocalizedDescriptionKey]];
+            return nil;
+        }
+        memcpy(&header, bytes, sizeof(header));
+        if(memcmp(header.magic, RETHINKDB_CAPTURE_MAGIC, sizeof(header.magic)) != 0 || CFSwapInt32LittleToHost(header.version) != RETHINKDB_CAPTURE_VERSION) {
+            if(error) *error = [NSError errorWithDomain: capture_error code: -1 userInfo: [NSDictionary dictionaryWithObject: @"Not a capture file" forKey: NSLocalizedDescriptionKey]];
+            return nil;
+        }
+        if(CFSwapInt32LittleToHost(header.protocol) != VersionDummy_ProtocolJson) {
+            if(error) *error = [NSError errorWithDomain: capture_error code: -1 userInfo: [NSDictionary dictionaryWithObject: @"Only captures of JSON protocol connections can be replayed" forKey: NSLocalizedDescriptionKey]];
+            return nil;
+        }
+        
+        starts = [NSMutableData new];
+        noreply_starts = [NSMutableIndexSet new];
+        NSUInteger offset = sizeof(header);
+        uint64_t first = 0, last = 0;
+        while(offset + sizeof(rethinkdb_capture_record) <= length) {
+            rethinkdb_capture_record record;
+            memcpy(&record, bytes + offset, sizeof(record));
+            uint32_t record_length = CFSwapInt32LittleToHost(record.length);
+            if(offset + sizeof(record) + record_length > length) {
+                // the capture was cut short
+                break;
+            }
+            
+            // CONTINUE and STOP belong to cursors, which the replayed STARTs make again for themselves
+            if(record.direction == RethinkDBCaptureQuery && [self isStart: bytes + offset + sizeof(record) length: record_length]) {
+                uint64_t time = CFSwapInt64LittleToHost(record.time);
+                if([starts length] == 0) {
+                    first = time;
+                }
+                last = time;
+                if([self isNoReply: bytes + offset + sizeof(record) length: record_length]) {
+                    [noreply_starts addIndex: [starts length] / sizeof(NSUInteger)];
+                }
+                [starts appendBytes: &offset length: sizeof(offset)];
+            }
+            offset += sizeof(record) + record_length;
+        }
+        
+        _queryCount = [starts length] / sizeof(NSUInteger);
+        _duration = (last - first) / (double)NSEC_PER_SEC;
+    }
+    return self;
+}
+
+// the query type is the first element of the query's JSON array
+- (BOOL) isStart:(const uint8_t*)bytes length:(NSUInteger)length {
+    NSUInteger i = 0;
+    while(i < length && (bytes[i] == '[' || bytes[i] == ' ')) {
+        i++;
+    }
+    
+    return i + 1 < length && bytes[i] == '0' + Query_QueryTypeStart && (bytes[i + 1] == ',' || bytes[i + 1] == ']');
+}
+
+// [type, term, global options] - the options are only looked at once per START, so parsing is fine here
+- (BOOL) isNoReply:(const uint8_t*)bytes length:(NSUInteger)length {
+    NSArray *query = [NSJSONSerialization JSONObjectWithData: [NSData dataWithBytesNoCopy: (void*)bytes length: length freeWhenDone: NO] options: 0 error: nil];
+    if(![query isKindOfClass: [NSArray class]] || [query count] < 3) {
+        return NO;
+    }
+    
+    NSDictionary *options = [query objectAtIndex: 2];
+    
+    return [options isKindOfClass: [NSDictionary class]] && [[options objectForKey: @"noreply"] isEqual: @YES];
+}
+
+- (BOOL) replayTo:(RethinkDbClient*)client speed:(double)speed error:(NSError**)error {
+    const uint8_t *bytes = [data bytes];
+    const NSUInteger *offsets = [starts bytes];
+    dispatch_group_t outstanding = dispatch_group_create();
+    NSLock *failure_lock = [NSLock new];
+    __block NSError *failure = nil;
+    __block NSUInteger failed = 0;
+    
+    uint64_t first = 0;
+    NSDate *began = [NSDate date];
+    for(NSUInteger i = 0; i < _queryCount; i++) {
+        rethinkdb_capture_record record;
+        memcpy(&record, bytes + offsets[i], sizeof(record));
+        uint64_t time = CFSwapInt64LittleToHost(record.time);
+        if(i == 0) {
+            first = time;
+        }
+        
+        if(speed > 0) {
+            NSTimeInterval due = (time - first) / (double)NSEC_PER_SEC / speed;
+            NSTimeInterval wait = due + [began timeIntervalSinceNow];
+            if(wait > 0) {
+                [NSThread sleepForTimeInterval: wait];
+            }
+        }
+        
+        if([noreply_starts containsIndex: i]) {
+            // the server won't answer, so there is nothing to wait for
+            NSError *send_error = nil;
+            if(![client runEncodedNoReply: bytes + offsets[i] + sizeof(record) length: CFSwapInt32LittleToHost(record.length) error: &send_error]) {
+                [failure_lock lock];
+                failed++;
+                if(failure == nil) {
+                    failure = send_error;
+                }
+                [failure_lock unlock];
+            }
+            continue;
+        }
+        
+        dispatch_group_enter(outstanding);
+        [client runEncoded: bytes + offsets[i] + sizeof(record) length: CFSwapInt32LittleToHost(record.length) then:^(id response) {
+            if([response isKindOfClass: [RethinkDBCursor class]]) {
+                // only the START is being replayed, not however far the original consumer read
+                [response close];
+            }
+            dispatch_group_leave(outstanding);
+        } fail:^(NSError *err) {
+            [failure_lock lock];
+            failed++;
+            if(failure == nil) {
+                failure = err;
+            }
+            [failure_lock unlock];
+            dispatch_group_leave(outstanding);
+        }];
+    }
+    dispatch_group_wait(outstanding, DISPATCH_TIME_FOREVER);
+    if([noreply_starts count] && failure == nil) {
+        // like the original connection, only finish once the server has dealt with the noreply queries too
+        NSError *wait_error = nil;
+        if(![client noreplyWait: &wait_error]) {
+            failure = wait_error;
+        }
+    }
+    
+    _failedCount = failed;
+    if(failure && error) {
+        *error = failure;
+    }
+    
+    return failure == nil;
+}
+
+@end
@@ -50,6 +50,29 @@ typedef void (^RethinkDbSuccessBlock)(id response);
 typedef BOOL (^RethinkDbCursorValueBlock)(id response);
 typedef void (^RethinkDbErrorBlock)(NSError *error);
 typedef void (^RethinkDbArrayBlock)(NSArray *array);
+typedef BOOL (^RethinkDbBatchBlock)(NSArray *rows);
+typedef id (^RethinkDbCursorMapBlock)(id row);
+typedef void (^RethinkDbStateBlock)(NSString *state);
+typedef id (^RethinkDbDocumentSource)(void);
+
+typedef NS_ENUM(NSInteger, RethinkDBRowMode) {
+    // every row is decoded into NSDictionary/NSArray values as soon as it arrives
+    RethinkDBRowModeEager,
+    // rows are NSDictionary/NSArray proxies that decode each field the first time it is read
+    RethinkDBRowModeLazy,
+    // each batch of rows is a RethinkDBCompactBatch
+    RethinkDBRowModeCompact
+};
+
+typedef NS_ENUM(uint8_t, RethinkDBCompactType) {
+    RethinkDBCompactNull,
+    RethinkDBCompactBoolean,
+    RethinkDBCompactInteger,
+    RethinkDBCompactDouble,
+    RethinkDBCompactString,
+    RethinkDBCompactArray,
+    RethinkDBCompactObject
+};
 
 @interface RethinkDBOperation : NSOperation
 
@@ -63,31 +86,244 @@ typedef void (^RethinkDbArrayBlock)(NSArray *array);
 - (void) close;
 
 @property (readonly) int64_t token;
+// How many batches to request ahead of the consumer. CONTINUE is sent as soon as a batch arrives while
+// fewer than readAhead batches are waiting to be processed; 0 only asks once the current batch is done.
+@property (assign) NSUInteger readAhead;
 
 @end
 
-@interface RethinkDBSequenceCursor : RethinkDBCursor
+// Rows can be pushed to blocks with each:, or pulled with nextRow:, nextBatch: and for-in, which block until the
+// rows arrive. Pulling only asks the server for more when the consumer gets to the end of a batch (or readAhead
+// batches before that), so a scan of any size holds at most readAhead + 1 batches. Use one or the other per cursor.
+// The pulling methods are for one thread at a time, apart from next:fail:, whose calls take their turns.
+@interface RethinkDBSequenceCursor : RethinkDBCursor <NSFastEnumeration>
 
 - (void) each:(RethinkDbCursorValueBlock)row done:(RethinkDbDoneBlock) done fail:(RethinkDbErrorBlock) error;
+// success gets nil once every row has been read. Calls are answered in the order they were made.
 - (void) next:(RethinkDbCursorValueBlock)success fail:(RethinkDbErrorBlock) error;
+// nil once every row has been read, or on an error
+- (id) nextRow:(NSError**)error;
+- (NSArray*) nextBatch:(NSError**)error;
 - (void) toArrayThen:(RethinkDbArrayBlock)success fail:(RethinkDbErrorBlock) error;
 - (NSArray*) toArray:(NSError**)error;
+// Runs row on up to concurrency rows at once. When ordered, the first row (in cursor order) to return NO is
+// the last one counted, although rows after it may already have run.
+- (void) each:(RethinkDbCursorValueBlock)row concurrency:(NSUInteger)concurrency ordered:(BOOL)ordered done:(RethinkDbDoneBlock) done fail:(RethinkDbErrorBlock) error;
+// Runs work on up to concurrency rows at once and hands the results to row one at a time, in the cursor's
+// order when ordered is set or as soon as they are ready otherwise. nil results are passed on as nil.
+- (void) map:(RethinkDbCursorMapBlock)work concurrency:(NSUInteger)concurrency ordered:(BOOL)ordered each:(RethinkDbCursorValueBlock)row done:(RethinkDbDoneBlock) done fail:(RethinkDbErrorBlock) error;
+// Hands over whole batches as they arrive, which is how RethinkDBCompactBatch results are best read.
+- (void) eachBatch:(RethinkDbBatchBlock)batch done:(RethinkDbDoneBlock) done fail:(RethinkDbErrorBlock) error;
+
+// Why the last for-in over the cursor stopped early, nil if it read every row.
+@property (readonly) NSError *enumerationError;
 
 @end
 
+// A batch of rows decoded into one flat buffer of tagged values, produced by RethinkDBRowModeCompact.
+// Values are numbered and read through the accessors below without creating any Foundation objects,
+// and each key name is stored once per batch no matter how many rows use it. Used as an NSArray the
+// batch decodes the requested row into NSDictionary/NSArray values every time it is accessed.
+@interface RethinkDBCompactBatch : NSArray
+
+- (NSUInteger) valueForRow:(NSUInteger)row;
+- (RethinkDBCompactType) typeOfValue:(NSUInteger)value;
+// the members of an array or object, or the bytes in a string
+- (NSUInteger) lengthOfValue:(NSUInteger)value;
+- (BOOL) boolForValue:(NSUInteger)value;
+// doubles are truncated
+- (int64_t) integerForValue:(NSUInteger)value;
+- (double) doubleForValue:(NSUInteger)value;
+// UTF-8 without a terminating NUL, valid as long as the batch
+- (const char*) bytesOfString:(NSUInteger)value length:(NSUInteger*)length;
+- (id) objectForValue:(NSUInteger)value;
+
+// Keys are numbered from 0 to keyCount - 1 in the order they first appear in the batch.
+@property (readonly) NSUInteger keyCount;
+- (NSString*) keyAtIndex:(NSUInteger)key;
+// NSNotFound when no object in the batch has the key
+- (NSUInteger) indexOfKey:(NSString*)key;
+
+// NSNotFound when the object does not have the key
+- (NSUInteger) memberWithKey:(NSUInteger)key inObject:(NSUInteger)object;
+- (NSUInteger) memberAtIndex:(NSUInteger)index ofValue:(NSUInteger)value;
+// key is NSNotFound for array elements
+- (void) enumerateMembersOfValue:(NSUInteger)value usingBlock:(void (^)(NSUInteger key, NSUInteger member, BOOL *stop))block;
+
+@end
+
+typedef NS_ENUM(NSInteger, RethinkDBChangeFeedOverflow) {
+    // forget the oldest pending change to make room for a new one
+    RethinkDBChangeFeedDropOldest,
+    // forget changes that arrive while the queue is full
+    RethinkDBChangeFeedDropNewest,
+    // fold a change into the pending one for the same document, dropping the oldest when that is not possible
+    RethinkDBChangeFeedMerge
+};
+
+// The cursor for a changes: query. A CONTINUE is always outstanding, so changes arrive as soon as the server has
+// them and wait for the consumer in a queue of at most maximumPending changes. each:fail: delivers
+// {old_val, new_val} dictionaries, including the initial values asked for with include_initial.
 @interface RethinkDBChangeFeed : RethinkDBCursor
 
+// Changes keep arriving and queueing while delivery is paused.
+- (void) pause;
+- (void) resume;
+
+// Fold pending changes to the same document into one, as the server's squash option does but at the client.
+@property (assign) BOOL squash;
+// the field squash and merge use to tell documents apart, id by default
+@property (copy) NSString *primaryKey;
+// 0 for no limit
+@property (assign) NSUInteger maximumPending;
+@property (assign) RethinkDBChangeFeedOverflow overflow;
+@property (readonly) NSUInteger pendingCount;
+@property (readonly) uint64_t droppedCount;
+
+// The last state reported with include_states, such as initializing or ready. nil when there was none.
+@property (readonly) NSString *state;
+// Called in order with the changes, one at a time with them, so ready comes after the initial values. Like the
+// changes it waits while delivery is paused.
+@property (copy) RethinkDbStateBlock stateChanged;
+
+@end
+
+// One subscriber's share of a changes: query run once for everyone who subscribed to it. Each subscriber
+// has its own buffer of sharedFeedBufferSize changes, and when a slow subscriber falls that far behind
+// its oldest changes are dropped so that the others are not held up.
+@interface RethinkDBFeedSubscription : NSObject
+
+// Returning NO from the change block cancels the subscription too. The server feed is closed once
+// every subscriber has cancelled.
+- (void) cancel;
+
+@property (readonly) uint64_t droppedCount;
+
+@end
+
+typedef NS_ENUM(NSInteger, RethinkDBLatencyPhase) {
+    // wrapping a finished term in a START query with the client's global options. Terms are built as the
+    // query is chained together, before it is run, so that isn't included - nor is it for arena queries,
+    // which are built and encoded in one step and only record RethinkDBLatencyEncode.
+    RethinkDBLatencyStartQuery,
+    // serializing the query for the wire
+    RethinkDBLatencyEncode,
+    // waiting for the socket lock to queue the frame
+    RethinkDBLatencyLockWait,
+    // writing a batch of frames to the socket
+    RethinkDBLatencyWrite,
+    // from the query being handed to the connection to its response arriving
+    RethinkDBLatencyRoundTrip,
+    // decoding a response
+    RethinkDBLatencyDecode,
+    // from a response arriving to its success or error block being called
+    RethinkDBLatencyCallback,
+    RethinkDBLatencyPhaseCount
+};
+
+// Times in nanoseconds, kept in log-linear buckets that are within about 6% of the recorded value.
+@interface RethinkDBLatencyHistogram : NSObject
+
+- (uint64_t) valueAtPercentile:(double)percentile;
+
+@property (readonly) uint64_t count;
+@property (readonly) uint64_t minimum;
+@property (readonly) uint64_t maximum;
+@property (readonly) double mean;
+
+@end
+
+// A snapshot of a connection's counters and latency histograms. A pool's snapshot adds up its connections.
+@interface RethinkDBMetrics : NSObject
+
+- (RethinkDBLatencyHistogram*) histogramForPhase:(RethinkDBLatencyPhase)phase;
+
+@property (readonly) uint64_t queriesSent;
+@property (readonly) uint64_t responsesReceived;
+@property (readonly) uint64_t bytesSent;
+@property (readonly) uint64_t bytesReceived;
+@property (readonly) NSUInteger inFlightCount;
+@property (readonly) NSUInteger openCursorCount;
+// an estimate of the response bytes held by cursors for rows their consumers have not taken yet
+@property (readonly) NSUInteger bufferedBatchBytes;
+
+@end
+
+typedef void (^RethinkDbMetricsBlock)(RethinkDBMetrics *metrics);
+
+// Plays back the START queries of a file written by -[RethinkDbClient startCaptureToFile:bufferSize:error:].
+// CONTINUE and STOP queries are left out, cursors that come back are closed once their first batch arrives.
+// Only captures of JSON protocol connections can be replayed.
+@interface RethinkDBCaptureReplay : NSObject
+
+- (instancetype) initWithContentsOfFile:(NSString*)path error:(NSError**)error;
+
+// A speed of 1 keeps the recorded gaps between queries, 10 plays them ten times faster and 0 sends them as
+// fast as possible. Returns once every query has been answered, NO if any of them failed.
+- (BOOL) replayTo:(RethinkDbClient*)client speed:(double)speed error:(NSError**)error;
+
+@property (readonly) NSUInteger queryCount;
+// the time between the first and the last query in the capture
+@property (readonly) NSTimeInterval duration;
+// how many queries failed in the last replay
+@property (readonly) NSUInteger failedCount;
+
+@end
+
+// A read through cache of one table's documents for get: queries, made by -[RethinkDbClient cacheTable:maximumBytes:timeToLive:].
+// Documents are dropped once they are timeToLive seconds old, and the least recently used ones go once the cache
+// holds more than maximumBytes (both estimated, 0 for no limit). Missing documents are cached as NSNull, errors are not.
+// Concurrent misses for the same key share one query.
+@interface RethinkDBDocumentCache : NSObject
+
+- (void) invalidateKey:(id)key;
+- (void) invalidateAll;
+// drops the documents a change from a changes: query on the table touched
+- (void) applyChange:(NSDictionary*)change;
+// Subscribes to the changes of the table in the default database and applies each one. If the feed fails the
+// whole cache is invalidated.
+- (void) followChanges;
+- (void) stopFollowingChanges;
+
+@property (readonly) NSString *table;
+@property (readonly) NSUInteger maximumBytes;
+@property (readonly) NSTimeInterval timeToLive;
+// the field applyChange: takes keys from, id unless set
+@property (copy) NSString *primaryKey;
+
+@property (readonly) uint64_t hits;
+@property (readonly) uint64_t misses;
+@property (readonly) double hitRatio;
+@property (readonly) uint64_t evictions;
+@property (readonly) NSUInteger count;
+@property (readonly) NSUInteger bytesUsed;
+
+@end
+
+// A query built and serialized once by -[RethinkDBRunnable prepare]. Placeholder n takes values[n].
+// Prepared queries need a JSON protocol connection.
+@interface RethinkDBPreparedQuery : NSObject
+
+- (id) runWithValues:(NSArray*)values error:(NSError**)error;
+- (RethinkDBOperation*) runWithValues:(NSArray*)values then:(RethinkDbSuccessBlock)success fail:(RethinkDbErrorBlock)error;
+
+@property (readonly) NSUInteger placeholderCount;
+
 @end
 
 @protocol RethinkDBRunnable <NSObject>
 
 - (id) run:(NSError**)error;
+// sends the query with the noreply option: the server applies it but never answers
+- (BOOL) runNoReply:(NSError**)error;
 - (id <RethinkDBObject>) row;
 - (id <RethinkDBObject>) row:(NSString*)key;
 
 - (id <RethinkDBObject>) do:(RethinkDbExpressionFunction)expression withArguments:(NSArray*)arguments;
 
 - (RethinkDBOperation*) runThen:(RethinkDbSuccessBlock)success fail:(RethinkDbErrorBlock)error;
+// Encodes the query once so it can be run many times, with only its placeholder values encoded per run.
+- (RethinkDBPreparedQuery*) prepare;
 
 @end
 
@@ -132,6 +368,8 @@ typedef void (^RethinkDbArrayBlock)(NSArray *array);
 - (id <RethinkDBObject>) error;
 - (id <RethinkDBObject>) defaultAs:(id)value;
 - (id <RethinkDBObject>) expr:(id)value;
+// A slot filled in each time a prepared query runs, with the value at index in the values array.
+- (id <RethinkDBObject>) placeholder:(NSUInteger)index;
 - (id <RethinkDBObject>) js:(NSString*)script;
 - (id <RethinkDBObject>) coerceTo:(NSString*)type;
 - (id <RethinkDBObject>) typeOf;
@@ -224,6 +462,9 @@ typedef void (^RethinkDbArrayBlock)(NSArray *array);
 
 @protocol RethinkDBStream <RethinkDBSequence>
 
+// Subscribers to the same changes: query on a connection share one feed from the server. Queries with the
+// include_initial option are not shared, as a subscriber joining part way through would miss the initial values.
+- (RethinkDBFeedSubscription*) subscribe:(RethinkDbCursorValueBlock)change fail:(RethinkDbErrorBlock)error;
 
 @end
 
@@ -231,6 +472,12 @@ typedef void (^RethinkDbArrayBlock)(NSArray *array);
 
 - (id <RethinkDBObject>) insert:(id)object options:(NSDictionary*)options;
 - (id <RethinkDBObject>) insert:(id)object;
+// Inserts every document produced by the enumerator or source block (which returns nil when it is done)
+// in batches, with several batches in flight at once. The source is only asked for more documents when
+// a batch slot is free. Returns the write results of all batches merged together: counts are summed and
+// generated_keys are concatenated in document order.
+- (NSDictionary*) insertAll:(NSEnumerator*)documents options:(NSDictionary*)options error:(NSError**)error;
+- (NSDictionary*) insertFrom:(RethinkDbDocumentSource)source options:(NSDictionary*)options error:(NSError**)error;
 - (id <RethinkDBObject>) update:(id)object options:(NSDictionary*)options;
 - (id <RethinkDBObject>) update:(id)object;
 - (id <RethinkDBObject>) replace:(id)object options:(NSDictionary*)options;
@@ -272,6 +519,8 @@ typedef void (^RethinkDbArrayBlock)(NSArray *array);
 + (RethinkDbClient*) clientWithURL:(NSURL*)url andError:(NSError**)error;
 
 - (BOOL) close:(NSError**)error;
+// blocks until the server has applied every noreply query sent so far
+- (BOOL) noreplyWait:(NSError**)error;
 
 - (id <RethinkDBDatabase>) db: (NSString*)name;
 - (id <RethinkDBObject>) dbCreate:(NSString*)name;
@@ -280,4 +529,83 @@ typedef void (^RethinkDbArrayBlock)(NSArray *array);
 
 - (id <RethinkDBRunnable>) queryWithDictionary:(NSDictionary*)query;
 
+// Queries built from the returned client keep their terms in an arena rather than in protobuf objects,
+// which makes building and sending lots of small queries much cheaper: [[[r arena] table: @"x"] get: key]
+// A client such as [[r arena] table: @"x"] can be kept and used as the base of many queries, from any thread;
+// once its arena is a few kilobytes in size the queries built from it get arenas of their own.
+- (RethinkDbClient*) arena;
+
+// Queries sent close together are written to the socket in one go. A batch is written once it holds
+// maxWriteBatchSize queries, or writeLingerTime seconds after its first query if that is not zero.
+@property (assign) NSUInteger maxWriteBatchSize;
+@property (assign) NSTimeInterval writeLingerTime;
+
+// Limits used by insertAll:options:error: - a batch is sent once it holds bulkInsertBatchSize documents
+// or the next document would take its encoded size past bulkInsertBatchBytes (a single larger
+// document is sent by itself), and at most bulkInsertMaxInFlight batches wait for a response.
+@property (assign) NSUInteger bulkInsertBatchSize;
+@property (assign) NSUInteger bulkInsertBatchBytes;
+@property (assign) NSUInteger bulkInsertMaxInFlight;
+
+// The readAhead given to new cursors.
+@property (assign) NSUInteger cursorReadAhead;
+
+// How query results are decoded. Lazy and compact rows only apply to connections using the JSON protocol.
+@property (nonatomic) RethinkDBRowMode rowMode;
+
+// Field names and short string values in responses are shared through a table of this many strings per
+// connection instead of being allocated for every row. 0 turns interning off.
+@property (nonatomic) NSUInteger stringInternCapacity;
+// How often a decoded string was found in the intern table, and how often it had to be made.
+@property (readonly) uint64_t internedStringHits;
+@property (readonly) uint64_t internedStringMisses;
+
+// How many changes each subscriber to a shared feed can fall behind by before changes are dropped.
+@property (assign) NSUInteger sharedFeedBufferSize;
+
+// Metrics are off by default, and cost a flag check per query while they are off.
+@property (nonatomic) BOOL collectsMetrics;
+// nil unless metrics are being collected
+- (RethinkDBMetrics*) metrics;
+- (void) resetMetrics;
+// Collects metrics and hands a snapshot to the block every interval seconds. A nil block stops the reports.
+- (void) reportMetricsEvery:(NSTimeInterval)interval to:(RethinkDbMetricsBlock)block;
+
+// Records every frame sent and received, with its token and time, to a binary file that RethinkDBCaptureReplay
+// can play back. Frames are copied into a lock free ring of bufferSize bytes per direction that is written out in
+// the background, and are dropped rather than holding up the connection when the ring is full. Starting a new
+// capture stops the current one. Pools can not be captured.
+- (BOOL) startCaptureToFile:(NSString*)path bufferSize:(NSUInteger)bufferSize error:(NSError**)error;
+- (void) stopCapture;
+@property (readonly) uint64_t capturedFrameCount;
+@property (readonly) uint64_t droppedCaptureFrameCount;
+
+// get: queries with a string, number or array key on a table of the default database, made with table: and no
+// options, go through the table's cache once it has one. Asking for a table's cache again returns the existing one.
+- (RethinkDBDocumentCache*) cacheTable:(NSString*)table maximumBytes:(NSUInteger)maximumBytes timeToLive:(NSTimeInterval)timeToLive;
+- (void) stopCachingTable:(NSString*)table;
+
+// The same get: queries as a cache would take are collected and sent as one getAll:, window seconds
+// after the first of them or once maximumBatchSize different keys are waiting. The documents that come back are
+// matched to the keys by primaryKey (id if nil), and keys without one get NSNull. Misses in a cached table are
+// batched too.
+- (void) batchGetsOnTable:(NSString*)table primaryKey:(NSString*)primaryKey window:(NSTimeInterval)window maximumBatchSize:(NSUInteger)maximumBatchSize;
+- (void) stopBatchingGetsOnTable:(NSString*)table;
+
+@end
+
+// A set of connections, possibly to several cluster nodes, that is used exactly like a single client.
+// Each query is sent on the connection with the fewest queries in flight, so
+// [[pool table: @"x"] run: &error] runs on a pooled connection.
+@interface RethinkDBConnectionPool : RethinkDbClient
+
++ (RethinkDBConnectionPool*) poolWithURLs:(NSArray*)urls minimumSize:(NSUInteger)minimum maximumSize:(NSUInteger)maximum error:(NSError**)error;
++ (RethinkDBConnectionPool*) poolWithURL:(NSURL*)url minimumSize:(NSUInteger)minimum maximumSize:(NSUInteger)maximum error:(NSError**)error;
+
+// how often dead connections are dropped and the pool is topped back up to its minimum size
+@property (assign, nonatomic) NSTimeInterval healthCheckInterval;
+// a new connection is opened (up to the maximum size) once every connection has this many queries in flight
+@property (assign) NSUInteger growthThreshold;
+@property (readonly) NSUInteger size;
+
 @end
@@ -33,6 +33,19 @@
 #import "Internals/RethinkDBClient-Private.h"
 #import "Internals/RethinkDBCursors-Private.h"
 #import "Internals/QL2+JSON.h"
+#import "Internals/RethinkDBTokenTable.h"
+#import "Internals/RethinkDBResponse.h"
+#import "Internals/RethinkDBJSONDecoder.h"
+#import "Internals/RethinkDBFrameReader.h"
+#import "Internals/RethinkDBEventLoop.h"
+#import "Internals/RethinkDBPreparedQuery-Private.h"
+#import "Internals/RethinkDBTermArena.h"
+#import "Internals/RethinkDBStringTable.h"
+#import "Internals/RethinkDBFeedRegistry.h"
+#import "Internals/RethinkDBMetrics.h"
+#import "Internals/RethinkDBWireCapture.h"
+#import "Internals/RethinkDBDocumentCache.h"
+#import "Internals/RethinkDBGetBatcher.h"
 
 //#define DUMP_MESSAGES
 
@@ -44,17 +57,19 @@ static NSString* rethink_error = @"RethinkDB Error";
 #define RETHINK_ERROR(x,y) if(error) *error = [NSError errorWithDomain: rethink_error code: x userInfo: [NSDictionary dictionaryWithObject: y forKey: NSLocalizedDescriptionKey]]
 #define CHECK_NULL(x) (x == nil ? [NSNull null] : x)
 
+// field names are interned up to this many bytes, string values only when they are short enough to be enum-like
+#define INTERN_KEY_LENGTH 64
+#define INTERN_VALUE_LENGTH 16
+// queries derived from a client share its arena until it holds this much, then get their own
+#define ARENA_SHARED_BYTES 4096
+
 #pragma mark -
 #pragma mark RethingDBOperation
 
-@interface RethinkDBOperation (Private)
-
-@property (strong) Response *response;
-
-@end
-
 @implementation RethinkDBOperation {
-    __strong Response *_response;
+    __strong RethinkDBResponse *_response;
+    uint64_t sent_at;
+    uint64_t received_at;
 }
 
 - (id) initWithToken:(int64_t)aToken {
@@ -79,11 +94,11 @@ static NSString* rethink_error = @"RethinkDB Error";
     return self.response == nil;
 }
 
-- (Response*) response {
+- (RethinkDBResponse*) response {
     return _response;
 }
 
-- (void) setResponse:(Response *)aResponse {
+- (void) setResponse:(RethinkDBResponse *)aResponse {
     [self willChangeValueForKey: @"response"];
     [self willChangeValueForKey: @"isExecuting"];
     [self willChangeValueForKey: @"isFinished"];
@@ -92,6 +107,22 @@ static NSString* rethink_error = @"RethinkDB Error";
     [self didChangeValueForKey: @"isExecuting"];
     [self didChangeValueForKey: @"isFinished"];
 }
+
+- (uint64_t) sentAt {
+    return sent_at;
+}
+
+- (void) setSentAt:(uint64_t)sentAt {
+    sent_at = sentAt;
+}
+
+- (uint64_t) receivedAt {
+    return received_at;
+}
+
+- (void) setReceivedAt:(uint64_t)receivedAt {
+    received_at = receivedAt;
+}
 @end
 
 
@@ -151,7 +182,6 @@ static NSString* rethink_error = @"RethinkDB Error";
     int64_t token;
     NSInteger variable_number;
     BOOL json_mode;
-    int64_t json_token;
     
     __strong NSLock *token_lock;
     __strong NSLock *socket_lock;
@@ -162,11 +192,45 @@ static NSString* rethink_error = @"RethinkDB Error";
     __strong PBCodedOutputStream *pb_output_stream;
     __strong PBCodedInputStream *pb_input_stream;
     
-    NSUInteger expected_size;
-    __strong NSMutableData *_partial_data;
+    __strong RethinkDBFrameReader *frame_reader;
+    __strong RethinkDBEventLoop *event_loop;
+    
+    __strong dispatch_queue_t write_queue;
+    __strong NSMutableData *pending_writes;
+    __strong NSMutableData *spare_writes;
+    NSUInteger pending_count;
+    BOOL flush_scheduled;
     __strong Query *_query;
     __strong Term *_term;
-    __strong NSMutableArray *cursors;
+    __strong RethinkDBTermArena *term_arena;
+    rethinkdb_term_node *arena_node;
+    __strong RethinkDBTokenTable *operations;
+    __strong RethinkDBTokenTable *cursors;
+    __strong RethinkDBJSONDecoder *json_decoder;
+    dispatch_once_t feed_registry_once;
+    __strong RethinkDBFeedRegistry *feed_registry;
+    // set from a changes: with include_initial onwards, whose feed can't be joined part way through
+    BOOL unshared_feed;
+    BOOL collect_metrics;
+    dispatch_once_t metrics_once;
+    rethinkdb_metrics *metrics_data;
+    __strong dispatch_source_t metrics_timer;
+    // set and cleared with the socket lock held, and used for queries
+    __strong RethinkDBWireCapture *wire_capture;
+    // the same capture, only ever touched on the I/O thread, so responses are captured without taking a lock
+    __strong RethinkDBWireCapture *response_capture;
+    // the table a table: client names, when it isn't in some other database
+    __strong NSString *table_name;
+    // set on get: clients of cached or batched tables
+    __strong RethinkDBDocumentCache *document_cache;
+    __strong RethinkDBGetBatcher *get_batcher;
+    __strong id get_key;
+    dispatch_once_t tables_once;
+    __strong NSLock *tables_lock;
+    __strong NSMutableDictionary *document_caches;
+    __strong NSMutableDictionary *get_batchers;
+    BOOL caches_enabled;
+    BOOL batching_enabled;
 }
 
 #pragma mark -
@@ -310,10 +374,27 @@ static NSString* rethink_error = @"RethinkDB Error";
         socket_lock = [NSLock new];
         queue = [NSOperationQueue new];
         queue.name = [NSString stringWithFormat: @"RethinDB connection queue: %p", self];
+        write_queue = dispatch_queue_create("RethinkDB write queue", DISPATCH_QUEUE_SERIAL);
+        pending_writes = [NSMutableData new];
+        spare_writes = [NSMutableData new];
+        _maxWriteBatchSize = 64;
+        _writeLingerTime = 0;
+        _bulkInsertBatchSize = DEFAULT_BULK_INSERT_BATCH_SIZE;
+        _bulkInsertBatchBytes = DEFAULT_BULK_INSERT_BATCH_BYTES;
+        _bulkInsertMaxInFlight = DEFAULT_BULK_INSERT_MAX_IN_FLIGHT;
+        _cursorReadAhead = DEFAULT_CURSOR_READ_AHEAD;
+        _sharedFeedBufferSize = DEFAULT_SHARED_FEED_BUFFER_SIZE;
         
+        operations = [RethinkDBTokenTable new];
+        cursors = [RethinkDBTokenTable new];
+        json_decoder = [RethinkDBJSONDecoder new];
+        self.stringInternCapacity = DEFAULT_STRING_INTERN_CAPACITY;
+        frame_reader = [[RethinkDBFrameReader alloc] initWithTokenHeader: json_mode];
+        
+        // responses are read on the connection's own I/O thread
+        event_loop = [[RethinkDBEventLoop alloc] initWithName: [NSString stringWithFormat: @"RethinkDB I/O thread: %p", self]];
         [input_stream setDelegate: self];
-        [input_stream scheduleInRunLoop: [NSRunLoop currentRunLoop] forMode: NSDefaultRunLoopMode];
-        cursors = [NSMutableArray new];
+        [event_loop scheduleStream: input_stream];
     }
     
     return self;
@@ -323,6 +404,10 @@ static NSString* rethink_error = @"RethinkDB Error";
     self = [super init];
     if(self) {
         connection = parent;
+        if(parent) {
+            term_arena = [parent derivedArena];
+            unshared_feed = parent->unshared_feed;
+        }
     }
     
     return self;
@@ -330,18 +415,319 @@ static NSString* rethink_error = @"RethinkDB Error";
 
 - (void)dealloc
 {
+    [input_stream setDelegate: nil];
     [input_stream close];
     [output_stream close];
+    [event_loop stop];
+    if(metrics_timer) {
+        dispatch_source_cancel(metrics_timer);
+    }
+    if(metrics_data) {
+        rethinkdb_metrics_free(metrics_data);
+    }
 }
 
 #pragma mark -
 #pragma mark Properties
 
+- (void) setRowMode:(RethinkDBRowMode)rowMode {
+    _rowMode = rowMode;
+    json_decoder.lazyRows = rowMode == RethinkDBRowModeLazy;
+    json_decoder.compactRows = rowMode == RethinkDBRowModeCompact;
+}
+
+- (void) setStringInternCapacity:(NSUInteger)stringInternCapacity {
+    _stringInternCapacity = stringInternCapacity;
+    
+    if(stringInternCapacity) {
+        json_decoder.keyTable = [[RethinkDBStringTable alloc] initWithCapacity: stringInternCapacity maximumLength: INTERN_KEY_LENGTH];
+        json_decoder.valueTable = [[RethinkDBStringTable alloc] initWithCapacity: stringInternCapacity maximumLength: INTERN_VALUE_LENGTH];
+    } else {
+        json_decoder.keyTable = nil;
+        json_decoder.valueTable = nil;
+    }
+}
+
+- (uint64_t) internedStringHits {
+    if(connection) {
+        return [connection internedStringHits];
+    }
+    
+    return json_decoder.keyTable.hits + json_decoder.valueTable.hits;
+}
+
+- (uint64_t) internedStringMisses {
+    if(connection) {
+        return [connection internedStringMisses];
+    }
+    
+    return json_decoder.keyTable.misses + json_decoder.valueTable.misses;
+}
+
+- (void) setCollectsMetrics:(BOOL)collectsMetrics {
+    if(connection) {
+        [connection setCollectsMetrics: collectsMetrics];
+        return;
+    }
+    
+    // never freed while the connection is open, so a thread that saw the flag can keep recording
+    dispatch_once(&metrics_once, ^{
+        metrics_data = rethinkdb_metrics_create();
+    });
+    collect_metrics = collectsMetrics;
+}
+
+- (BOOL) collectsMetrics {
+    if(connection) {
+        return [connection collectsMetrics];
+    }
+    
+    return collect_metrics;
+}
+
+- (RethinkDBMetrics*) metrics {
+    if(connection) {
+        return [connection metrics];
+    }
+    
+    if(!collect_metrics) {
+        return nil;
+    }
+    
+    NSArray *open_cursors = [cursors allObjects];
+    NSUInteger buffered = 0;
+    for(RethinkDBCursor *cursor in open_cursors) {
+        buffered += [cursor bufferedBytes];
+    }
+    
+    return [[RethinkDBMetrics alloc] initWithMetrics: metrics_data inFlightCount: [operations count] openCursorCount: [open_cursors count] bufferedBatchBytes: buffered];
+}
+
+- (void) resetMetrics {
+    if(connection) {
+        [connection resetMetrics];
+        return;
+    }
+    
+    if(metrics_data) {
+        rethinkdb_metrics_reset(metrics_data);
+    }
+}
+
+- (void) reportMetricsEvery:(NSTimeInterval)interval to:(RethinkDbMetricsBlock)block {
+    if(connection) {
+        [connection reportMetricsEvery: interval to: block];
+        return;
+    }
+    
+    if(metrics_timer) {
+        dispatch_source_cancel(metrics_timer);
+        metrics_timer = nil;
+    }
+    if(block == nil || interval <= 0) {
+        return;
+    }
+    
+    self.collectsMetrics = YES;
+    
+    __weak RethinkDbClient *weak_self = self;
+    uint64_t nanoseconds = (uint64_t)(interval * NSEC_PER_SEC);
+    metrics_timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0));
+    dispatch_source_set_timer(metrics_timer, dispatch_time(DISPATCH_TIME_NOW, nanoseconds), nanoseconds, nanoseconds / 10);
+    dispatch_source_set_event_handler(metrics_timer, ^{
+        RethinkDBMetrics *snapshot = [weak_self metrics];
+        if(snapshot) {
+            block(snapshot);
+        }
+    });
+    dispatch_resume(metrics_timer);
+}
+
+- (BOOL) startCaptureToFile:(NSString*)path bufferSize:(NSUInteger)bufferSize error:(NSError**)error {
+    if(connection) {
+        return [connection startCaptureToFile: path bufferSize: bufferSize error: error];
+    }
+    
+    RethinkDBWireCapture *capture = [[RethinkDBWireCapture alloc] initWithPath: path protocol: json_mode ? VersionDummy_ProtocolJson : VersionDummy_ProtocolProtobuf bufferSize: bufferSize error: error];
+    if(capture == nil) {
+        return NO;
+    }
+    
+    [socket_lock lock];
+    RethinkDBWireCapture *previous = wire_capture;
+    wire_capture = capture;
+    [socket_lock unlock];
+    [self setResponseCapture: capture];
+    
+    [previous stop];
+    
+    return YES;
+}
+
+- (void) stopCapture {
+    if(connection) {
+        [connection stopCapture];
+        return;
+    }
+    
+    [socket_lock lock];
+    RethinkDBWireCapture *previous = wire_capture;
+    wire_capture = nil;
+    [socket_lock unlock];
+    [self setResponseCapture: nil];
+    
+    [previous stop];
+}
+
+// Waits for the I/O thread to pick up the capture, so every response to a captured query is captured too.
+- (void) setResponseCapture:(RethinkDBWireCapture*)capture {
+    [socket_lock lock];
+    RethinkDBEventLoop *loop = event_loop;
+    [socket_lock unlock];
+    if(loop) {
+        [loop performBlock:^{
+            response_capture = capture;
+        } waitUntilDone: YES];
+    } else {
+        response_capture = capture;
+    }
+}
+
+- (uint64_t) capturedFrameCount {
+    if(connection) {
+        return [connection capturedFrameCount];
+    }
+    
+    [socket_lock lock];
+    uint64_t result = wire_capture.capturedFrames;
+    [socket_lock unlock];
+    
+    return result;
+}
+
+- (uint64_t) droppedCaptureFrameCount {
+    if(connection) {
+        return [connection droppedCaptureFrameCount];
+    }
+    
+    [socket_lock lock];
+    uint64_t result = wire_capture.droppedFrames;
+    [socket_lock unlock];
+    
+    return result;
+}
+
+#pragma mark -
+#pragma mark Document caches and get: batching
+
+- (void) setUpTables {
+    dispatch_once(&tables_once, ^{
+        tables_lock = [NSLock new];
+        document_caches = [NSMutableDictionary new];
+        get_batchers = [NSMutableDictionary new];
+    });
+}
+
+- (RethinkDBDocumentCache*) cacheTable:(NSString*)table maximumBytes:(NSUInteger)maximumBytes timeToLive:(NSTimeInterval)timeToLive {
+    if(connection) {
+        return [[self rootClient] cacheTable: table maximumBytes: maximumBytes timeToLive: timeToLive];
+    }
+    
+    [self setUpTables];
+    [tables_lock lock];
+    RethinkDBDocumentCache *cache = [document_caches objectForKey: table];
+    if(cache == nil) {
+        cache = [[RethinkDBDocumentCache alloc] initWithClient: self table: table maximumBytes: maximumBytes timeToLive: timeToLive];
+        [document_caches setObject: cache forKey: table];
+        caches_enabled = YES;
+    }
+    [tables_lock unlock];
+    
+    return cache;
+}
+
+- (void) stopCachingTable:(NSString*)table {
+    if(connection) {
+        [[self rootClient] stopCachingTable: table];
+        return;
+    }
+    
+    [self setUpTables];
+    [tables_lock lock];
+    RethinkDBDocumentCache *cache = [document_caches objectForKey: table];
+    [document_caches removeObjectForKey: table];
+    [tables_lock unlock];
+    
+    [cache stopFollowingChanges];
+}
+
+- (RethinkDBDocumentCache*) cacheForTable:(NSString*)table {
+    // no lock per get: until something is cached
+    if(!caches_enabled) {
+        return nil;
+    }
+    
+    [tables_lock lock];
+    RethinkDBDocumentCache *cache = [document_caches objectForKey: table];
+    [tables_lock unlock];
+    
+    return cache;
+}
+
+- (void) batchGetsOnTable:(NSString*)table primaryKey:(NSString*)primaryKey window:(NSTimeInterval)window maximumBatchSize:(NSUInteger)maximumBatchSize {
+    if(connection) {
+        [[self rootClient] batchGetsOnTable: table primaryKey: primaryKey window: window maximumBatchSize: maximumBatchSize];
+        return;
+    }
+    
+    [self setUpTables];
+    RethinkDBGetBatcher *batcher = [[RethinkDBGetBatcher alloc] initWithClient: self table: table primaryKey: primaryKey window: window maximumBatchSize: maximumBatchSize];
+    [tables_lock lock];
+    RethinkDBGetBatcher *previous = [get_batchers objectForKey: table];
+    [get_batchers setObject: batcher forKey: table];
+    batching_enabled = YES;
+    [tables_lock unlock];
+    
+    [previous flush];
+}
+
+- (void) stopBatchingGetsOnTable:(NSString*)table {
+    if(connection) {
+        [[self rootClient] stopBatchingGetsOnTable: table];
+        return;
+    }
+    
+    [self setUpTables];
+    [tables_lock lock];
+    RethinkDBGetBatcher *batcher = [get_batchers objectForKey: table];
+    [get_batchers removeObjectForKey: table];
+    [tables_lock unlock];
+    
+    [batcher flush];
+}
+
+- (RethinkDBGetBatcher*) batcherForTable:(NSString*)table {
+    if(!batching_enabled) {
+        return nil;
+    }
+    
+    [tables_lock lock];
+    RethinkDBGetBatcher *batcher = [get_batchers objectForKey: table];
+    [tables_lock unlock];
+    
+    return batcher;
+}
+
 - (void) setTerm:(Term *)term {
     _term = term;
 }
 
 - (Term*) term {
+    if(_term == nil && arena_node) {
+        // only needed when the term leaves the arena, e.g. for the protobuf protocol
+        _term = [term_arena termForNode: arena_node];
+    }
+    
     return _term;
 }
 
@@ -352,7 +738,7 @@ static NSString* rethink_error = @"RethinkDB Error";
     
     Query_Builder* q = [Query_Builder new];
     q.type = Query_QueryTypeStart;
-    q.query = _term;
+    q.query = self.term;
     
     return [q build];
 }
@@ -382,65 +768,76 @@ static NSString* rethink_error = @"RethinkDB Error";
 }
 #endif
 
+- (void) handleFrame:(const uint8_t*)bytes length:(NSUInteger)length token:(int64_t)frame_token {
+#ifdef DUMP_MESSAGES
+    NSLog(@"< <<%@>>", [self dumpData: [NSData dataWithBytesNoCopy: (void*)bytes length: length freeWhenDone: NO]]);
+#endif
+    RethinkDBResponse *response;
+    NSError *decode_error = nil;
+    
+    if(response_capture) {
+        [response_capture captureResponse: bytes length: length token: frame_token];
+    }
+    
+    uint64_t arrived = collect_metrics ? rethinkdb_metrics_now() : 0;
+    
+    if(json_mode) {
+        response = [json_decoder decodeResponse: bytes length: length token: frame_token error: &decode_error];
+    } else {
+        response = [self decodeProtobufResponse: [Response parseFromData: [NSData dataWithBytesNoCopy: (void*)bytes length: length freeWhenDone: NO]]];
+    }
+    response.length = length;
+    
+    if(arrived) {
+        rethinkdb_metrics_record(metrics_data, RethinkDBLatencyDecode, arrived);
+        rethinkdb_metrics_count(&metrics_data->responses_received, 1);
+        rethinkdb_metrics_count(&metrics_data->bytes_received, length + (json_mode ? 12 : 4));
+    }
+    
+    if(response == nil && frame_token > 0) {
+        // the frame itself was whole, so only the query it answers fails
+        NSString *message = [NSString stringWithFormat: @"Could not decode response: %@", [decode_error localizedDescription]];
+        response = [[RethinkDBResponse alloc] initWithToken: frame_token type: Response_ResponseTypeClientError results: [NSArray arrayWithObject: message] notes: nil];
+    }
+    
+    if(response == nil) {
+        NSLog(@"Could not decode response: %@", decode_error);
+    } else if(response.token > 0) {
+        RethinkDBOperation *rethink_op = [operations removeObjectForToken: response.token];
+        
+        if(rethink_op) {
+            if(arrived && rethink_op.sentAt) {
+                rethinkdb_metrics_record_between(metrics_data, RethinkDBLatencyRoundTrip, rethink_op.sentAt, arrived);
+                rethink_op.receivedAt = arrived;
+            }
+            RethinkDBCursor *cursor = [cursors objectForToken: response.token];
+            if(cursor) {
+                // this is the answer to a CONTINUE, so hand the batch to the cursor
+                [cursor receiveResponse: response];
+            }
+            rethink_op.response = response;
+        } else {
+            NSLog(@"Could not find an operation with the token: %lld", response.token);
+        }
+    } else {
+        NSLog(@"Got a response without a token!");
+    }
+}
+
 - (void)stream:(NSStream *)theStream handleEvent:(NSStreamEvent)streamEvent {
     switch (streamEvent) {
         case NSStreamEventEndEncountered:
-            [theStream close];
-            [theStream removeFromRunLoop:[NSRunLoop currentRunLoop] forMode:NSDefaultRunLoopMode];
+            [self connectionLost: @"The server closed the connection"];
             break;
 
         case NSStreamEventHasBytesAvailable: {
-            if(_partial_data == nil) {
-                if(json_mode) {
-                    json_token = [pb_input_stream readRawLittleEndian64];
-                }
-                expected_size = [pb_input_stream readRawLittleEndian32];
-                _partial_data = [NSMutableData dataWithCapacity: expected_size];
-            }
-            
-            NSData *block = [pb_input_stream readRawData: (int32_t)(expected_size - _partial_data.length)];
-
-            [_partial_data appendData: block];
+            NSError *read_error = nil;
+            BOOL ok = [frame_reader readFromStream: input_stream frames:^(int64_t frame_token, const uint8_t *bytes, NSUInteger length) {
+                [self handleFrame: bytes length: length token: frame_token];
+            } error: &read_error];
             
-            if(block.length == expected_size) {
-#ifdef DUMP_MESSAGES
-                NSLog(@"< <<%@>>", [self dumpData: _partial_data]);
-#endif
-                Response *response;
-                
-                if(json_mode) {
-                    response = [Response fromJSON: _partial_data withToken: json_token];
-                } else {
-                    response = [Response parseFromData: _partial_data];
-                }
-                _partial_data = nil;
-                
-                if(response.hasToken) {
-                    NSArray *ops = [queue operations];
-                    RethinkDBOperation *rethink_op = nil;
-
-                    for(NSOperation *op in ops) {
-                        if([op isKindOfClass: [RethinkDBOperation class]]) {
-                            RethinkDBOperation *rop = (RethinkDBOperation*)op;
-                            
-#ifdef DUMP_MESSAGES
-                            NSLog(@"rop.token = %lld", rop.token);
-#endif
-                            if(rop.token == response.token) {
-                                rethink_op = rop;
-                                break;
-                            }
-                        }
-                    }
-                    
-                    if(rethink_op) {
-                        rethink_op.response = response;
-                    } else {
-                        NSLog(@"Could not find an operation with the token: %lld", rethink_op.token);
-                    }
-                } else {
-                    NSLog(@"Got a response without a token!");
-                }
+            if(!ok) {
+                [self connectionLost: [NSString stringWithFormat: @"Error reading from the connection: %@", [read_error localizedDescription]]];
             }
             break;
         }
@@ -449,6 +846,7 @@ static NSString* rethink_error = @"RethinkDB Error";
         case NSStreamEventHasSpaceAvailable:
             break;
         case NSStreamEventErrorOccurred:
+            [self connectionLost: [NSString stringWithFormat: @"Error reading from the connection: %@", [[theStream streamError] localizedDescription]]];
             break;
         case NSStreamEventNone:
             break;
@@ -660,11 +1058,11 @@ static NSDictionary* term_name_to_type = nil;
 #pragma mark Cursor stuff
 
 - (void) addCursor:(RethinkDBCursor*)cursor {
-    [cursors addObject: cursor];
+    [cursors setObject: cursor forToken: cursor.token];
 }
 
 - (void) removeCursor:(RethinkDBCursor*)cursor {
-    [cursors removeObject: cursor];
+    [cursors removeObjectForToken: cursor.token];
 }
 
 #pragma mark -
@@ -728,37 +1126,34 @@ static NSDictionary* term_name_to_type = nil;
     return result;
 }
 
-- (id) decodeAtomResponse:(Response*) response {
-    Datum* datum = [response.response objectAtIndex: 0];
+- (RethinkDBResponse*) decodeProtobufResponse:(Response*) response {
+    NSMutableArray *notes = [NSMutableArray arrayWithCapacity: response.notes.count];
+    NSUInteger C = response.notes.count;
+    for(NSUInteger i=0; i<C; i++) {
+        [notes addObject: [NSNumber numberWithInt: [response notesAtIndex: i]]];
+    }
     
-    return [self decodeDatum: datum];
+    return [[RethinkDBResponse alloc] initWithToken: response.hasToken ? response.token : 0
+                                               type: response.type
+                                            results: [self decodeArray: response.response]
+                                              notes: notes];
 }
 
-- (id) decodeErrorResponse:(Response*) response {
+- (id) decodeAtomResponse:(RethinkDBResponse*) response {
+    return [response.results firstObject];
+}
+
+- (id) decodeErrorResponse:(RethinkDBResponse*) response {
     // TODO: properly decode an error response into a dictionary
     return [response description];
 }
 
-- (id) decodeSequence:(Response*) response {
-    RethinkDBCursor *cursor = nil;
-    for (RethinkDBCursor *c in cursors) {
-        if(c.token == response.token) {
-            cursor = c;
-            break;
-        }
-    }
+- (id) decodeSequence:(RethinkDBResponse*) response {
+    RethinkDBCursor *cursor = [cursors objectForToken: response.token];
     
-    if(cursor) {
-        cursor.response = response;
-        cursor.rows = [self decodeArray: response.response];
-        
-        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
-            [cursor handleBatch];
-        });
-    } else {
-        NSUInteger C = response.notes.count;
-        for(NSUInteger i=0; i<C; i++) {
-            Response_ResponseNote note = [response notesAtIndex: i];
+    if(cursor == nil) {
+        for(NSNumber *n in response.notes) {
+            Response_ResponseNote note = [n intValue];
             switch (note) {
                 case Response_ResponseNoteSequenceFeed:
                 case Response_ResponseNoteAtomFeed:
@@ -780,16 +1175,15 @@ static NSDictionary* term_name_to_type = nil;
         
         if(cursor == nil) {
             cursor = [[RethinkDBSequenceCursor alloc] initWithClient: self andToken: response.token];
-            cursor.response = response;
-            cursor.rows = [self decodeArray: response.response];
-            [self addCursor: cursor];
         }
+        [self addCursor: cursor];
+        [cursor receiveResponse: response];
     }
  
     return cursor;
 }
 
-- (id) decodeResponse:(Response*) response {
+- (id) decodeResponse:(RethinkDBResponse*) response {
     switch (response.type) {
         case Response_ResponseTypeClientError:
         case Response_ResponseTypeRuntimeError:
@@ -806,7 +1200,7 @@ static NSDictionary* term_name_to_type = nil;
             return [self decodeSequence: response];
             
         case Response_ResponseTypeWaitComplete:
-            return [NSError errorWithDomain: rethink_error code: -1 userInfo: [NSDictionary dictionaryWithObject: @"WAIT_COMPLETE responses not yet implemented" forKey: NSLocalizedDescriptionKey]];
+            return [NSNumber numberWithBool: YES];
     }
     
     return [NSError errorWithDomain: rethink_error code: -1 userInfo: [NSDictionary dictionaryWithObject: @"Invalid response type" forKey: NSLocalizedDescriptionKey]];
@@ -827,7 +1221,7 @@ static NSDictionary* term_name_to_type = nil;
     
     Term_Builder* term = [Term_Builder new];
     term.type = Term_TermTypeDatum;
-    term.datum = [Datum datumFromNSObject: object];
+    term.datum = [RethinkDBValueDatum datumWithValue: object];
     
     return [term build];
 }
@@ -897,57 +1291,284 @@ static NSDictionary* term_name_to_type = nil;
     return client;
 }
 
-- (RethinkDBOperation*) transmitAsync:(Query_Builder*) query {
+#pragma mark -
+#pragma mark Arena terms
+
+// Once an arena holds more than one query's worth of terms its client is being used as the base of others, so
+// each query derived from it gets an arena of its own and that one stops growing. The new arena keeps the
+// base's alive, as nodeForObject: does for any node from another arena.
+- (RethinkDBTermArena*) derivedArena {
+    if(term_arena && term_arena.bytesUsed >= ARENA_SHARED_BYTES) {
+        return [RethinkDBTermArena new];
+    }
+    
+    return term_arena;
+}
+
+- (RethinkDbClient*) arena {
+    RethinkDbClient* client = [[RethinkDbClient alloc] initWithConnection: self];
+    client->term_arena = [RethinkDBTermArena new];
+    if(arena_node || _term) {
+        client->arena_node = [client nodeForObject: self];
+    }
+    
+    return client;
+}
+
+- (rethinkdb_term_node*) nodeForObject:(id)object {
+    if([object isKindOfClass: [RethinkDbClient class]]) {
+        RethinkDbClient* client = (RethinkDbClient*)object;
+        
+        if(client->arena_node) {
+            if(client->term_arena != term_arena) {
+                [term_arena keepObject: client->term_arena];
+            }
+            return client->arena_node;
+        }
+        return [term_arena nodeWithValue: client.term];
+    }
+    if([object isKindOfClass: [NSPredicate class]]) {
+        @throw [NSException exceptionWithName: rethink_error reason: @"NSPredicate support is not yet implemented" userInfo: nil];
+    }
+    
+    // Terms and plain values are both leaves, the encoder tells them apart
+    return [term_arena nodeWithValue: object];
+}
+
+// The arena counterparts of termWithType: - without an arena they build the Term straight away.
+- (RethinkDbClient*) clientWithType:(Term_TermType)type args:(NSArray*)args andOptions:(NSDictionary*)options {
+    if(term_arena == nil) {
+        return [self clientWithTerm: [self termWithType: type args: args andOptions: options]];
+    }
+    
+    // the new query's arena, which may not be this one's
+    RethinkDbClient* client = [[RethinkDbClient alloc] initWithConnection: self];
+    RethinkDBTermArena* arena = client->term_arena;
+    rethinkdb_term_node* node = [arena nodeWithType: type argCount: [args count] optargCount: [options count]];
+    uint32_t i = 0;
+    for(id arg in args) {
+        node->args[i++] = [client nodeForObject: arg];
+    }
+    
+    __block uint32_t j = 0;
+    [options enumerateKeysAndObjectsUsingBlock:^(NSString* key, id obj, BOOL *stop) {
+        [arena keepObject: key];
+        node->optarg_keys[j] = key;
+        node->optarg_values[j] = [client nodeForObject: obj];
+        j++;
+    }];
+    client->arena_node = node;
+    
+    return client;
+}
+
+- (RethinkDbClient*) clientWithType:(Term_TermType)type andArgs:(NSArray*)args {
+    return [self clientWithType: type args: args andOptions: nil];
+}
+
+- (RethinkDbClient*) clientWithType:(Term_TermType)type andOptions:(NSDictionary*)options {
+    return [self clientWithType: type args: nil andOptions: options];
+}
+
+- (RethinkDbClient*) clientWithType:(Term_TermType)type {
+    return [self clientWithType: type args: nil andOptions: nil];
+}
+
+- (RethinkDbClient*) clientWithType:(Term_TermType)type arg:(id)arg andOptions:(NSDictionary*)options {
+    return [self clientWithType: type args: [NSArray arrayWithObject: CHECK_NULL(arg)] andOptions: options];
+}
+
+- (RethinkDbClient*) clientWithType:(Term_TermType)type andArg:(id)arg {
+    return [self clientWithType: type args: [NSArray arrayWithObject: CHECK_NULL(arg)] andOptions: nil];
+}
+
+- (BOOL) encodesJSON {
+    if(connection) {
+        return [connection encodesJSON];
+    }
+    
+    return json_mode;
+}
+
+// Arena queries on a JSON connection are written straight from their nodes.
+- (const uint8_t*) encodeJSON:(size_t*)length {
+    Query_Builder* query = [self queryBuilder];
+    query.type = Query_QueryTypeStart;
+    
+    if(arena_node) {
+        return [[query build] encodeJSONWithNode: arena_node length: length];
+    }
+    
+    query.query = self.term;
+    return [[query build] encodeJSON: length];
+}
+
+#pragma mark -
+#pragma mark Sending
+
+// Queries are appended to a pending buffer and written to the socket in batches, so a burst
+// of small queries costs one write call rather than one per query.
+- (void) enqueueFrame:(NSData*)data withToken:(int64_t)query_token {
+    [self enqueueFrameBytes: [data bytes] length: [data length] withToken: query_token];
+}
+
+- (void) enqueueFrameBytes:(const uint8_t*)bytes length:(NSUInteger)length withToken:(int64_t)query_token {
+    uint32_t size = CFSwapInt32HostToLittle((uint32_t)length);
+    uint64_t wire_token = CFSwapInt64HostToLittle((uint64_t)query_token);
+    BOOL flush_now;
+    BOOL schedule;
+    
+#ifdef DUMP_MESSAGES
+    NSLog(@"> <<%@>>", [self dumpData: [NSData dataWithBytesNoCopy: (void*)bytes length: length freeWhenDone: NO]]);
+#endif
+    uint64_t lock_start = collect_metrics ? rethinkdb_metrics_now() : 0;
+    [socket_lock lock];
+    if(lock_start) {
+        rethinkdb_metrics_record(metrics_data, RethinkDBLatencyLockWait, lock_start);
+        rethinkdb_metrics_count(&metrics_data->queries_sent, 1);
+    }
+    if(wire_capture) {
+        [wire_capture captureQuery: bytes length: length token: query_token];
+    }
+    if(json_mode) {
+        [pending_writes appendBytes: &wire_token length: sizeof(wire_token)];
+    }
+    [pending_writes appendBytes: &size length: sizeof(size)];
+    [pending_writes appendBytes: bytes length: length];
+    pending_count++;
+    
+    flush_now = pending_count >= _maxWriteBatchSize;
+    schedule = !flush_scheduled;
+    flush_scheduled = YES;
+    [socket_lock unlock];
+    
+    if(flush_now || (schedule && _writeLingerTime <= 0)) {
+        dispatch_async(write_queue, ^{
+            [self flushWrites];
+        });
+    } else if(schedule) {
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(_writeLingerTime * NSEC_PER_SEC)), write_queue, ^{
+            [self flushWrites];
+        });
+    }
+}
+
+- (void) flushWrites {
+    NSMutableData *batch;
+    NSOutputStream *stream;
+    
+    [socket_lock lock];
+    // close: may clear output_stream from any thread, so hold on to it for the whole write
+    stream = output_stream;
+    batch = pending_writes;
+    pending_writes = spare_writes;
+    spare_writes = nil;
+    pending_count = 0;
+    flush_scheduled = NO;
+    [socket_lock unlock];
+    
+    uint64_t write_start = collect_metrics ? rethinkdb_metrics_now() : 0;
+    const uint8_t *bytes = [batch bytes];
+    NSUInteger remaining = [batch length];
+    NSError *write_error = nil;
+    while(remaining > 0 && stream) {
+        NSInteger written = [stream write: bytes maxLength: remaining];
+        if(written <= 0) {
+            write_error = [stream streamError];
+            break;
+        }
+        bytes += written;
+        remaining -= written;
+    }
+    if(write_start) {
+        rethinkdb_metrics_record(metrics_data, RethinkDBLatencyWrite, write_start);
+        rethinkdb_metrics_count(&metrics_data->bytes_sent, [batch length] - remaining);
+    }
+    
+    // hand the buffer back for the next batch so steady traffic doesn't allocate
+    [batch setLength: 0];
+    [socket_lock lock];
+    spare_writes = batch;
+    [socket_lock unlock];
+    
+    if(remaining > 0) {
+        // part of a frame may have gone out, so nothing more can be sent on this connection
+        [self failOperationsInFlight: write_error ? [NSString stringWithFormat: @"Error writing to the connection: %@", [write_error localizedDescription]] : @"Error writing to the connection"];
+        // close: waits for this queue, so it has to run somewhere else
+        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            [self close: nil];
+        });
+    }
+}
+
+- (int64_t) nextToken {
+    int64_t result;
+    
+    [token_lock lock];
+    result = token++;
+    [token_lock unlock];
+    
+    return result;
+}
+
+- (int64_t) assignToken:(Query_Builder*) query {
     int64_t query_token;
     if(![query hasToken]) {
-        [token_lock lock];
-        query_token = token++;
-        [token_lock unlock];
+        query_token = [self nextToken];
         [query setToken: query_token];
     } else {
         query_token = query.token;
     }
     
-    NSBlockOperation *send_op = [NSBlockOperation blockOperationWithBlock:^{
-        Query *q = [query build];
-        NSData *data;
-        if(json_mode) {
-            data = [q toJSON];            
-        } else {
-            data = [q data];
+    return query_token;
+}
+
+- (void) sendQuery:(Query_Builder*) query {
+    uint64_t start = collect_metrics ? rethinkdb_metrics_now() : 0;
+    Query *q = [query build];
+    if(json_mode) {
+        // encoded into this thread's buffer and copied straight into the pending writes
+        size_t length;
+        const uint8_t *bytes = [q encodeJSON: &length];
+        if(start) {
+            rethinkdb_metrics_record(metrics_data, RethinkDBLatencyEncode, start);
         }
-        uint32_t size = (uint32_t)[data length];
-        [socket_lock lock];
-        @try {
-            if(json_mode) {
-                [pb_output_stream writeRawLittleEndian64: query_token];
-            }
-            [pb_output_stream writeRawLittleEndian32: size];
-#ifdef DUMP_MESSAGES
-            NSLog(@"> <<%@>>", [self dumpData: data]);
-#endif
-            [pb_output_stream writeRawData: data];
-            [pb_output_stream flush];
-        } @finally {
-            [socket_lock unlock];
+        [self enqueueFrameBytes: bytes length: length withToken: q.token];
+    } else {
+        NSData *data = [q data];
+        if(start) {
+            rethinkdb_metrics_record(metrics_data, RethinkDBLatencyEncode, start);
         }
-    }];
+        [self enqueueFrame: data withToken: q.token];
+    }
+}
+
+- (RethinkDBOperation*) transmitAsync:(Query_Builder*) query {
+    int64_t query_token = [self assignToken: query];
     
     RethinkDBOperation *response_op = [[RethinkDBOperation alloc] initWithToken: query_token];
-    [response_op addDependency: send_op];
-    
-    [queue addOperation: send_op];
+    if(collect_metrics) {
+        response_op.sentAt = rethinkdb_metrics_now();
+    }
+    // register before sending so the reader can never see a response it doesn't know about
+    RethinkDBOperation *registered = [operations addObject: response_op forToken: query_token];
+    if(registered != response_op) {
+        // a STOP sent while a CONTINUE is outstanding - the server only answers one of them for sure, so both
+        // wait on the CONTINUE's operation rather than leaving one that may never finish
+        [self sendQuery: query];
+        return registered;
+    }
     [queue addOperation: response_op];
     
+    [self sendQuery: query];
+    
     return response_op;
 }
 
-- (Response*) transmit:(Query_Builder*) query {
+- (RethinkDBResponse*) transmit:(Query_Builder*) query {
     RethinkDBOperation *op = [self transmitAsync: query];
-    NSRunLoop *loop = [NSRunLoop currentRunLoop];
-    while(!op.isFinished) {
-        [loop runUntilDate: [NSDate date]];
-    }
+    [op waitUntilFinished];
+    
     return [op response];
 }
 
@@ -959,18 +1580,14 @@ static NSDictionary* term_name_to_type = nil;
         return [connection nextVariable];
     }
     
-    return variable_number++;
+    [token_lock lock];
+    NSInteger result = variable_number++;
+    [token_lock unlock];
+    
+    return result;
 }
 
-- (RethinkDBOperation*) run:(Term*) toRun withQuery:(Query*)query then:(RethinkDbSuccessBlock)success fail:(RethinkDbErrorBlock)error {
-    if(connection) {
-        return [connection run: toRun withQuery: (query ? query : _query) then: success fail: error];
-    }
-    
-    if(input_stream == nil || output_stream == nil) {
-        @throw [NSException exceptionWithName: rethink_error reason: @"not connected" userInfo: nil];
-    }
-    
+- (Query_Builder*) startQuery:(Term*) toRun withQuery:(Query*)query {
     Query_Builder* toExecute = [Query_Builder new];
     [toExecute mergeFrom: _query];
     toExecute.type = Query_QueryTypeStart;
@@ -982,15 +1599,41 @@ static NSDictionary* term_name_to_type = nil;
     toExecute.type = Query_QueryTypeStart;
     toExecute.query = toRun;
     
-    RethinkDBOperation *op = [self transmitAsync: toExecute];
+    return toExecute;
+}
+
+- (RethinkDBOperation*) run:(Term*) toRun withQuery:(Query*)query then:(RethinkDbSuccessBlock)success fail:(RethinkDbErrorBlock)error {
+    if(connection) {
+        return [connection run: toRun withQuery: (query ? query : _query) then: success fail: error];
+    }
+    
+    if(input_stream == nil || output_stream == nil) {
+        @throw [NSException exceptionWithName: rethink_error reason: @"not connected" userInfo: nil];
+    }
+    
+    uint64_t start = collect_metrics ? rethinkdb_metrics_now() : 0;
+    Query_Builder *start_query = [self startQuery: toRun withQuery: query];
+    if(start) {
+        rethinkdb_metrics_record(metrics_data, RethinkDBLatencyStartQuery, start);
+    }
+    RethinkDBOperation *op = [self transmitAsync: start_query];
+    
+    return [self completeOperation: op then: success fail: error];
+}
+
+// Decodes the response once the operation finishes and hands it to the success or error block.
+- (RethinkDBOperation*) completeOperation:(RethinkDBOperation*)op then:(RethinkDbSuccessBlock)success fail:(RethinkDbErrorBlock)error {
     NSBlockOperation *after = [NSBlockOperation blockOperationWithBlock:^{
-        Response* response = op.response;
-        if(response.type == Response_ResponseTypeClientError || response.type == Response_ResponseTypeCompileError || response.type == Response_ResponseTypeRuntimeError) {
+        RethinkDBResponse* response = op.response;
+        if(op.receivedAt) {
+            rethinkdb_metrics_record(metrics_data, RethinkDBLatencyCallback, op.receivedAt);
+        }
+        if([response isError]) {
             if(error) {
                 // TODO: give more details when something goes wrong
-                Datum* errorDatum = [[response response] objectAtIndex: 0];
+                NSString* message = [response.results firstObject];
                 NSError *err = [NSError errorWithDomain: rethink_error code: response.type userInfo: [NSDictionary dictionaryWithObjectsAndKeys:
-                                                                                                      errorDatum.rStr, NSLocalizedDescriptionKey,
+                                                                                                      message, NSLocalizedDescriptionKey,
                                                                                                       [self decodeErrorResponse: response], @"RethinkDB Response",
                                                                                                       nil]];
                 
@@ -1011,41 +1654,198 @@ static NSDictionary* term_name_to_type = nil;
     return op;
 }
 
-- (RethinkDBOperation*) runThen:(RethinkDbSuccessBlock)success fail:(RethinkDbErrorBlock)error {
-    if(_term == nil) {
-        @throw [NSException exceptionWithName: rethink_error reason: @"No query term" userInfo: nil];
+- (RethinkDBOperation*) runEncoded:(const uint8_t*)bytes length:(NSUInteger)length then:(RethinkDbSuccessBlock)success fail:(RethinkDbErrorBlock)error {
+    if(connection) {
+        return [connection runEncoded: bytes length: length then: success fail: error];
     }
     
+    if(input_stream == nil || output_stream == nil) {
+        @throw [NSException exceptionWithName: rethink_error reason: @"not connected" userInfo: nil];
+    }
+    
+    if(!json_mode) {
+        if(error) {
+            error([NSError errorWithDomain: rethink_error code: -1 userInfo: [NSDictionary dictionaryWithObject: @"Prepared queries need a JSON protocol connection" forKey: NSLocalizedDescriptionKey]]);
+        }
+        return nil;
+    }
+    
+    int64_t query_token = [self nextToken];
+    RethinkDBOperation *op = [[RethinkDBOperation alloc] initWithToken: query_token];
+    if(collect_metrics) {
+        op.sentAt = rethinkdb_metrics_now();
+    }
+    [operations setObject: op forToken: query_token];
+    [queue addOperation: op];
+    [self enqueueFrameBytes: bytes length: length withToken: query_token];
+    
+    return [self completeOperation: op then: success fail: error];
+}
+
+- (BOOL) runEncodedNoReply:(const uint8_t*)bytes length:(NSUInteger)length error:(NSError**)error {
     if(connection) {
-        return [connection runThen: success fail: error];
+        return [connection runEncodedNoReply: bytes length: length error: error];
     }
     
-    return nil;
+    if(input_stream == nil || output_stream == nil) {
+        RETHINK_ERROR(NSURLErrorNotConnectedToInternet, @"not connected");
+        return NO;
+    }
+    
+    if(!json_mode) {
+        RETHINK_ERROR(-1, @"Encoded queries need a JSON protocol connection");
+        return NO;
+    }
+    
+    // the server never answers, so there is nothing to register
+    [self enqueueFrameBytes: bytes length: length withToken: [self nextToken]];
+    
+    return YES;
+}
+
+- (RethinkDBPreparedQuery*) prepare {
+    if(self.term == nil) {
+        @throw [NSException exceptionWithName: rethink_error reason: @"No query term" userInfo: nil];
+    }
+    
+    Query_Builder *query = [self queryBuilder];
+    query.type = Query_QueryTypeStart;
+    query.query = self.term;
+    
+    return [[RethinkDBPreparedQuery alloc] initWithClient: self template: [[RethinkDBQueryTemplate alloc] initWithQuery: [query build]]];
+}
+
+- (RethinkDbClient*) placeholder:(NSUInteger)index {
+    return [self expr: [RethinkDBPlaceholder placeholderWithIndex: index]];
+}
+
+- (RethinkDBOperation*) runThen:(RethinkDbSuccessBlock)success fail:(RethinkDbErrorBlock)error {
+    if(document_cache) {
+        return [document_cache get: get_key load:^(RethinkDbSuccessBlock loaded, RethinkDbErrorBlock failed) {
+            [self runUncachedThen: loaded fail: failed];
+        } then: success fail: error];
+    }
+    
+    return [self runUncachedThen: success fail: error];
+}
+
+- (RethinkDBOperation*) runUncachedThen:(RethinkDbSuccessBlock)success fail:(RethinkDbErrorBlock)error {
+    if(get_batcher) {
+        return [get_batcher get: get_key then: success fail: error];
+    }
+    
+    if(arena_node && _term == nil && [self encodesJSON]) {
+        RethinkDbClient *root = [self rootClient];
+        uint64_t start = root->collect_metrics ? rethinkdb_metrics_now() : 0;
+        size_t length;
+        const uint8_t *bytes = [self encodeJSON: &length];
+        if(start) {
+            // arena terms are built as the query is chained together, so building and encoding are one step
+            rethinkdb_metrics_record(root->metrics_data, RethinkDBLatencyEncode, start);
+        }
+        
+        return [self runEncoded: bytes length: length then: success fail: error];
+    }
+    
+    if(self.term == nil) {
+        @throw [NSException exceptionWithName: rethink_error reason: @"No query term" userInfo: nil];
+    }
+    
+    return [self run: _term withQuery: _query then: success fail: error];
 }
 
 - (id) run:(Term*) toRun withQuery:(Query*)query error:(NSError**) error {
+    return [self waitFor:^RethinkDBOperation *(RethinkDbSuccessBlock success, RethinkDbErrorBlock fail) {
+        return [self run: toRun withQuery: query then: success fail: fail];
+    } error: error];
+}
+
+- (id) waitFor:(RethinkDBOperation* (^)(RethinkDbSuccessBlock success, RethinkDbErrorBlock fail))start error:(NSError**) error {
     __block id result = nil;
-    __block BOOL done = NO;
+    __block NSError *failure = nil;
+    dispatch_semaphore_t done = dispatch_semaphore_create(0);
     
-    NSOperation* op = [self run: toRun withQuery: query then:^(id response) {
+    NSOperation* op = start(^(id response) {
         result = response;
-        done = YES;
-    } fail:^(NSError *err) {
-        if(error) {
-            *error = err;
-        }
-        done = YES;
-    }];
+        dispatch_semaphore_signal(done);
+    }, ^(NSError *err) {
+        failure = err;
+        dispatch_semaphore_signal(done);
+    });
+    
+    if(op) {
+        dispatch_semaphore_wait(done, DISPATCH_TIME_FOREVER);
+    }
     
-    while(op && !done) {
-        [[NSRunLoop currentRunLoop] runUntilDate: [NSDate date]];
+    if(failure) {
+        ERROR(failure);
     }
 
     return result;
 }
 
+- (BOOL) runNoReply:(Term*) toRun withQuery:(Query*)query error:(NSError**) error {
+    if(connection) {
+        return [connection runNoReply: toRun withQuery: (query ? query : _query) error: error];
+    }
+    
+    if(input_stream == nil || output_stream == nil) {
+        RETHINK_ERROR(NSURLErrorNotConnectedToInternet, @"not connected");
+        return NO;
+    }
+    
+    Query_Builder* toExecute = [self startQuery: toRun withQuery: query];
+    Query_AssocPair_Builder* noreply = [Query_AssocPair_Builder new];
+    noreply.key = @"noreply";
+    noreply.val = [self exprTerm: [NSNumber numberWithBool: YES]];
+    [toExecute addGlobalOptargs: [noreply build]];
+    
+    // the server never answers, so there is nothing to register
+    [self assignToken: toExecute];
+    [self sendQuery: toExecute];
+    
+    return YES;
+}
+
+- (BOOL) runNoReply:(NSError**)error {
+    if(self.term) {
+        return [self runNoReply: _term withQuery: _query error: error];
+    }
+    
+    RETHINK_ERROR(-1, @"No query specified");
+    return NO;
+}
+
+- (BOOL) noreplyWait:(NSError**)error {
+    if(connection) {
+        return [connection noreplyWait: error];
+    }
+    
+    if(input_stream == nil || output_stream == nil) {
+        RETHINK_ERROR(NSURLErrorNotConnectedToInternet, @"not connected");
+        return NO;
+    }
+    
+    Query_Builder* wait = [Query_Builder new];
+    wait.type = Query_QueryTypeNoreplyWait;
+    RethinkDBResponse* response = [self transmit: wait];
+    
+    if(response.type != Response_ResponseTypeWaitComplete) {
+        RETHINK_ERROR(response.type, [response isError] ? [response.results firstObject] : @"Unexpected response to NOREPLY_WAIT");
+        return NO;
+    }
+    
+    return YES;
+}
+
 - (id) run:(NSError**)error {
-    if(_term) {
+    if(document_cache || get_batcher || (arena_node && _term == nil && [self encodesJSON])) {
+        return [self waitFor:^RethinkDBOperation *(RethinkDbSuccessBlock success, RethinkDbErrorBlock fail) {
+            return [self runThen: success fail: fail];
+        } error: error];
+    }
+    
+    if(self.term) {
         id result = [self run: _term withQuery: _query error: error];
         
         return result;
@@ -1055,13 +1855,78 @@ static NSDictionary* term_name_to_type = nil;
     return nil;
 }
 
+- (NSUInteger) inFlightCount {
+    return [operations count];
+}
+
+- (BOOL) isConnected {
+    // the I/O thread closes the connection when the server goes away, so don't use the streams unlocked
+    [socket_lock lock];
+    NSInputStream *input = input_stream;
+    NSOutputStream *output = output_stream;
+    [socket_lock unlock];
+    
+    if(input == nil || output == nil) {
+        return NO;
+    }
+    
+    NSStreamStatus in_status = [input streamStatus];
+    NSStreamStatus out_status = [output streamStatus];
+    
+    return in_status != NSStreamStatusError && in_status != NSStreamStatusClosed && in_status != NSStreamStatusAtEnd &&
+           out_status != NSStreamStatusError && out_status != NSStreamStatusClosed && out_status != NSStreamStatusAtEnd;
+}
+
+// Answers every query still waiting for a response with a client error, once the server can no longer send one.
+- (void) failOperationsInFlight:(NSString*)message {
+    for(RethinkDBOperation *op in [operations allObjects]) {
+        if([operations removeObjectForToken: op.token] != op) {
+            // the response arrived after all
+            continue;
+        }
+        
+        RethinkDBResponse *response = [[RethinkDBResponse alloc] initWithToken: op.token type: Response_ResponseTypeClientError results: [NSArray arrayWithObject: message] notes: nil];
+        [[cursors objectForToken: op.token] receiveResponse: response];
+        op.response = response;
+    }
+}
+
+// Called on the I/O thread when the server goes away: nothing more will arrive, so everything still waiting
+// fails with the reason, and the connection is torn down as close: does.
+- (void) connectionLost:(NSString*)message {
+    [self failOperationsInFlight: message];
+    [self close: nil];
+}
+
 - (BOOL) close:(NSError**)error {
-    [input_stream close];
-    [output_stream close];
+    [self stopCapture];
+    
+    // the I/O thread, a failed write and the caller can all get here, so only one of them takes the streams
+    [socket_lock lock];
+    RethinkDBEventLoop *loop = event_loop;
+    NSInputStream *input = input_stream;
+    NSOutputStream *output = output_stream;
+    event_loop = nil;
     pb_input_stream = nil;
     pb_output_stream = nil;
     input_stream = nil;
     output_stream = nil;
+    [socket_lock unlock];
+    
+    if(input) {
+        [loop removeStream: input];
+        [input setDelegate: nil];
+    }
+    [loop stop];
+    
+    // let a flush that already took the output stream finish with it before it is closed
+    if(write_queue) {
+        dispatch_sync(write_queue, ^{});
+    }
+    [input close];
+    [output close];
+    // nothing more can arrive, so don't leave anyone waiting
+    [self failOperationsInFlight: @"The connection was closed"];
     
     return YES;
 }
@@ -1070,22 +1935,22 @@ static NSDictionary* term_name_to_type = nil;
 #pragma mark database functions
 
 - (RethinkDbClient*) dbCreate:(NSString*)name {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeDbCreate andArg: name]];
+    return [self clientWithType: Term_TermTypeDbCreate andArg: name];
 }
 
 - (RethinkDbClient*) dbDrop:(NSString*)name {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeDbDrop andArg: name]];
+    return [self clientWithType: Term_TermTypeDbDrop andArg: name];
 }
 
 - (RethinkDbClient*) dbList {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeDbList]];
+    return [self clientWithType: Term_TermTypeDbList];
 }
 
 #pragma mark -
 #pragma mark table functions
 
 - (RethinkDbClient*) tableCreate:(NSString*)name options:(NSDictionary*)options {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeTableCreate arg: name andOptions: options]];
+    return [self clientWithType: Term_TermTypeTableCreate arg: name andOptions: options];
 }
 
 - (id <RethinkDBObject>) tableCreate:(NSString*)name {
@@ -1093,42 +1958,42 @@ static NSDictionary* term_name_to_type = nil;
 }
 
 - (RethinkDbClient*) tableDrop:(NSString*)name {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeTableDrop andArg: name]];
+    return [self clientWithType: Term_TermTypeTableDrop andArg: name];
 }
 
 - (RethinkDbClient*) tableList:(NSString*)db {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeTableList andArg: [self termWithType: Term_TermTypeDb andArg: db]]];
+    return [self clientWithType: Term_TermTypeTableList andArg: [self termWithType: Term_TermTypeDb andArg: db]];
 }
 
 - (RethinkDbClient*) tableList {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeTableList]];
+    return [self clientWithType: Term_TermTypeTableList];
 }
 
 - (RethinkDbClient*) indexCreate:(NSString*)name {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeIndexCreate andArg: name]];
+    return [self clientWithType: Term_TermTypeIndexCreate andArg: name];
 }
 
 - (RethinkDbClient*) indexDrop:(NSString*)name {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeIndexDrop andArg: name]];
+    return [self clientWithType: Term_TermTypeIndexDrop andArg: name];
 }
 
 - (RethinkDbClient*) indexList {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeIndexList]];
+    return [self clientWithType: Term_TermTypeIndexList];
 }
 
 - (RethinkDbClient*) indexStatus:(id)names {
     if([names isKindOfClass: [NSString class]]) {
-        return [self clientWithTerm: [self termWithType: Term_TermTypeIndexStatus andArg: names]];
+        return [self clientWithType: Term_TermTypeIndexStatus andArg: names];
     } else {
-        return [self clientWithTerm: [self termWithType: Term_TermTypeIndexStatus andArgs: names]];
+        return [self clientWithType: Term_TermTypeIndexStatus andArgs: names];
     }
 }
 
 - (RethinkDbClient*) indexWait:(id)names {
     if([names isKindOfClass: [NSString class]]) {
-        return [self clientWithTerm: [self termWithType: Term_TermTypeIndexWait andArg: names]];
+        return [self clientWithType: Term_TermTypeIndexWait andArg: names];
     } else {
-        return [self clientWithTerm: [self termWithType: Term_TermTypeIndexWait andArgs: names]];
+        return [self clientWithType: Term_TermTypeIndexWait andArgs: names];
     }
 }
 
@@ -1136,19 +2001,147 @@ static NSDictionary* term_name_to_type = nil;
 #pragma mark Writing data
 
 - (RethinkDbClient*) insert:(id)object options:(NSDictionary*)options {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeInsert
-                                               args: [NSArray arrayWithObjects: self, CHECK_NULL(object), nil]
-                                         andOptions: options]];
+    return [self clientWithType: Term_TermTypeInsert
+                           args: [NSArray arrayWithObjects: self, CHECK_NULL(object), nil]
+                     andOptions: options];
 }
 
 - (id <RethinkDBObject>) insert:(id)object {
     return [self insert: object options: nil];
 }
 
+- (RethinkDbClient*) rootClient {
+    RethinkDbClient* client = self;
+    while(client->connection) {
+        client = client->connection;
+    }
+    
+    return client;
+}
+
+static void merge_write_result(NSMutableDictionary* total, NSDictionary* result) {
+    [result enumerateKeysAndObjectsUsingBlock:^(NSString* key, id value, BOOL *stop) {
+        id existing = [total objectForKey: key];
+        
+        if(existing == nil) {
+            [total setObject: [value isKindOfClass: [NSArray class]] ? [value mutableCopy] : value forKey: key];
+        } else if([value isKindOfClass: [NSArray class]]) {
+            [existing addObjectsFromArray: value];
+        } else if([value isKindOfClass: [NSNumber class]] && value != (void*)kCFBooleanTrue && value != (void*)kCFBooleanFalse) {
+            [total setObject: [NSNumber numberWithLongLong: [existing longLongValue] + [value longLongValue]] forKey: key];
+        }
+        // anything else, such as first_error, keeps the value from the earliest batch
+    }];
+}
+
+- (NSDictionary*) insertFrom:(RethinkDbDocumentSource)source options:(NSDictionary*)options error:(NSError**)error {
+    RethinkDbClient* root = [self rootClient];
+    NSUInteger batch_size = MAX(root.bulkInsertBatchSize, 1);
+    NSUInteger batch_bytes = root.bulkInsertBatchBytes;
+    NSUInteger max_in_flight = MAX(root.bulkInsertMaxInFlight, 1);
+    
+    dispatch_semaphore_t slots = dispatch_semaphore_create(max_in_flight);
+    dispatch_group_t in_flight = dispatch_group_create();
+    NSLock* results_lock = [NSLock new];
+    // results are stored by batch number so generated_keys come back in the order the documents were read
+    NSMutableArray* results = [NSMutableArray new];
+    __block NSError* failure = nil;
+    // a document read for a batch that was already full
+    id carried = nil;
+    
+    BOOL exhausted = NO;
+    while(!exhausted) {
+        // back-pressure: don't pull any more documents until a batch slot is free
+        dispatch_semaphore_wait(slots, DISPATCH_TIME_FOREVER);
+        
+        [results_lock lock];
+        BOOL failed = failure != nil;
+        [results_lock unlock];
+        if(failed) {
+            dispatch_semaphore_signal(slots);
+            break;
+        }
+        
+        NSMutableArray* documents = [NSMutableArray arrayWithCapacity: MIN(batch_size, 1024)];
+        NSUInteger bytes = 0;
+        
+        while([documents count] < batch_size) {
+            id document = carried ? carried : source();
+            carried = nil;
+            if(document == nil) {
+                exhausted = YES;
+                break;
+            }
+            
+            // the document plus the comma between it and the one before
+            NSUInteger size = [RethinkDBValueDatum encodedLengthOfValue: document] + 1;
+            if(batch_bytes && [documents count] && bytes + size > batch_bytes) {
+                // it would take the batch over its byte limit, so it starts the next one
+                carried = document;
+                break;
+            }
+            bytes += size;
+            [documents addObject: document];
+        }
+        
+        if([documents count] == 0) {
+            dispatch_semaphore_signal(slots);
+            break;
+        }
+        
+        // the documents are encoded straight from the Foundation objects when the query is sent, no Datum tree is built
+        Term* insert = [self termWithType: Term_TermTypeInsert args: [NSArray arrayWithObjects: self, [self exprTerm: documents], nil] andOptions: options];
+        
+        [results_lock lock];
+        NSUInteger index = [results count];
+        [results addObject: [NSNull null]];
+        [results_lock unlock];
+        dispatch_group_enter(in_flight);
+        
+        [self run: insert withQuery: _query then:^(id response) {
+            [results_lock lock];
+            [results replaceObjectAtIndex: index withObject: response];
+            [results_lock unlock];
+            
+            dispatch_semaphore_signal(slots);
+            dispatch_group_leave(in_flight);
+        } fail:^(NSError *err) {
+            [results_lock lock];
+            if(failure == nil) {
+                failure = err;
+            }
+            [results_lock unlock];
+            
+            dispatch_semaphore_signal(slots);
+            dispatch_group_leave(in_flight);
+        }];
+    }
+    
+    dispatch_group_wait(in_flight, DISPATCH_TIME_FOREVER);
+    
+    if(failure) {
+        ERROR(failure);
+        return nil;
+    }
+    
+    NSMutableDictionary* total = [NSMutableDictionary new];
+    for(NSDictionary* result in results) {
+        merge_write_result(total, result);
+    }
+    
+    return total;
+}
+
+- (NSDictionary*) insertAll:(NSEnumerator*)documents options:(NSDictionary*)options error:(NSError**)error {
+    return [self insertFrom:^id{
+        return [documents nextObject];
+    } options: options error: error];
+}
+
 - (RethinkDbClient*) update:(id)object options:(NSDictionary*)options {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeUpdate
-                                               args: [NSArray arrayWithObjects: self, CHECK_NULL(object), nil]
-                                         andOptions: options]];
+    return [self clientWithType: Term_TermTypeUpdate
+                           args: [NSArray arrayWithObjects: self, CHECK_NULL(object), nil]
+                     andOptions: options];
 }
 
 - (id <RethinkDBObject>) update:(id)object {
@@ -1156,9 +2149,9 @@ static NSDictionary* term_name_to_type = nil;
 }
 
 - (RethinkDbClient*) replace:(id)object options:(NSDictionary*)options {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeReplace
-                                               args: [NSArray arrayWithObjects: self, CHECK_NULL(object), nil]
-                                         andOptions: options]];
+    return [self clientWithType: Term_TermTypeReplace
+                           args: [NSArray arrayWithObjects: self, CHECK_NULL(object), nil]
+                     andOptions: options];
 }
 
 - (id <RethinkDBObject>) replace:(id)object {
@@ -1166,9 +2159,9 @@ static NSDictionary* term_name_to_type = nil;
 }
 
 - (RethinkDbClient*) delete:(NSDictionary*)options {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeDelete
-                                                arg: self
-                                         andOptions: options]];
+    return [self clientWithType: Term_TermTypeDelete
+                            arg: self
+                     andOptions: options];
 }
 
 - (id <RethinkDBObject>) delete {
@@ -1176,7 +2169,7 @@ static NSDictionary* term_name_to_type = nil;
 }
 
 - (RethinkDbClient*) sync {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeSync andArg: self]];
+    return [self clientWithType: Term_TermTypeSync andArg: self];
 }
 
 #pragma mark -
@@ -1187,7 +2180,7 @@ static NSDictionary* term_name_to_type = nil;
     
     if(connection) {
         // this is a parameter to another function, so return a DB term
-        return [self clientWithTerm: [self termWithType: Term_TermTypeDb andArg: name]];
+        return [self clientWithType: Term_TermTypeDb andArg: name];
     } else {
         // this is the first thing in the query, so set the default database for the query
         RethinkDbClient* db = [[RethinkDbClient alloc] initWithConnection: self];
@@ -1208,8 +2201,25 @@ static NSDictionary* term_name_to_type = nil;
     }
 }
 
+// YES if neither this client nor the ones it was built from set a database for the query
+- (BOOL) usesDefaultDatabase {
+    for(RethinkDbClient* client = self; client; client = client->connection) {
+        if(client->_query) {
+            return NO;
+        }
+    }
+    
+    return YES;
+}
+
 - (RethinkDbClient*) table:(NSString*)name options:(NSDictionary*)options {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeTable arg: name andOptions: options]];
+    RethinkDbClient* client = [self clientWithType: Term_TermTypeTable arg: name andOptions: options];
+    // caches and batches are per table of the default database, read with the server's default options
+    if(_term == nil && arena_node == NULL && options == nil && [self usesDefaultDatabase]) {
+        client->table_name = name;
+    }
+    
+    return client;
 }
 
 - (id <RethinkDBTable>) table:(NSString*)name {
@@ -1217,15 +2227,42 @@ static NSDictionary* term_name_to_type = nil;
 }
 
 - (id <RethinkDBTable>) table:(NSString*)name db:(NSString*)database {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeTable andArgs: [NSArray arrayWithObjects: [self termWithType: Term_TermTypeDb andArg: database], name, nil]]];
+    return [self clientWithType: Term_TermTypeTable andArgs: [NSArray arrayWithObjects: [self termWithType: Term_TermTypeDb andArg: database], name, nil]];
+}
+
+// Strings, numbers and arrays of them - anything else, such as a term, is only known to the server.
+static BOOL is_plain_key(id key) {
+    if([key isKindOfClass: [NSString class]] || [key isKindOfClass: [NSNumber class]]) {
+        return YES;
+    }
+    if([key isKindOfClass: [NSArray class]]) {
+        for(id element in key) {
+            if(!is_plain_key(element)) {
+                return NO;
+            }
+        }
+        return YES;
+    }
+    
+    return NO;
 }
 
 - (RethinkDbClient*) get:(id)key {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeGet andArg: key]];
+    RethinkDbClient* client = [self clientWithType: Term_TermTypeGet andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(key), nil]];
+    if(table_name && is_plain_key(key)) {
+        RethinkDbClient* root = [self rootClient];
+        client->document_cache = [root cacheForTable: table_name];
+        client->get_batcher = [root batcherForTable: table_name];
+        if(client->document_cache || client->get_batcher) {
+            client->get_key = [key copy];
+        }
+    }
+    
+    return client;
 }
 
 - (RethinkDbClient*) getAll:(NSArray*)keys options:(NSDictionary*)options {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeGetAll args: keys andOptions: options]];
+    return [self clientWithType: Term_TermTypeGetAll args: [[NSArray arrayWithObject: self] arrayByAddingObjectsFromArray: keys] andOptions: options];
 }
 
 - (id <RethinkDBSequence>) getAll:(NSArray *)keys {
@@ -1233,9 +2270,9 @@ static NSDictionary* term_name_to_type = nil;
 }
 
 - (RethinkDbClient*) between:(id)lower and:(id)upper options:(NSDictionary*)options {
-    NSArray* args = [NSArray arrayWithObjects: CHECK_NULL(lower), CHECK_NULL(upper), nil];
+    NSArray* args = [NSArray arrayWithObjects: self, CHECK_NULL(lower), CHECK_NULL(upper), nil];
     
-    return [self clientWithTerm: [self termWithType: Term_TermTypeBetween args: args andOptions: options]];
+    return [self clientWithType: Term_TermTypeBetween args: args andOptions: options];
 }
 
 - (id <RethinkDBSequence>) between:(id)lower and:(id)upper {
@@ -1244,15 +2281,15 @@ static NSDictionary* term_name_to_type = nil;
 
 - (RethinkDbClient*) filter:(id)predicate options:(NSDictionary *)options {
     if([predicate isKindOfClass: [NSDictionary class]]) {
-        return [self clientWithTerm: [self termWithType: Term_TermTypeFilter args: [NSArray arrayWithObjects: self, CHECK_NULL(predicate), nil] andOptions: options]];
+        return [self clientWithType: Term_TermTypeFilter args: [NSArray arrayWithObjects: self, CHECK_NULL(predicate), nil] andOptions: options];
     }
     
     NSInteger variable = [self nextVariable];
     
-    Term* arg_array = [self termWithType: Term_TermTypeMakeArray andArg: [NSNumber numberWithInteger: variable]];
-    Term* func = [self termWithType: Term_TermTypeFunc andArgs: [NSArray arrayWithObjects: arg_array, CHECK_NULL(predicate), nil]];
+    RethinkDbClient* arg_array = [self clientWithType: Term_TermTypeMakeArray andArg: [NSNumber numberWithInteger: variable]];
+    RethinkDbClient* func = [self clientWithType: Term_TermTypeFunc andArgs: [NSArray arrayWithObjects: arg_array, CHECK_NULL(predicate), nil]];
 
-    return [self clientWithTerm: [self termWithType: Term_TermTypeFilter args: [NSArray arrayWithObjects: self, func, nil] andOptions: options]];
+    return [self clientWithType: Term_TermTypeFilter args: [NSArray arrayWithObjects: self, func, nil] andOptions: options];
 }
 
 - (id <RethinkDBSequence>) filter:(id)predicate {
@@ -1262,14 +2299,14 @@ static NSDictionary* term_name_to_type = nil;
 - (id <RethinkDBSequence>) filterWith:(RethinkDbFilterFunction) filter {
     NSNumber* param_num = [NSNumber numberWithInteger: [self nextVariable]];
     
-    RethinkDbClient* row = [self clientWithTerm: [self termWithType: Term_TermTypeVar andArg: param_num]];
+    RethinkDbClient* row = [self clientWithType: Term_TermTypeVar andArg: param_num];
     
     id <RethinkDBRunnable> body = filter(row);
     
     NSArray* args = [NSArray arrayWithObject: param_num];
-    Term* func = [self termWithType: Term_TermTypeFunc andArgs: [NSArray arrayWithObjects: args, body, nil]];
+    RethinkDbClient* func = [self clientWithType: Term_TermTypeFunc andArgs: [NSArray arrayWithObjects: args, body, nil]];
     
-    return [self clientWithTerm: [self termWithType: Term_TermTypeFilter andArgs: [NSArray arrayWithObjects: self, func, nil]]];
+    return [self clientWithType: Term_TermTypeFilter andArgs: [NSArray arrayWithObjects: self, func, nil]];
 }
 
 
@@ -1280,15 +2317,15 @@ static NSDictionary* term_name_to_type = nil;
     NSNumber* left_num = [NSNumber numberWithInteger: [self nextVariable]];
     NSNumber* right_num = [NSNumber numberWithInteger: [self nextVariable]];
     
-    RethinkDbClient* left = [self clientWithTerm: [self termWithType: Term_TermTypeVar andArg: left_num]];
-    RethinkDbClient* right = [self clientWithTerm: [self termWithType: Term_TermTypeVar andArg: right_num]];
+    RethinkDbClient* left = [self clientWithType: Term_TermTypeVar andArg: left_num];
+    RethinkDbClient* right = [self clientWithType: Term_TermTypeVar andArg: right_num];
     
     id <RethinkDBRunnable> body = predicate(left, right);
     
     NSArray* args = [NSArray arrayWithObjects: left_num, right_num, nil];
-    Term* func = [self termWithType: Term_TermTypeFunc andArgs: [NSArray arrayWithObjects: args, body, nil]];
+    RethinkDbClient* func = [self clientWithType: Term_TermTypeFunc andArgs: [NSArray arrayWithObjects: args, body, nil]];
     
-    return [self clientWithTerm: [self termWithType: (inner ? Term_TermTypeInnerJoin : Term_TermTypeOuterJoin) andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(sequence), func, nil]]];
+    return [self clientWithType: (inner ? Term_TermTypeInnerJoin : Term_TermTypeOuterJoin) andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(sequence), func, nil]];
 }
 
 - (RethinkDbClient*) innerJoin:(id)sequence on:(RethinkDbJoinPredicate)predicate {
@@ -1300,7 +2337,7 @@ static NSDictionary* term_name_to_type = nil;
 }
 
 - (RethinkDbClient*) eqJoin:(NSString*)key to:(id)sequence options:(NSDictionary*)options {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeEqJoin args: [NSArray arrayWithObjects: CHECK_NULL(key), CHECK_NULL(sequence), nil] andOptions: options]];
+    return [self clientWithType: Term_TermTypeEqJoin args: [NSArray arrayWithObjects: CHECK_NULL(key), CHECK_NULL(sequence), nil] andOptions: options];
 }
 
 - (id <RethinkDBSequence>) eqJoin:(NSString*)key to:(id)sequence {
@@ -1308,7 +2345,7 @@ static NSDictionary* term_name_to_type = nil;
 }
 
 - (RethinkDbClient*) zip {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeZip andArg: self]];
+    return [self clientWithType: Term_TermTypeZip andArg: self];
 }
 
 #pragma mark -
@@ -1317,14 +2354,14 @@ static NSDictionary* term_name_to_type = nil;
 - (RethinkDbClient*) mapLike:(RethinkDbMappingFunction) function type:(Term_TermType) type {
     NSNumber* param_num = [NSNumber numberWithInteger: [self nextVariable]];
     
-    RethinkDbClient* row = [self clientWithTerm: [self termWithType: Term_TermTypeVar andArg: param_num]];
+    RethinkDbClient* row = [self clientWithType: Term_TermTypeVar andArg: param_num];
     
     id <RethinkDBRunnable> body = function(row);
     
     NSArray* args = [NSArray arrayWithObject: param_num];
-    Term* func = [self termWithType: Term_TermTypeFunc andArgs: [NSArray arrayWithObjects: args, body, nil]];
+    RethinkDbClient* func = [self clientWithType: Term_TermTypeFunc andArgs: [NSArray arrayWithObjects: args, body, nil]];
     
-    return [self clientWithTerm: [self termWithType: type andArgs: [NSArray arrayWithObjects: self, func, nil]]];
+    return [self clientWithType: type andArgs: [NSArray arrayWithObjects: self, func, nil]];
 }
 
 - (RethinkDbClient*) map:(RethinkDbMappingFunction)function {
@@ -1333,7 +2370,7 @@ static NSDictionary* term_name_to_type = nil;
 
 - (RethinkDbClient*) withFields:(NSArray*)fields {
     NSArray* args = [[NSArray arrayWithObject: self] arrayByAddingObjectsFromArray: fields];
-    return [self clientWithTerm: [self termWithType: Term_TermTypeWithFields andArgs: args]];
+    return [self clientWithType: Term_TermTypeWithFields andArgs: args];
 }
 
 - (RethinkDbClient*) concatMap:(RethinkDbMappingFunction)function {
@@ -1342,31 +2379,31 @@ static NSDictionary* term_name_to_type = nil;
 
 - (RethinkDbClient*) orderBy:(id)order {
     if([order isKindOfClass: [NSString class]]) {
-        return [self clientWithTerm: [self termWithType: Term_TermTypeOrderBy andArgs: [NSArray arrayWithObjects: self, order, nil]]];
+        return [self clientWithType: Term_TermTypeOrderBy andArgs: [NSArray arrayWithObjects: self, order, nil]];
     }
     
     NSArray* args = [[NSArray arrayWithObject: self] arrayByAddingObjectsFromArray: order];
-    return [self clientWithTerm: [self termWithType: Term_TermTypeOrderBy andArgs: args]];
+    return [self clientWithType: Term_TermTypeOrderBy andArgs: args];
 }
 
 - (RethinkDbClient*) skip:(NSInteger)count {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeSkip andArgs: [NSArray arrayWithObjects: self, [NSNumber numberWithInteger: count], nil]]];
+    return [self clientWithType: Term_TermTypeSkip andArgs: [NSArray arrayWithObjects: self, [NSNumber numberWithInteger: count], nil]];
 }
 
 - (RethinkDbClient*) limit:(NSInteger)count {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeLimit andArgs: [NSArray arrayWithObjects: self, [NSNumber numberWithInteger: count], nil]]];
+    return [self clientWithType: Term_TermTypeLimit andArgs: [NSArray arrayWithObjects: self, [NSNumber numberWithInteger: count], nil]];
 }
 
 - (RethinkDbClient*) slice:(NSInteger)start to:(NSInteger)end {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeSlice andArgs: [NSArray arrayWithObjects: self, [NSNumber numberWithInteger: start], [NSNumber numberWithInteger: end], nil]]];
+    return [self clientWithType: Term_TermTypeSlice andArgs: [NSArray arrayWithObjects: self, [NSNumber numberWithInteger: start], [NSNumber numberWithInteger: end], nil]];
 }
 
 - (RethinkDbClient*) nth:(NSInteger)index {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeNth andArgs: [NSArray arrayWithObjects: self, [NSNumber numberWithInteger: index], nil]]];
+    return [self clientWithType: Term_TermTypeNth andArgs: [NSArray arrayWithObjects: self, [NSNumber numberWithInteger: index], nil]];
 }
 
 - (RethinkDbClient*) indexesOf:(id)datum {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeOffsetsOf andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(datum), nil]]];
+    return [self clientWithType: Term_TermTypeOffsetsOf andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(datum), nil]];
 }
 
 - (RethinkDbClient*) indexesOfPredicate:(RethinkDbMappingFunction)function {
@@ -1374,15 +2411,15 @@ static NSDictionary* term_name_to_type = nil;
 }
 
 - (RethinkDbClient*) inEmpty {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeIsEmpty andArg: self]];
+    return [self clientWithType: Term_TermTypeIsEmpty andArg: self];
 }
 
 - (RethinkDbClient*) union:(RethinkDbClient*)sequence {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeUnion andArgs: [NSArray arrayWithObjects: self, sequence, nil]]];
+    return [self clientWithType: Term_TermTypeUnion andArgs: [NSArray arrayWithObjects: self, sequence, nil]];
 }
 
 - (RethinkDbClient*) sample:(NSInteger)count {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeSample andArgs: [NSArray arrayWithObjects: self, [NSNumber numberWithInteger: count], nil]]];
+    return [self clientWithType: Term_TermTypeSample andArgs: [NSArray arrayWithObjects: self, [NSNumber numberWithInteger: count], nil]];
 }
 
 #pragma mark -
@@ -1392,8 +2429,8 @@ static NSDictionary* term_name_to_type = nil;
     NSNumber* acc_num = [NSNumber numberWithInteger: [self nextVariable]];
     NSNumber* val_num = [NSNumber numberWithInteger: [self nextVariable]];
     
-    RethinkDbClient* acc = [self clientWithTerm: [self termWithType: Term_TermTypeVar andArg: acc_num]];
-    RethinkDbClient* val = [self clientWithTerm: [self termWithType: Term_TermTypeVar andArg: acc_num]];
+    RethinkDbClient* acc = [self clientWithType: Term_TermTypeVar andArg: acc_num];
+    RethinkDbClient* val = [self clientWithType: Term_TermTypeVar andArg: acc_num];
     
     id <RethinkDBRunnable> body = function(acc, val);
     
@@ -1404,9 +2441,9 @@ static NSDictionary* term_name_to_type = nil;
     } else {
         args = [NSArray arrayWithObjects: arg_nums, body, nil];
     }
-    Term* func = [self termWithType: Term_TermTypeFunc andArgs: args];
+    RethinkDbClient* func = [self clientWithType: Term_TermTypeFunc andArgs: args];
     
-    return [self clientWithTerm: [self termWithType: Term_TermTypeReduce andArgs: [NSArray arrayWithObjects: self, func, nil]]];
+    return [self clientWithType: Term_TermTypeReduce andArgs: [NSArray arrayWithObjects: self, func, nil]];
 }
 
 - (id <RethinkDBObject>) reduce:(RethinkDbReductionFunction)function {
@@ -1414,11 +2451,11 @@ static NSDictionary* term_name_to_type = nil;
 }
 
 - (RethinkDbClient*) count {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeCount andArg: self]];
+    return [self clientWithType: Term_TermTypeCount andArg: self];
 }
 
 - (RethinkDbClient*) distinct {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeDistinct andArg: self]];
+    return [self clientWithType: Term_TermTypeDistinct andArg: self];
 }
 
 /*
@@ -1428,20 +2465,20 @@ static NSDictionary* term_name_to_type = nil;
     NSNumber* acc_num = [NSNumber numberWithInteger: [self nextVariable]];
     NSNumber* val_num = [NSNumber numberWithInteger: [self nextVariable]];
     
-    RethinkDbClient* group_var = [self clientWithTerm: [self termWithType: Term_TermTypeVar andArg: group_num]];
+    RethinkDbClient* group_var = [self clientWithType: Term_TermTypeVar andArg: group_num];
     id <RethinkDBRunnable> group_body = groupFunction(group_var);
     
-    RethinkDbClient* map_row = [self clientWithTerm: [self termWithType: Term_TermTypeVar andArg: map_num]];
+    RethinkDbClient* map_row = [self clientWithType: Term_TermTypeVar andArg: map_num];
     id <RethinkDBRunnable> map_body = mapFunction(map_row);
     
-    RethinkDbClient* acc = [self clientWithTerm: [self termWithType: Term_TermTypeVar andArg: acc_num]];
-    RethinkDbClient* val = [self clientWithTerm: [self termWithType: Term_TermTypeVar andArg: acc_num]];
+    RethinkDbClient* acc = [self clientWithType: Term_TermTypeVar andArg: acc_num];
+    RethinkDbClient* val = [self clientWithType: Term_TermTypeVar andArg: acc_num];
     
     id <RethinkDBRunnable> reduce_body = reduceFunction(acc, val);
     
-    RethinkDbClient* group_func = [self clientWithTerm: [self termWithType: Term_TermTypeFunc andArgs: [NSArray arrayWithObjects: [NSArray arrayWithObject: group_num], group_body, nil]]];
-    RethinkDbClient* map_func = [self clientWithTerm: [self termWithType: Term_TermTypeFunc andArgs: [NSArray arrayWithObjects: [NSArray arrayWithObject: map_num], map_body, nil]]];
-    RethinkDbClient* reduce_func = [self clientWithTerm: [self termWithType: Term_TermTypeFunc andArgs: [NSArray arrayWithObjects: [NSArray arrayWithObjects: acc_num, val_num, nil], reduce_body, nil]]];
+    RethinkDbClient* group_func = [self clientWithType: Term_TermTypeFunc andArgs: [NSArray arrayWithObjects: [NSArray arrayWithObject: group_num], group_body, nil]];
+    RethinkDbClient* map_func = [self clientWithType: Term_TermTypeFunc andArgs: [NSArray arrayWithObjects: [NSArray arrayWithObject: map_num], map_body, nil]];
+    RethinkDbClient* reduce_func = [self clientWithType: Term_TermTypeFunc andArgs: [NSArray arrayWithObjects: [NSArray arrayWithObjects: acc_num, val_num, nil], reduce_body, nil]];
     
     NSArray* args;
     if(base) {
@@ -1450,7 +2487,7 @@ static NSDictionary* term_name_to_type = nil;
         args = [NSArray arrayWithObjects: self, group_func, map_func, reduce_func, nil];
     }
     
-    return [self clientWithTerm: [self termWithType: Term_TermTypeGroupedMapReduce andArgs: args]];
+    return [self clientWithType: Term_TermTypeGroupedMapReduce andArgs: args];
 }
 
 - (id <RethinkDBObject>) group:(RethinkDbGroupByFunction)groupFunction map:(RethinkDbMappingFunction)mapFunction andReduce:(RethinkDbReductionFunction)reduceFunction {
@@ -1464,7 +2501,7 @@ static NSDictionary* term_name_to_type = nil;
     }
     
     Term* reduction_literal = [self termWithType: Term_TermTypeMakeObj andArg: reductionObject];    
-    return [self clientWithTerm: [self termWithType: Term_TermTypeGroup andArgs: [NSArray arrayWithObjects: self, columns, reduction_literal, nil]]];
+    return [self clientWithType: Term_TermTypeGroup andArgs: [NSArray arrayWithObjects: self, columns, reduction_literal, nil]];
 }
 
 - (id <RethinkDBObject>) groupByAndCount:(id)columns {
@@ -1485,29 +2522,29 @@ static NSDictionary* term_name_to_type = nil;
     }
     
     NSArray* args = [[NSArray arrayWithObject: self] arrayByAddingObjectsFromArray: values];
-    return [self clientWithTerm: [self termWithType: Term_TermTypeContains andArgs: args]];
+    return [self clientWithType: Term_TermTypeContains andArgs: args];
 }
 
 #pragma mark -
 #pragma mark Document manipulation
 
 - (RethinkDbClient*) at:(NSObject*)key {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeBracket andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(key), nil]]];
+    return [self clientWithType: Term_TermTypeBracket andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(key), nil]];
 }
 
 - (RethinkDbClient*) field:(NSString*)key {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeGetField andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(key), nil]]];
+    return [self clientWithType: Term_TermTypeGetField andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(key), nil]];
 }
 
 - (RethinkDbClient*) row {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeImplicitVar]];
+    return [self clientWithType: Term_TermTypeImplicitVar];
 }
 
 - (RethinkDbClient*) row:(NSString*)key {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeGetField andArgs: [NSArray arrayWithObjects:
-                                                                                     [self termWithType: Term_TermTypeImplicitVar],
-                                                                                     CHECK_NULL(key),
-                                                                                     nil]]];
+    return [self clientWithType: Term_TermTypeGetField andArgs: [NSArray arrayWithObjects:
+                                                                 [self termWithType: Term_TermTypeImplicitVar],
+                                                                 CHECK_NULL(key),
+                                                                 nil]];
 }
 
 - (RethinkDbClient*) pluck:(id)fields {
@@ -1516,7 +2553,7 @@ static NSDictionary* term_name_to_type = nil;
     }
     
     NSArray* args = [[NSArray arrayWithObject: self] arrayByAddingObjectsFromArray: fields];
-    return [self clientWithTerm: [self termWithType: Term_TermTypePluck andArgs: args]];
+    return [self clientWithType: Term_TermTypePluck andArgs: args];
 }
 
 - (RethinkDbClient*) without:(id)fields {
@@ -1525,39 +2562,39 @@ static NSDictionary* term_name_to_type = nil;
     }
     
     NSArray* args = [[NSArray arrayWithObject: self] arrayByAddingObjectsFromArray: fields];
-    return [self clientWithTerm: [self termWithType: Term_TermTypeWithout andArgs: args]];
+    return [self clientWithType: Term_TermTypeWithout andArgs: args];
 }
 
 - (RethinkDbClient*) merge:(id)object {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeMerge andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(object), nil]]];
+    return [self clientWithType: Term_TermTypeMerge andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(object), nil]];
 }
 
 - (RethinkDbClient*) append:(id)object {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeAppend andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(object), nil]]];
+    return [self clientWithType: Term_TermTypeAppend andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(object), nil]];
 }
 
 - (RethinkDbClient*) prepend:(id)object {
-    return [self clientWithTerm: [self termWithType: Term_TermTypePrepend andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(object), nil]]];
+    return [self clientWithType: Term_TermTypePrepend andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(object), nil]];
 }
 
 - (RethinkDbClient*) difference:(NSArray *)array {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeDifference andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(array), nil]]];
+    return [self clientWithType: Term_TermTypeDifference andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(array), nil]];
 }
 
 - (RethinkDbClient*) setInsert:(id)value {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeSetInsert andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(value), nil]]];
+    return [self clientWithType: Term_TermTypeSetInsert andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(value), nil]];
 }
 
 - (RethinkDbClient*) setUnion:(NSArray*)array {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeSetUnion andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(array), nil]]];
+    return [self clientWithType: Term_TermTypeSetUnion andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(array), nil]];
 }
 
 - (RethinkDbClient*) setIntersection:(NSArray*)array {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeSetIntersection andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(array), nil]]];
+    return [self clientWithType: Term_TermTypeSetIntersection andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(array), nil]];
 }
 
 - (RethinkDbClient*) setDifference:(NSArray*)array {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeSetDifference andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(array), nil]]];
+    return [self clientWithType: Term_TermTypeSetDifference andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(array), nil]];
 }
 
 - (RethinkDbClient*) hasFields:(id)fields {
@@ -1566,137 +2603,161 @@ static NSDictionary* term_name_to_type = nil;
     }
     
     NSArray* args = [[NSArray arrayWithObject: self] arrayByAddingObjectsFromArray: fields];
-    return [self clientWithTerm: [self termWithType: Term_TermTypeHasFields andArgs: args]];
+    return [self clientWithType: Term_TermTypeHasFields andArgs: args];
 }
 
 - (RethinkDbClient*) insert:(id)object at:(NSUInteger)index {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeInsertAt andArgs: [NSArray arrayWithObjects: self, [NSNumber numberWithInteger: index], CHECK_NULL(object), nil]]];
+    return [self clientWithType: Term_TermTypeInsertAt andArgs: [NSArray arrayWithObjects: self, [NSNumber numberWithInteger: index], CHECK_NULL(object), nil]];
 }
 
 - (RethinkDbClient*) splice:(NSArray*)objects at:(NSUInteger)index {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeSpliceAt andArgs: [NSArray arrayWithObjects: self, [NSNumber numberWithInteger: index], CHECK_NULL(objects), nil]]];
+    return [self clientWithType: Term_TermTypeSpliceAt andArgs: [NSArray arrayWithObjects: self, [NSNumber numberWithInteger: index], CHECK_NULL(objects), nil]];
 }
 
 - (RethinkDbClient*) deleteAt:(NSUInteger)index to:(NSUInteger)end_index {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeDeleteAt andArgs: [NSArray arrayWithObjects: self, [NSNumber numberWithInteger: index], [NSNumber numberWithInteger: end_index], nil]]];
+    return [self clientWithType: Term_TermTypeDeleteAt andArgs: [NSArray arrayWithObjects: self, [NSNumber numberWithInteger: index], [NSNumber numberWithInteger: end_index], nil]];
 }
 
 - (RethinkDbClient*) deleteAt:(NSUInteger)index {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeDeleteAt andArgs: [NSArray arrayWithObjects: self, [NSNumber numberWithInteger: index], nil]]];
+    return [self clientWithType: Term_TermTypeDeleteAt andArgs: [NSArray arrayWithObjects: self, [NSNumber numberWithInteger: index], nil]];
 }
 
 - (RethinkDbClient*) changeAt:(NSUInteger)index value:(id)value {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeChangeAt andArgs: [NSArray arrayWithObjects: self, [NSNumber numberWithInteger: index], CHECK_NULL(value), nil]]];
+    return [self clientWithType: Term_TermTypeChangeAt andArgs: [NSArray arrayWithObjects: self, [NSNumber numberWithInteger: index], CHECK_NULL(value), nil]];
 }
 
 - (RethinkDbClient*) keys {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeKeys andArg: self]];
+    return [self clientWithType: Term_TermTypeKeys andArg: self];
 }
 
 - (id <RethinkDBStream>) changes:(NSDictionary*)options {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeChanges arg: self andOptions: options]];
+    RethinkDbClient* client = [self clientWithType: Term_TermTypeChanges arg: self andOptions: options];
+    if([[options objectForKey: @"include_initial"] boolValue]) {
+        client->unshared_feed = YES;
+    }
+    
+    return client;
+}
+
+// Feeds are shared through the root client, so every query built from it, including through a pool, can join them.
+- (RethinkDBFeedSubscription*) subscribe:(RethinkDbCursorValueBlock)change fail:(RethinkDbErrorBlock)error {
+    RethinkDbClient* root = [self rootClient];
+    dispatch_once(&root->feed_registry_once, ^{
+        root->feed_registry = [RethinkDBFeedRegistry new];
+    });
+    
+    // two subscriptions share a feed when they would send exactly the same query, unless a later subscriber
+    // would miss the initial values
+    NSData* key = nil;
+    if(!unshared_feed) {
+        size_t length;
+        const uint8_t* bytes = [self encodeJSON: &length];
+        key = [NSData dataWithBytes: bytes length: length];
+    }
+    
+    return [root->feed_registry subscribeTo: self key: key bufferSize: root.sharedFeedBufferSize each: change fail: error];
 }
 
 #pragma mark -
 #pragma mark String manipulations
 
 - (RethinkDbClient*) match:(NSString*)regex {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeMatch andArgs: [NSArray arrayWithObjects: self, regex, nil]]];
+    return [self clientWithType: Term_TermTypeMatch andArgs: [NSArray arrayWithObjects: self, regex, nil]];
 }
 
 #pragma mark -
 #pragma mark Math and Logic
 
 - (RethinkDbClient*) add:(id)expr {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeAdd andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(expr), nil]]];
+    return [self clientWithType: Term_TermTypeAdd andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(expr), nil]];
 }
 
 - (RethinkDbClient*) sub:(id)expr {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeSub andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(expr), nil]]];
+    return [self clientWithType: Term_TermTypeSub andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(expr), nil]];
 }
 
 - (RethinkDbClient*) mul:(id)expr {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeMul andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(expr), nil]]];
+    return [self clientWithType: Term_TermTypeMul andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(expr), nil]];
 }
 
 - (RethinkDbClient*) div:(id)expr {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeDiv andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(expr), nil]]];
+    return [self clientWithType: Term_TermTypeDiv andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(expr), nil]];
 }
 
 - (RethinkDbClient*) mod:(id)expr {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeMod andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(expr), nil]]];
+    return [self clientWithType: Term_TermTypeMod andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(expr), nil]];
 }
 
 - (RethinkDbClient*) eq:(id)expr {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeEq andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(expr), nil]]];
+    return [self clientWithType: Term_TermTypeEq andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(expr), nil]];
 }
 
 - (RethinkDbClient*) ne:(id)expr {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeNe andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(expr), nil]]];
+    return [self clientWithType: Term_TermTypeNe andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(expr), nil]];
 }
 
 - (RethinkDbClient*) gt:(id)expr {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeGt andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(expr), nil]]];
+    return [self clientWithType: Term_TermTypeGt andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(expr), nil]];
 }
 
 - (RethinkDbClient*) ge:(id)expr {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeGe andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(expr), nil]]];
+    return [self clientWithType: Term_TermTypeGe andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(expr), nil]];
 }
 
 - (RethinkDbClient*) lt:(id)expr {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeLt andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(expr), nil]]];
+    return [self clientWithType: Term_TermTypeLt andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(expr), nil]];
 }
 
 - (RethinkDbClient*) le:(id)expr {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeLe andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(expr), nil]]];
+    return [self clientWithType: Term_TermTypeLe andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(expr), nil]];
 }
 
 - (RethinkDbClient*) not {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeNot andArg: self]];
+    return [self clientWithType: Term_TermTypeNot andArg: self];
 }
 
 - (RethinkDbClient*) and:(id)expr {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeAnd andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(expr), nil]]];
+    return [self clientWithType: Term_TermTypeAnd andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(expr), nil]];
 }
 
 - (RethinkDbClient*) or:(id)expr {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeOr andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(expr), nil]]];
+    return [self clientWithType: Term_TermTypeOr andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(expr), nil]];
 }
 
 - (RethinkDbClient*) any:(NSArray*)expressions {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeOr andArgs: expressions]];
+    return [self clientWithType: Term_TermTypeOr andArgs: expressions];
 }
 
 - (RethinkDbClient*) all:(NSArray*)expressions {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeAnd andArgs: expressions]];
+    return [self clientWithType: Term_TermTypeAnd andArgs: expressions];
 }
 
 #pragma mark -
 #pragma mark Dates and Times
 
 - (RethinkDbClient*) now {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeNow]];
+    return [self clientWithType: Term_TermTypeNow];
 }
 
 - (RethinkDbClient*) timeWithYear:(NSInteger)year month:(NSInteger)month day:(NSInteger)day timezone:(NSString*)time_zone {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeTime andArgs: [NSArray arrayWithObjects:
-                                                                                 [NSNumber numberWithInteger: year],
-                                                                                 [NSNumber numberWithInteger: month],
-                                                                                 [NSNumber numberWithInteger: day],
-                                                                                 CHECK_NULL(time_zone),
-                                                                                 nil]]];
+    return [self clientWithType: Term_TermTypeTime andArgs: [NSArray arrayWithObjects:
+                                                             [NSNumber numberWithInteger: year],
+                                                             [NSNumber numberWithInteger: month],
+                                                             [NSNumber numberWithInteger: day],
+                                                             CHECK_NULL(time_zone),
+                                                             nil]];
 }
 
 - (RethinkDbClient*) timeWithYear:(NSInteger)year month:(NSInteger)month day:(NSInteger)day hour:(NSInteger)hour minute:(NSInteger)minute seconds:(NSInteger)seconds timezone:(NSString*)time_zone {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeTime andArgs: [NSArray arrayWithObjects:
-                                                                                 [NSNumber numberWithInteger: year],
-                                                                                 [NSNumber numberWithInteger: month],
-                                                                                 [NSNumber numberWithInteger: day],
-                                                                                 [NSNumber numberWithInteger: hour],
-                                                                                 [NSNumber numberWithInteger: minute],
-                                                                                 [NSNumber numberWithInteger: seconds],
-                                                                                 CHECK_NULL(time_zone),
-                                                                                 nil]]];
+    return [self clientWithType: Term_TermTypeTime andArgs: [NSArray arrayWithObjects:
+                                                             [NSNumber numberWithInteger: year],
+                                                             [NSNumber numberWithInteger: month],
+                                                             [NSNumber numberWithInteger: day],
+                                                             [NSNumber numberWithInteger: hour],
+                                                             [NSNumber numberWithInteger: minute],
+                                                             [NSNumber numberWithInteger: seconds],
+                                                             CHECK_NULL(time_zone),
+                                                             nil]];
 }
 
 - (id <RethinkDBDateTime>) time:(NSDate*)date {
@@ -1707,19 +2768,19 @@ static NSDictionary* term_name_to_type = nil;
 }
 
 - (RethinkDbClient*) epochTime:(id)seconds {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeEpochTime andArg: seconds]];
+    return [self clientWithType: Term_TermTypeEpochTime andArg: seconds];
 }
 
 - (RethinkDbClient*) ISO8601:(id)time {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeIso8601 andArg: time]];
+    return [self clientWithType: Term_TermTypeIso8601 andArg: time];
 }
 
 - (RethinkDbClient*) inTimezone:(id)time_zone {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeInTimezone andArg: time_zone]];
+    return [self clientWithType: Term_TermTypeInTimezone andArg: time_zone];
 }
 
 - (RethinkDbClient*) timezone {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeTimezone andArg: self]];
+    return [self clientWithType: Term_TermTypeTimezone andArg: self];
 }
 
 - (RethinkDbClient*) during:(id)from to:(id)to options:(NSDictionary*)options {
@@ -1730,7 +2791,7 @@ static NSDictionary* term_name_to_type = nil;
         to = [self time: to];
     }
     
-    return [self clientWithTerm: [self termWithType: Term_TermTypeDuring andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(from), CHECK_NULL(to), nil]]];
+    return [self clientWithType: Term_TermTypeDuring andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(from), CHECK_NULL(to), nil]];
 }
 
 - (id <RethinkDBObject>) during:(id)from to:(id)to {
@@ -1738,51 +2799,51 @@ static NSDictionary* term_name_to_type = nil;
 }
 
 - (RethinkDbClient*) date {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeDate]];
+    return [self clientWithType: Term_TermTypeDate];
 }
 
 - (RethinkDbClient*) timeOfDay {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeTimeOfDay andArg: self]];
+    return [self clientWithType: Term_TermTypeTimeOfDay andArg: self];
 }
 
 - (RethinkDbClient*) year {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeYear andArg: self]];
+    return [self clientWithType: Term_TermTypeYear andArg: self];
 }
 
 - (RethinkDbClient*) month {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeMonth andArg: self]];
+    return [self clientWithType: Term_TermTypeMonth andArg: self];
 }
 
 - (RethinkDbClient*) day {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeDay andArg: self]];
+    return [self clientWithType: Term_TermTypeDay andArg: self];
 }
 
 - (RethinkDbClient*) dayOfWeek {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeDayOfWeek andArg: self]];
+    return [self clientWithType: Term_TermTypeDayOfWeek andArg: self];
 }
 
 - (RethinkDbClient*) dayOfYear {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeDayOfYear andArg: self]];
+    return [self clientWithType: Term_TermTypeDayOfYear andArg: self];
 }
 
 - (RethinkDbClient*) hours {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeHours andArg: self]];
+    return [self clientWithType: Term_TermTypeHours andArg: self];
 }
 
 - (RethinkDbClient*) minutes {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeMinutes andArg: self]];
+    return [self clientWithType: Term_TermTypeMinutes andArg: self];
 }
 
 - (RethinkDbClient*) seconds {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeSeconds andArg: self]];
+    return [self clientWithType: Term_TermTypeSeconds andArg: self];
 }
 
 - (RethinkDbClient*) toISO8601 {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeToIso8601 andArg: self]];
+    return [self clientWithType: Term_TermTypeToIso8601 andArg: self];
 }
 
 - (RethinkDbClient*) toEpochTime {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeToEpochTime andArg: self]];
+    return [self clientWithType: Term_TermTypeToEpochTime andArg: self];
 }
 
 #pragma mark -
@@ -1794,17 +2855,17 @@ static NSDictionary* term_name_to_type = nil;
     [arguments enumerateObjectsUsingBlock:^(id obj, NSUInteger idx, BOOL *stop) {
         NSNumber* arg_num = [NSNumber numberWithInteger: [self nextVariable]];
         [arg_nums addObject: arg_num];
-        [args addObject: [self clientWithTerm: [self termWithType: Term_TermTypeVar andArg: arg_num]]];
+        [args addObject: [self clientWithType: Term_TermTypeVar andArg: arg_num]];
     }];
     
     id <RethinkDBRunnable> body = expression(args);
-    Term* func = [self termWithType: Term_TermTypeFunc andArgs: [NSArray arrayWithObjects: arg_nums, body, nil]];
+    RethinkDbClient* func = [self clientWithType: Term_TermTypeFunc andArgs: [NSArray arrayWithObjects: arg_nums, body, nil]];
     
-    return [self clientWithTerm: [self termWithType: Term_TermTypeFuncall andArgs: [[NSArray arrayWithObject: func] arrayByAddingObjectsFromArray: arguments]]];
+    return [self clientWithType: Term_TermTypeFuncall andArgs: [[NSArray arrayWithObject: func] arrayByAddingObjectsFromArray: arguments]];
 }
 
 - (RethinkDbClient*) branch:(RethinkDbClient*) test then:(RethinkDbClient*) then otherwise:(RethinkDbClient*) otherwise {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeBranch andArgs: [NSArray arrayWithObjects: test, then, otherwise, nil]]];
+    return [self clientWithType: Term_TermTypeBranch andArgs: [NSArray arrayWithObjects: test, then, otherwise, nil]];
 }
 
 - (RethinkDbClient*) forEach:(RethinkDbMappingFunction)function {
@@ -1813,9 +2874,9 @@ static NSDictionary* term_name_to_type = nil;
 
 - (RethinkDbClient*) error:(id)message {
     if(message) {
-        return [self clientWithTerm: [self termWithType: Term_TermTypeError andArg: message]];
+        return [self clientWithType: Term_TermTypeError andArg: message];
     } else {
-        return [self clientWithTerm: [self termWithType: Term_TermTypeError]];
+        return [self clientWithType: Term_TermTypeError];
     }
 }
 
@@ -1824,7 +2885,7 @@ static NSDictionary* term_name_to_type = nil;
 }
 
 - (RethinkDbClient*) defaultAs:(id)value {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeDefault andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(value), nil]]];
+    return [self clientWithType: Term_TermTypeDefault andArgs: [NSArray arrayWithObjects: self, CHECK_NULL(value), nil]];
 }
 
 - (RethinkDbClient*) expr:(id)value {
@@ -1832,23 +2893,23 @@ static NSDictionary* term_name_to_type = nil;
 }
 
 - (RethinkDbClient*) js:(NSString*)script {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeJavascript andArg: script]];
+    return [self clientWithType: Term_TermTypeJavascript andArg: script];
 }
 
 - (RethinkDbClient*) coerceTo:(NSString*)type {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeCoerceTo andArgs: [NSArray arrayWithObjects: self, type, nil]]];
+    return [self clientWithType: Term_TermTypeCoerceTo andArgs: [NSArray arrayWithObjects: self, type, nil]];
 }
 
 - (RethinkDbClient*) typeOf {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeTypeOf andArg: self]];
+    return [self clientWithType: Term_TermTypeTypeOf andArg: self];
 }
 
 - (RethinkDbClient*) info {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeInfo andArg: self]];
+    return [self clientWithType: Term_TermTypeInfo andArg: self];
 
 }
 - (RethinkDbClient*) json:(NSString*)json {
-    return [self clientWithTerm: [self termWithType: Term_TermTypeJson andArg: json]];
+    return [self clientWithType: Term_TermTypeJson andArg: json];
 }
 
 @end
@@ -0,0 +1,14 @@
+//
+//  AllocationCounter.h
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright © 2026 Daniel Parnell. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+// Counts heap allocations made by the process while a block runs.
+// This hooks the malloc logger, so allocations made by other threads at the
+// same time are counted too. Good enough for comparing two code paths.
+NSUInteger RethinkDBCountAllocations(void (^block)(void));
@@ -0,0 +1,35 @@
+//
+//  AllocationCounter.m
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright © 2026 Daniel Parnell. All rights reserved.
+//
+
+#import "AllocationCounter.h"
+#import <stdatomic.h>
+
+// libmalloc calls this (when set) for every allocation and free
+typedef void (malloc_logger_t)(uint32_t type, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3, uintptr_t result, uint32_t num_hot_frames_to_skip);
+extern malloc_logger_t *malloc_logger;
+
+#define MALLOC_LOG_TYPE_ALLOCATE 2
+
+static atomic_ulong allocation_count;
+
+static void counting_logger(uint32_t type, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3, uintptr_t result, uint32_t num_hot_frames_to_skip) {
+    if(type & MALLOC_LOG_TYPE_ALLOCATE) {
+        atomic_fetch_add_explicit(&allocation_count, 1, memory_order_relaxed);
+    }
+}
+
+NSUInteger RethinkDBCountAllocations(void (^block)(void)) {
+    malloc_logger_t *previous = malloc_logger;
+    
+    atomic_store(&allocation_count, 0);
+    malloc_logger = counting_logger;
+    block();
+    malloc_logger = previous;
+    
+    return (NSUInteger)atomic_load(&allocation_count);
+}
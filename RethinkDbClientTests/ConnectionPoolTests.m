@@ -0,0 +1,147 @@
+//
+//  ConnectionPoolTests.m
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright © 2026 Daniel Parnell. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "RethinkDbClient.h"
+#import "RethinkDbClient-Private.h"
+#import "Ql2.pb.h"
+#import "RethinkDBMockServer.h"
+
+@interface ConnectionPoolTests : XCTestCase {
+    RethinkDBMockServer* server;
+    RethinkDBConnectionPool* pool;
+}
+
+@end
+
+@implementation ConnectionPoolTests
+
+- (void)setUp
+{
+    [super setUp];
+    
+    NSError* error = nil;
+    server = [[RethinkDBMockServer alloc] initWithError: &error];
+    XCTAssertNotNil(server, @"mock server failed to start: %@", error);
+    server.handler = ^RethinkDBMockResponse *(id term, NSDictionary *options) {
+        return [RethinkDBMockResponse atom: @YES];
+    };
+    pool = [RethinkDBConnectionPool poolWithURL: server.url minimumSize: 2 maximumSize: 4 error: &error];
+    XCTAssertNotNil(pool, @"opening the pool failed: %@", error);
+}
+
+- (void)tearDown
+{
+    [pool close: nil];
+    pool = nil;
+    [server stop];
+    server = nil;
+    
+    [super tearDown];
+}
+
+- (void)testOpensMinimumSize {
+    XCTAssertEqual(pool.size, 2);
+    XCTAssertEqual(server.connectionCount, 2);
+    XCTAssert([pool isConnected]);
+    
+    NSError* error = nil;
+    XCTAssertNil([RethinkDBConnectionPool poolWithURLs: @[] minimumSize: 1 maximumSize: 1 error: &error]);
+    XCTAssertEqualObjects([error localizedDescription], @"At least one URL is required");
+}
+
+- (void)testRunsQueries {
+    NSError* error = nil;
+    for(int i=0; i<20; i++) {
+        XCTAssertEqualObjects([[[pool table: @"items"] get: @(i)] run: &error], @YES, @"query failed: %@", error);
+    }
+    XCTAssertEqual(server.queryCount, 20);
+    XCTAssertEqual([pool inFlightCount], 0);
+}
+
+- (void)testGrowsUnderLoad {
+    server.latency = 0.2;
+    pool.growthThreshold = 1;
+    
+    dispatch_group_t group = dispatch_group_create();
+    for(int i=0; i<20; i++) {
+        dispatch_group_enter(group);
+        [[[pool table: @"items"] get: @(i)] runThen:^(id response) {
+            dispatch_group_leave(group);
+        } fail:^(NSError *err) {
+            XCTFail(@"query failed: %@", err);
+            dispatch_group_leave(group);
+        }];
+        usleep(10000);
+    }
+    XCTAssertEqual(dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)), 0);
+    XCTAssertGreaterThan(pool.size, 2);
+    XCTAssertLessThanOrEqual(pool.size, 4);
+}
+
+- (void)testAccessorsDoNotGrow {
+    // with a threshold of 0 every query asks for another connection, but questions about the pool must not
+    pool.growthThreshold = 0;
+    for(int i=0; i<10; i++) {
+        XCTAssert([pool isConnected]);
+        XCTAssert([pool encodesJSON]);
+    }
+    usleep(200000);
+    XCTAssertEqual(pool.size, 2);
+    XCTAssertEqual(server.connectionCount, 2);
+}
+
+- (void)testEmptyPoolFails {
+    [pool close: nil];
+    XCTAssertEqual(pool.size, 0);
+    XCTAssertFalse([pool isConnected]);
+    
+    NSError* error = nil;
+    XCTAssertNoThrow([[pool table: @"items"] run: &error]);
+    XCTAssertEqualObjects([error domain], @"RethinkDB Pool Error");
+    XCTAssertEqualObjects([error localizedDescription], @"no connections available");
+    
+    __block NSError* failure = nil;
+    XCTAssertNil([[pool table: @"items"] runThen:^(id response) {
+        XCTFail(@"an empty pool answered a query");
+    } fail:^(NSError *err) {
+        failure = err;
+    }]);
+    XCTAssertNotNil(failure);
+}
+
+- (void)testDeadConnectionsFailTheirQueries {
+    server.latency = 10;
+    pool.healthCheckInterval = 0.1;
+    
+    dispatch_semaphore_t failed = dispatch_semaphore_create(0);
+    [[pool table: @"items"] runThen:^(id response) {
+        XCTFail(@"the query should not have been answered");
+    } fail:^(NSError *err) {
+        dispatch_semaphore_signal(failed);
+    }];
+    usleep(100000);
+    
+    // the connections fail their queries once the server goes away, and the health check drops them
+    [server stop];
+    XCTAssertEqual(dispatch_semaphore_wait(failed, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)), 0);
+    XCTAssertEqual([pool inFlightCount], 0);
+}
+
+- (void)testSettingsReachConnections {
+    NSError* error = nil;
+    pool.collectsMetrics = YES;
+    XCTAssertEqualObjects([[pool table: @"items"] run: &error], @YES, @"query failed: %@", error);
+    XCTAssertEqual([pool metrics].queriesSent, 1);
+    
+    XCTAssertEqual(pool.bulkInsertBatchSize, 1000);
+    XCTAssertEqual(pool.cursorReadAhead, 1);
+    XCTAssertEqual(pool.sharedFeedBufferSize, 256);
+}
+
+@end
@@ -0,0 +1,155 @@
+//
+//  EventLoopTests.m
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright © 2026 Daniel Parnell. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "RethinkDbClient.h"
+#import "RethinkDBEventLoop.h"
+#import "RethinkDBMockServer.h"
+
+@interface EventLoopTests : XCTestCase <NSStreamDelegate> {
+    RethinkDBEventLoop* loop;
+    NSMutableArray* events;
+    dispatch_semaphore_t received;
+}
+
+@end
+
+@implementation EventLoopTests
+
+- (void)setUp
+{
+    [super setUp];
+    
+    loop = [[RethinkDBEventLoop alloc] initWithName: @"EventLoopTests"];
+    events = [NSMutableArray new];
+    received = dispatch_semaphore_create(0);
+}
+
+- (void)tearDown
+{
+    [loop stop];
+    loop = nil;
+    
+    [super tearDown];
+}
+
+- (void)stream:(NSStream *)stream handleEvent:(NSStreamEvent)event {
+    @synchronized(events) {
+        [events addObject: @{@"event": @(event), @"thread": [[NSThread currentThread] name]}];
+    }
+    dispatch_semaphore_signal(received);
+}
+
+- (void)testBlocksRunOnTheLoopThread {
+    XCTAssertFalse([loop isCurrentThread]);
+    
+    __block BOOL on_loop = NO;
+    __block NSString* name = nil;
+    [loop performBlock:^{
+        on_loop = [self->loop isCurrentThread];
+        name = [[NSThread currentThread] name];
+    } waitUntilDone: YES];
+    
+    XCTAssert(on_loop);
+    XCTAssertEqualObjects(name, @"EventLoopTests");
+}
+
+- (void)testBlocksRunInOrder {
+    NSMutableArray* order = [NSMutableArray new];
+    for(int i=0; i<100; i++) {
+        [loop performBlock:^{
+            [order addObject: @(i)];
+        } waitUntilDone: NO];
+    }
+    
+    // the loop thread is the only one touching order until this returns
+    __block NSUInteger count = 0;
+    [loop performBlock:^{
+        count = [order count];
+    } waitUntilDone: YES];
+    
+    XCTAssertEqual(count, 100);
+    for(int i=0; i<100; i++) {
+        XCTAssertEqualObjects(order[i], @(i));
+    }
+}
+
+- (void)testWaitingOnTheLoopThread {
+    // a block that waits on its own loop runs straight away rather than deadlocking
+    __block BOOL inner_ran = NO;
+    [loop performBlock:^{
+        [self->loop performBlock:^{
+            inner_ran = YES;
+        } waitUntilDone: YES];
+    } waitUntilDone: YES];
+    
+    XCTAssert(inner_ran);
+}
+
+- (void)testStreamEventsArriveOnTheLoop {
+    NSInputStream* stream = [NSInputStream inputStreamWithData: [@"some bytes" dataUsingEncoding: NSUTF8StringEncoding]];
+    [stream setDelegate: self];
+    [loop scheduleStream: stream];
+    
+    // nothing pumps a run loop on this thread, the loop's own thread delivers the events
+    [stream open];
+    XCTAssertEqual(dispatch_semaphore_wait(received, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)), 0);
+    @synchronized(events) {
+        XCTAssert([events count] > 0);
+        for(NSDictionary* event in events) {
+            XCTAssertEqualObjects([event objectForKey: @"thread"], @"EventLoopTests");
+        }
+    }
+    
+    [loop removeStream: stream];
+    [stream close];
+}
+
+- (void)testStop {
+    NSThread* thread = [loop valueForKey: @"thread"];
+    XCTAssertFalse([thread isFinished]);
+    
+    [loop stop];
+    for(int i=0; i<20 && ![thread isFinished]; i++) {
+        usleep(50000);
+    }
+    XCTAssert([thread isFinished]);
+}
+
+- (void)testSynchronousQueriesFromAnyThread {
+    NSError* error = nil;
+    RethinkDBMockServer* server = [[RethinkDBMockServer alloc] initWithError: &error];
+    XCTAssertNotNil(server, @"mock server failed to start: %@", error);
+    server.handler = ^RethinkDBMockResponse *(id term, NSDictionary *options) {
+        return [RethinkDBMockResponse atom: @YES];
+    };
+    RethinkDbClient* r = [RethinkDbClient clientWithURL: server.url andError: &error];
+    XCTAssertNotNil(r, @"connecting to the mock server failed: %@", error);
+    
+    // none of these threads run a run loop, so every response has to come in through the I/O thread
+    dispatch_group_t group = dispatch_group_create();
+    __block int answered = 0;
+    for(int i=0; i<8; i++) {
+        dispatch_group_async(group, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            for(int j=0; j<10; j++) {
+                if([[[r table: @"items"] get: @(i * 10 + j)] run: nil]) {
+                    @synchronized(r) {
+                        answered++;
+                    }
+                }
+            }
+        });
+    }
+    XCTAssertEqual(dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)), 0);
+    XCTAssertEqual(answered, 80);
+    
+    [r close: nil];
+    [server stop];
+}
+
+@end
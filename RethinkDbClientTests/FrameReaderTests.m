@@ -0,0 +1,151 @@
+//
+//  FrameReaderTests.m
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright © 2026 Daniel Parnell. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "RethinkDBFrameReader.h"
+
+@interface FrameReaderTests : XCTestCase {
+    RethinkDBFrameReader* reader;
+    NSMutableArray* tokens;
+    NSMutableArray* bodies;
+}
+
+@end
+
+@implementation FrameReaderTests
+
+- (void)setUp
+{
+    [super setUp];
+    
+    reader = [[RethinkDBFrameReader alloc] initWithTokenHeader: YES];
+    tokens = [NSMutableArray new];
+    bodies = [NSMutableArray new];
+}
+
+- (NSData*) frameWithToken:(int64_t)token body:(NSData*)body {
+    NSMutableData* frame = [NSMutableData new];
+    uint64_t little_token = CFSwapInt64HostToLittle((uint64_t)token);
+    uint32_t length = CFSwapInt32HostToLittle((uint32_t)[body length]);
+    [frame appendBytes: &little_token length: sizeof(little_token)];
+    [frame appendBytes: &length length: sizeof(length)];
+    [frame appendData: body];
+    
+    return frame;
+}
+
+- (NSData*) bodyOfLength:(NSUInteger)length {
+    NSMutableData* body = [NSMutableData dataWithLength: length];
+    uint8_t* bytes = [body mutableBytes];
+    for(NSUInteger i=0; i<length; i++) {
+        bytes[i] = (uint8_t)(i * 7 + 3);
+    }
+    
+    return body;
+}
+
+// Each call stands in for one read from the socket, with the reader keeping any partial frame between them.
+- (void) feed:(NSData*)data {
+    NSInputStream* stream = [NSInputStream inputStreamWithData: data];
+    [stream open];
+    
+    NSError* error = nil;
+    XCTAssert([reader readFromStream: stream frames:^(int64_t token, const uint8_t *bytes, NSUInteger length) {
+        [self->tokens addObject: @(token)];
+        [self->bodies addObject: [NSData dataWithBytes: bytes length: length]];
+    } error: &error], @"read failed: %@", error);
+    [stream close];
+}
+
+- (void)testSeveralFramesPerRead {
+    NSMutableData* data = [NSMutableData new];
+    for(int i=1; i<=3; i++) {
+        [data appendData: [self frameWithToken: i body: [self bodyOfLength: i * 10]]];
+    }
+    // an empty body is still a frame
+    [data appendData: [self frameWithToken: 4 body: [NSData data]]];
+    
+    [self feed: data];
+    XCTAssertEqualObjects(tokens, (@[@1, @2, @3, @4]));
+    for(int i=1; i<=3; i++) {
+        XCTAssertEqualObjects(bodies[i - 1], [self bodyOfLength: i * 10]);
+    }
+    XCTAssertEqual([bodies[3] length], 0);
+}
+
+- (void)testSplitHeader {
+    NSData* body = [self bodyOfLength: 20];
+    NSData* frame = [self frameWithToken: 42 body: body];
+    
+    // part way through the token, then part way through the length
+    [self feed: [frame subdataWithRange: NSMakeRange(0, 5)]];
+    XCTAssertEqual([tokens count], 0);
+    [self feed: [frame subdataWithRange: NSMakeRange(5, 5)]];
+    XCTAssertEqual([tokens count], 0);
+    [self feed: [frame subdataWithRange: NSMakeRange(10, [frame length] - 10)]];
+    
+    XCTAssertEqualObjects(tokens, (@[@42]));
+    XCTAssertEqualObjects([bodies firstObject], body);
+}
+
+- (void)testSplitBody {
+    NSData* body = [self bodyOfLength: 100];
+    NSMutableData* data = [[self frameWithToken: 1 body: body] mutableCopy];
+    [data appendData: [self frameWithToken: 2 body: body]];
+    
+    // the first read ends half way through the second frame's body
+    NSUInteger split = [data length] - 50;
+    [self feed: [data subdataWithRange: NSMakeRange(0, split)]];
+    XCTAssertEqualObjects(tokens, (@[@1]));
+    [self feed: [data subdataWithRange: NSMakeRange(split, [data length] - split)]];
+    
+    XCTAssertEqualObjects(tokens, (@[@1, @2]));
+    XCTAssertEqualObjects([bodies lastObject], body);
+}
+
+- (void)testFramesLargerThanTheBuffer {
+    NSUInteger initial_capacity = reader.capacity;
+    NSData* small = [self bodyOfLength: 10];
+    NSData* large = [self bodyOfLength: initial_capacity * 3 + 17];
+    NSMutableData* data = [[self frameWithToken: 1 body: small] mutableCopy];
+    [data appendData: [self frameWithToken: 2 body: large]];
+    [data appendData: [self frameWithToken: 3 body: small]];
+    
+    // read in pieces that don't line up with the frames, so the large one arrives over many reads
+    for(NSUInteger offset=0; offset<[data length]; offset += 10000) {
+        [self feed: [data subdataWithRange: NSMakeRange(offset, MIN(10000, [data length] - offset))]];
+    }
+    
+    XCTAssertEqualObjects(tokens, (@[@1, @2, @3]));
+    XCTAssertEqualObjects(bodies[1], large);
+    XCTAssertEqualObjects(bodies[2], small);
+    XCTAssertGreaterThanOrEqual(reader.capacity, [large length] + 12);
+    
+    // and once grown the buffer is reused for the next large frame
+    NSUInteger capacity = reader.capacity;
+    [self feed: [self frameWithToken: 4 body: large]];
+    XCTAssertEqualObjects([bodies lastObject], large);
+    XCTAssertEqual(reader.capacity, capacity);
+}
+
+- (void)testLengthOnlyHeader {
+    reader = [[RethinkDBFrameReader alloc] initWithTokenHeader: NO];
+    NSData* body = [self bodyOfLength: 30];
+    uint32_t length = CFSwapInt32HostToLittle((uint32_t)[body length]);
+    NSMutableData* data = [NSMutableData dataWithBytes: &length length: sizeof(length)];
+    [data appendData: body];
+    
+    [self feed: [data subdataWithRange: NSMakeRange(0, 2)]];
+    XCTAssertEqual([tokens count], 0);
+    [self feed: [data subdataWithRange: NSMakeRange(2, [data length] - 2)]];
+    
+    XCTAssertEqualObjects(tokens, (@[@0]));
+    XCTAssertEqualObjects([bodies firstObject], body);
+}
+
+@end
@@ -0,0 +1,346 @@
+//
+//  JSONDecoding.m
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright © 2026 Daniel Parnell. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "RethinkDbClient.h"
+#import "RethinkDbClient-Private.h"
+#import "QL2+JSON.h"
+#import "RethinkDBJSONDecoder.h"
+#import "RethinkDBStringTable.h"
+#import "AllocationCounter.h"
+
+#define BENCHMARK_ROWS 1000
+
+@interface RethinkDbClient (Decoding)
+
+- (id) decodeDatum:(Datum*)datum;
+
+@end
+
+@interface JSONDecoding : XCTestCase
+
+@end
+
+@implementation JSONDecoding
+
+- (NSData*) responseWithRows:(NSUInteger)count {
+    NSMutableString *json = [NSMutableString stringWithString: @"{\"t\":3,\"r\":["];
+    
+    for(NSUInteger i = 0; i < count; i++) {
+        if(i > 0) {
+            [json appendString: @","];
+        }
+        [json appendFormat: @"{\"id\":\"%08lx-7d2c-4b1e-9c1f-2a6f0b8e1d3c\",\"name\":\"User %lu\",\"age\":%lu,\"score\":%lu.25,\"active\":true,\"tags\":[\"a\",\"b\"],\"created_at\":\"2016-05-10T12:00:00Z\"}", (unsigned long)i, (unsigned long)i, (unsigned long)(i % 90), (unsigned long)i];
+    }
+    [json appendString: @"],\"n\":[]}"];
+    
+    return [json dataUsingEncoding: NSUTF8StringEncoding];
+}
+
+- (void)testEnvelope {
+    RethinkDBJSONDecoder *decoder = [RethinkDBJSONDecoder new];
+    NSData *data = [@"{\"t\":3,\"r\":[1,\"two\",null,false],\"n\":[1,5]}" dataUsingEncoding: NSUTF8StringEncoding];
+    NSError *error = nil;
+    
+    RethinkDBResponse *response = [decoder decodeResponse: [data bytes] length: [data length] token: 42 error: &error];
+    XCTAssertNotNil(response, @"decode failed: %@", error);
+    XCTAssertEqual(response.token, 42);
+    XCTAssertEqual(response.type, Response_ResponseTypeSuccessPartial);
+    XCTAssertEqualObjects(response.results, (@[@1, @"two", [NSNull null], @NO]));
+    XCTAssert([response hasNote: Response_ResponseNoteSequenceFeed]);
+    XCTAssert([response hasNote: Response_ResponseNoteIncludesStates]);
+}
+
+- (void)testObjectsKeepKeyOrder {
+    RethinkDBJSONDecoder *decoder = [RethinkDBJSONDecoder new];
+    NSData *data = [@"{\"z\":1,\"a\":{\"y\":[]},\"m\":-2.5e3}" dataUsingEncoding: NSUTF8StringEncoding];
+    
+    NSDictionary *value = [decoder decodeValue: [data bytes] length: [data length] error: nil];
+    XCTAssertEqualObjects([value objectForKey: kRethinkDbOrderedKeys], (@[@"z", @"a", @"m"]));
+    XCTAssertEqualObjects([value objectForKey: @"m"], @-2500);
+    XCTAssertEqualObjects([[value objectForKey: @"a"] objectForKey: @"y"], @[]);
+}
+
+- (void)testStringEscapes {
+    RethinkDBJSONDecoder *decoder = [RethinkDBJSONDecoder new];
+    NSData *data = [@"\"tab\\t quote\\\" caf\\u00e9 \\ud83d\\ude00 naïve\"" dataUsingEncoding: NSUTF8StringEncoding];
+    
+    NSString *value = [decoder decodeValue: [data bytes] length: [data length] error: nil];
+    XCTAssertEqualObjects(value, @"tab\t quote\" café \U0001F600 naïve");
+}
+
+- (void)testMalformedInput {
+    RethinkDBJSONDecoder *decoder = [RethinkDBJSONDecoder new];
+    NSData *data = [@"{\"t\":1,\"r\":[{\"a\":}]}" dataUsingEncoding: NSUTF8StringEncoding];
+    NSError *error = nil;
+    
+    XCTAssertNil([decoder decodeResponse: [data bytes] length: [data length] token: 1 error: &error]);
+    XCTAssertNotNil(error);
+}
+
+- (void)testAllocationsPerRow {
+    RethinkDbClient *r = [[RethinkDbClient alloc] initWithConnection: nil];
+    RethinkDBJSONDecoder *decoder = [RethinkDBJSONDecoder new];
+    NSData *data = [self responseWithRows: BENCHMARK_ROWS];
+    
+    // the previous path: NSJSONSerialization, then a Datum per value, then back to Foundation objects
+    NSUInteger before = RethinkDBCountAllocations(^{
+        @autoreleasepool {
+            NSDictionary *json = [NSJSONSerialization JSONObjectWithData: data options: 0 error: nil];
+            NSMutableArray *rows = [NSMutableArray new];
+            for (id obj in [json objectForKey: @"r"]) {
+                [rows addObject: [r decodeDatum: [Datum datumFromNSObject: obj]]];
+            }
+        }
+    });
+    
+    NSUInteger after = RethinkDBCountAllocations(^{
+        @autoreleasepool {
+            [decoder decodeResponse: [data bytes] length: [data length] token: 1 error: nil];
+        }
+    });
+    
+    NSLog(@"allocations per row: before %.1f, after %.1f", (double)before / BENCHMARK_ROWS, (double)after / BENCHMARK_ROWS);
+    XCTAssertLessThan(after, before);
+}
+
+- (void)testDecodePerformance {
+    RethinkDBJSONDecoder *decoder = [RethinkDBJSONDecoder new];
+    NSData *data = [self responseWithRows: BENCHMARK_ROWS];
+    
+    [self measureBlock:^{
+        for(int i = 0; i < 10; i++) {
+            @autoreleasepool {
+                [decoder decodeResponse: [data bytes] length: [data length] token: 1 error: nil];
+            }
+        }
+    }];
+}
+
+- (void)testLazyRowsMatchEagerRows {
+    RethinkDBJSONDecoder *eager = [RethinkDBJSONDecoder new];
+    RethinkDBJSONDecoder *lazy = [RethinkDBJSONDecoder new];
+    lazy.lazyRows = YES;
+    NSData *data = [@"{\"t\":2,\"r\":[{\"a\":1,\"b\\u0021\":{\"c\":[1,{\"d\":null}]},\"e\":\"x\"},[true,\"y\"],7]}" dataUsingEncoding: NSUTF8StringEncoding];
+    
+    RethinkDBResponse *expected = [eager decodeResponse: [data bytes] length: [data length] token: 1 error: nil];
+    RethinkDBResponse *response = [lazy decodeResponse: [data bytes] length: [data length] token: 1 error: nil];
+    XCTAssertNotNil(response);
+    
+    NSDictionary *row = [response.results objectAtIndex: 0];
+    XCTAssert([row isKindOfClass: [RethinkDBLazyDictionary class]]);
+    XCTAssert([[response.results objectAtIndex: 1] isKindOfClass: [RethinkDBLazyArray class]]);
+    XCTAssertEqualObjects([row objectForKey: @"e"], @"x");
+    XCTAssertEqualObjects([[[[row objectForKey: @"b!"] objectForKey: @"c"] objectAtIndex: 1] objectForKey: @"d"], [NSNull null]);
+    XCTAssertNil([row objectForKey: @"missing"]);
+    XCTAssertEqualObjects([row objectForKey: kRethinkDbOrderedKeys], (@[@"a", @"b!", @"e"]));
+    XCTAssertEqualObjects(response.results, expected.results);
+}
+
+- (void)testLazyRowsOutliveTheFrame {
+    RethinkDBJSONDecoder *decoder = [RethinkDBJSONDecoder new];
+    decoder.lazyRows = YES;
+    NSMutableData *data = [[@"{\"t\":2,\"r\":[{\"name\":\"first\"}]}" dataUsingEncoding: NSUTF8StringEncoding] mutableCopy];
+    
+    RethinkDBResponse *response = [decoder decodeResponse: [data bytes] length: [data length] token: 1 error: nil];
+    // the connection reuses its receive buffer for the next frame
+    memset([data mutableBytes], 'x', [data length]);
+    
+    XCTAssertEqualObjects([[response.results firstObject] objectForKey: @"name"], @"first");
+}
+
+- (void)testLazyAllocationsWhenReadingOneField {
+    RethinkDBJSONDecoder *eager = [RethinkDBJSONDecoder new];
+    RethinkDBJSONDecoder *lazy = [RethinkDBJSONDecoder new];
+    lazy.lazyRows = YES;
+    NSData *data = [self responseWithRows: BENCHMARK_ROWS];
+    
+    NSUInteger before = RethinkDBCountAllocations(^{
+        @autoreleasepool {
+            RethinkDBResponse *response = [eager decodeResponse: [data bytes] length: [data length] token: 1 error: nil];
+            for (NSDictionary *row in response.results) {
+                [row objectForKey: @"name"];
+            }
+        }
+    });
+    
+    NSUInteger after = RethinkDBCountAllocations(^{
+        @autoreleasepool {
+            RethinkDBResponse *response = [lazy decodeResponse: [data bytes] length: [data length] token: 1 error: nil];
+            for (NSDictionary *row in response.results) {
+                [row objectForKey: @"name"];
+            }
+        }
+    });
+    
+    NSLog(@"allocations per row reading one field: eager %.1f, lazy %.1f", (double)before / BENCHMARK_ROWS, (double)after / BENCHMARK_ROWS);
+    XCTAssertLessThan(after, before);
+}
+
+- (void)testCompactRowsMatchEagerRows {
+    RethinkDBJSONDecoder *eager = [RethinkDBJSONDecoder new];
+    RethinkDBJSONDecoder *compact = [RethinkDBJSONDecoder new];
+    compact.compactRows = YES;
+    NSData *data = [@"{\"t\":2,\"r\":[{\"a\":1,\"b\\u0021\":{\"c\":[1.5,{\"a\":null}]},\"e\":\"x\\ny\"},[true,\"y\"],7,{}]}" dataUsingEncoding: NSUTF8StringEncoding];
+    
+    RethinkDBResponse *expected = [eager decodeResponse: [data bytes] length: [data length] token: 1 error: nil];
+    RethinkDBResponse *response = [compact decodeResponse: [data bytes] length: [data length] token: 1 error: nil];
+    XCTAssertNotNil(response);
+    XCTAssert([response.results isKindOfClass: [RethinkDBCompactBatch class]]);
+    XCTAssertEqualObjects(response.results, expected.results);
+    XCTAssertEqualObjects([[response.results firstObject] objectForKey: kRethinkDbOrderedKeys], (@[@"a", @"b!", @"e"]));
+    
+    NSData *malformed = [@"{\"t\":2,\"r\":[{\"a\":1,}]}" dataUsingEncoding: NSUTF8StringEncoding];
+    NSError *error = nil;
+    XCTAssertNil([compact decodeResponse: [malformed bytes] length: [malformed length] token: 1 error: &error]);
+    XCTAssertNotNil(error);
+}
+
+- (void)testCompactAccessors {
+    RethinkDBJSONDecoder *decoder = [RethinkDBJSONDecoder new];
+    decoder.compactRows = YES;
+    NSData *data = [self responseWithRows: 100];
+    
+    RethinkDBCompactBatch *batch = (RethinkDBCompactBatch*)[decoder decodeResponse: [data bytes] length: [data length] token: 1 error: nil].results;
+    XCTAssertEqual([batch count], 100);
+    // every row uses the same seven keys
+    XCTAssertEqual(batch.keyCount, 7);
+    XCTAssertEqualObjects([batch keyAtIndex: 1], @"name");
+    XCTAssertEqual([batch indexOfKey: @"missing"], NSNotFound);
+    
+    NSUInteger age = [batch indexOfKey: @"age"];
+    NSUInteger score = [batch indexOfKey: @"score"];
+    NSUInteger name = [batch indexOfKey: @"name"];
+    NSUInteger tags = [batch indexOfKey: @"tags"];
+    for(NSUInteger i = 0; i < [batch count]; i++) {
+        NSUInteger row = [batch valueForRow: i];
+        XCTAssertEqual([batch typeOfValue: row], RethinkDBCompactObject);
+        XCTAssertEqual([batch lengthOfValue: row], 7);
+        XCTAssertEqual([batch integerForValue: [batch memberWithKey: age inObject: row]], i % 90);
+        XCTAssertEqual([batch doubleForValue: [batch memberWithKey: score inObject: row]], i + 0.25);
+        XCTAssertTrue([batch boolForValue: [batch memberAtIndex: 4 ofValue: row]]);
+        
+        NSUInteger length;
+        const char *bytes = [batch bytesOfString: [batch memberWithKey: name inObject: row] length: &length];
+        NSString *expected = [NSString stringWithFormat: @"User %lu", (unsigned long)i];
+        XCTAssertEqual(length, [expected length]);
+        XCTAssert(strncmp(bytes, [expected UTF8String], length) == 0);
+        
+        NSUInteger tag_list = [batch memberWithKey: tags inObject: row];
+        XCTAssertEqualObjects([batch objectForValue: tag_list], (@[@"a", @"b"]));
+        __block NSUInteger members = 0;
+        [batch enumerateMembersOfValue: tag_list usingBlock:^(NSUInteger key, NSUInteger member, BOOL *stop) {
+            XCTAssertEqual(key, NSNotFound);
+            XCTAssertEqual([batch typeOfValue: member], RethinkDBCompactString);
+            members++;
+        }];
+        XCTAssertEqual(members, 2);
+    }
+    
+    XCTAssertThrows([batch valueForRow: 100]);
+}
+
+- (void)testCompactAllocationsWhenReadingOneField {
+    RethinkDBJSONDecoder *eager = [RethinkDBJSONDecoder new];
+    RethinkDBJSONDecoder *compact = [RethinkDBJSONDecoder new];
+    compact.compactRows = YES;
+    NSData *data = [self responseWithRows: BENCHMARK_ROWS];
+    
+    NSUInteger before = RethinkDBCountAllocations(^{
+        @autoreleasepool {
+            RethinkDBResponse *response = [eager decodeResponse: [data bytes] length: [data length] token: 1 error: nil];
+            for (NSDictionary *row in response.results) {
+                [[row objectForKey: @"age"] longLongValue];
+            }
+        }
+    });
+    
+    NSUInteger after = RethinkDBCountAllocations(^{
+        @autoreleasepool {
+            RethinkDBCompactBatch *batch = (RethinkDBCompactBatch*)[compact decodeResponse: [data bytes] length: [data length] token: 1 error: nil].results;
+            NSUInteger age = [batch indexOfKey: @"age"];
+            for(NSUInteger i = 0; i < [batch count]; i++) {
+                [batch integerForValue: [batch memberWithKey: age inObject: [batch valueForRow: i]]];
+            }
+        }
+    });
+    
+    NSLog(@"allocations per row reading one field: eager %.1f, compact %.1f", (double)before / BENCHMARK_ROWS, (double)after / BENCHMARK_ROWS);
+    // the batch, its key names and its buffers growing, not a handful per row
+    XCTAssertLessThan(after, BENCHMARK_ROWS / 10);
+}
+
+- (void)testInternedKeysAreShared {
+    RethinkDBJSONDecoder *decoder = [RethinkDBJSONDecoder new];
+    decoder.keyTable = [[RethinkDBStringTable alloc] initWithCapacity: 64 maximumLength: 64];
+    decoder.valueTable = [[RethinkDBStringTable alloc] initWithCapacity: 64 maximumLength: 16];
+    NSData *data = [self responseWithRows: 10];
+    
+    NSArray *first = [decoder decodeResponse: [data bytes] length: [data length] token: 1 error: nil].results;
+    NSArray *second = [decoder decodeResponse: [data bytes] length: [data length] token: 2 error: nil].results;
+    NSArray *first_keys = [[first objectAtIndex: 0] objectForKey: kRethinkDbOrderedKeys];
+    NSArray *last_keys = [[second lastObject] objectForKey: kRethinkDbOrderedKeys];
+    for(NSUInteger i = 0; i < [first_keys count]; i++) {
+        XCTAssertEqual([first_keys objectAtIndex: i], [last_keys objectAtIndex: i]);
+    }
+    XCTAssertEqual([[first objectAtIndex: 3] objectForKey: @"created_at"], [[second objectAtIndex: 5] objectForKey: @"created_at"]);
+    
+    // seven keys and "a", "b" and the timestamp are new once, everything else is found again
+    XCTAssertEqual(decoder.keyTable.misses, 7);
+    XCTAssertEqual(decoder.keyTable.hits, 20 * 7 - 7);
+    XCTAssertGreaterThan(decoder.valueTable.hits, 0);
+}
+
+- (void)testInternTableIsBounded {
+    RethinkDBStringTable *table = [[RethinkDBStringTable alloc] initWithCapacity: 16 maximumLength: 8];
+    
+    for(int i = 0; i < 10000; i++) {
+        NSString *string = [NSString stringWithFormat: @"%d", i];
+        XCTAssertEqualObjects([table stringWithBytes: (const uint8_t*)[string UTF8String] length: [string length]], string);
+    }
+    XCTAssertEqual(table.capacity, 16);
+    XCTAssertEqual(table.misses, 10000);
+    
+    // a string that keeps coming back stays in the table while others come and go
+    NSString *shared = [table stringWithBytes: (const uint8_t*)"status" length: 6];
+    for(int i = 0; i < 1000; i++) {
+        NSString *other = [NSString stringWithFormat: @"%d", i];
+        [table stringWithBytes: (const uint8_t*)[other UTF8String] length: [other length]];
+        XCTAssertEqual([table stringWithBytes: (const uint8_t*)"status" length: 6], shared);
+    }
+    
+    // longer strings are never cached
+    uint64_t misses = table.misses;
+    XCTAssertEqualObjects([table stringWithBytes: (const uint8_t*)"much too long" length: 13], @"much too long");
+    XCTAssertEqual(table.misses, misses);
+    XCTAssertNil([table stringWithBytes: (const uint8_t*)"\xff" length: 1]);
+}
+
+- (void)testInternAllocations {
+    RethinkDBJSONDecoder *plain = [RethinkDBJSONDecoder new];
+    RethinkDBJSONDecoder *interning = [RethinkDBJSONDecoder new];
+    interning.keyTable = [[RethinkDBStringTable alloc] initWithCapacity: 1024 maximumLength: 64];
+    interning.valueTable = [[RethinkDBStringTable alloc] initWithCapacity: 1024 maximumLength: 16];
+    NSData *data = [self responseWithRows: BENCHMARK_ROWS];
+    
+    NSUInteger before = RethinkDBCountAllocations(^{
+        @autoreleasepool {
+            [plain decodeResponse: [data bytes] length: [data length] token: 1 error: nil];
+        }
+    });
+    NSUInteger after = RethinkDBCountAllocations(^{
+        @autoreleasepool {
+            [interning decodeResponse: [data bytes] length: [data length] token: 1 error: nil];
+        }
+    });
+    
+    NSLog(@"allocations per row: %.1f, %.1f with interning", (double)before / BENCHMARK_ROWS, (double)after / BENCHMARK_ROWS);
+    XCTAssertLessThan(after, before);
+}
+
+@end
@@ -10,6 +10,10 @@
 #import "RethinkDbClient.h"
 #import "RethinkDbClient-Private.h"
 #import "QL2+JSON.h"
+#import "RethinkDBTermArena.h"
+#import "AllocationCounter.h"
+
+#define BENCHMARK_QUERIES 1000
 
 @interface JSONProduction : XCTestCase
 
@@ -49,4 +53,306 @@
     XCTAssert([str isEqualToString: @"[1,[24,[1234.4567,42]],{}]"]);
 }
 
+- (void)testBareQueryJsonGeneration {
+    Query_Builder *query = [Query_Builder new];
+    query.type = Query_QueryTypeNoreplyWait;
+    query.token = 1;
+    NSData *json = [[query build] toJSON];
+    NSString *str = [[NSString alloc] initWithData: json encoding: NSUTF8StringEncoding];
+    
+    XCTAssert([str isEqualToString: @"[4]"]);
+}
+
+- (NSString*) jsonFor:(id)value {
+    RethinkDbClient *r = [[RethinkDbClient alloc] initWithConnection: nil];
+    NSData *json = [[(RethinkDbClient*)[r expr: value] query] toJSON];
+    
+    return [[NSString alloc] initWithData: json encoding: NSUTF8StringEncoding];
+}
+
+- (void)testNumberJsonGeneration {
+    XCTAssertEqualObjects([self jsonFor: @0.1], @"[1,0.1,{}]");
+    XCTAssertEqualObjects([self jsonFor: @-42], @"[1,-42,{}]");
+    XCTAssertEqualObjects([self jsonFor: @1e300], @"[1,1e+300,{}]");
+    XCTAssertEqualObjects([self jsonFor: [NSNumber numberWithDouble: 1.0 / 3.0]], @"[1,0.3333333333333333,{}]");
+    XCTAssertEqualObjects([self jsonFor: @9007199254740993.0], @"[1,9007199254740992,{}]");
+}
+
+- (void)testStringJsonGeneration {
+    XCTAssertEqualObjects([self jsonFor: @"plain"], @"[1,\"plain\",{}]");
+    XCTAssertEqualObjects([self jsonFor: @"quote\" slash\\ tab\t bell\a"], @"[1,\"quote\\\" slash\\\\ tab\\t bell\\u0007\",{}]");
+    // non-ASCII text goes out as UTF-8 rather than \u escapes
+    XCTAssertEqualObjects([self jsonFor: @"naïve \U0001F600"], @"[1,\"naïve \U0001F600\",{}]");
+}
+
+- (void)testTermOptionsJsonGeneration {
+    RethinkDbClient *r = [[RethinkDbClient alloc] initWithConnection: nil];
+    RethinkDbClient *insert = (RethinkDbClient*)[[r table: @"t"] insert: @{@"a": @1} options: @{@"durability": @"soft"}];
+    NSString *str = [[NSString alloc] initWithData: [[insert query] toJSON] encoding: NSUTF8StringEncoding];
+    
+    XCTAssertEqualObjects(str, @"[1,[56,[[15,[\"t\"]],{\"a\":1}],{\"durability\":\"soft\"}],{}]");
+}
+
+- (NSArray*) representativeQueries {
+    RethinkDbClient *r = [[RethinkDbClient alloc] initWithConnection: nil];
+    NSMutableArray *queries = [NSMutableArray new];
+    
+    for(int i = 0; i < BENCHMARK_QUERIES; i++) {
+        NSDictionary *document = @{@"name": [NSString stringWithFormat: @"User %d", i], @"city": @"Zürich", @"age": @(i % 90), @"score": @(i * 1.25), @"tags": @[@"a", @"b"]};
+        RethinkDbClient *insert = (RethinkDbClient*)[[r table: @"users"] insert: document];
+        RethinkDbClient *filter = (RethinkDbClient*)[[[r table: @"users"] filter: [[r row: @"age"] gt: @(i)]] limit: 10];
+        [queries addObject: [insert query]];
+        [queries addObject: [filter query]];
+    }
+    
+    return queries;
+}
+
+- (void)testEncodeAllocationsPerQuery {
+    NSArray *queries = [self representativeQueries];
+    size_t length;
+    
+    // warm up this thread's buffer so it is big enough
+    for(Query *query in queries) {
+        [query encodeJSON: &length];
+    }
+    
+    NSUInteger allocations = RethinkDBCountAllocations(^{
+        size_t ignored;
+        for(Query *query in queries) {
+            [query encodeJSON: &ignored];
+        }
+    });
+    
+    NSLog(@"allocations per query: %.2f", (double)allocations / [queries count]);
+    XCTAssertLessThan(allocations, [queries count]);
+}
+
+- (void)testEncodePerformance {
+    NSArray *queries = [self representativeQueries];
+    __block size_t bytes = 0;
+    __block NSTimeInterval elapsed = 0;
+    
+    [self measureBlock:^{
+        NSDate *start = [NSDate date];
+        size_t length;
+        for(int i = 0; i < 10; i++) {
+            for(Query *query in queries) {
+                [query encodeJSON: &length];
+                bytes += length;
+            }
+        }
+        elapsed += -[start timeIntervalSinceNow];
+    }];
+    
+    NSLog(@"encoded %.1f MB/s", bytes / elapsed / (1024 * 1024));
+}
+
+- (NSDictionary*) wideDocument {
+    NSMutableDictionary *document = [NSMutableDictionary new];
+    
+    for(int i = 0; i < 200; i++) {
+        [document setObject: @{@"label": [NSString stringWithFormat: @"field %d", i], @"value": @(i * 0.5), @"flags": @[@YES, @NO, [NSNull null]]} forKey: [NSString stringWithFormat: @"f%d", i]];
+    }
+    
+    return document;
+}
+
+- (void)testValueDatumMatchesDatumTree {
+    NSDictionary *document = [self wideDocument];
+    NSMutableData *tree = [NSMutableData new];
+    NSMutableData *direct = [NSMutableData new];
+    
+    [[Datum datumFromNSObject: document] toJSON: tree];
+    [[RethinkDBValueDatum datumWithValue: document] toJSON: direct];
+    XCTAssertEqualObjects(direct, tree);
+    
+    // the protobuf protocol still gets a full Datum
+    XCTAssertEqualObjects([[RethinkDBValueDatum datumWithValue: document] data], [[Datum datumFromNSObject: document] data]);
+}
+
+- (void)testEncodedLength {
+    // multi-byte characters and escapes count as the bytes they are written as
+    XCTAssertEqual([RethinkDBValueDatum encodedLengthOfValue: @"caf\u00e9"], strlen("\"caf\xc3\xa9\""));
+    XCTAssertEqual([RethinkDBValueDatum encodedLengthOfValue: @"\x01"], strlen("\"\\u0001\""));
+    
+    NSDictionary *document = [self wideDocument];
+    NSMutableData *json = [NSMutableData new];
+    [[RethinkDBValueDatum datumWithValue: document] toJSON: json];
+    XCTAssertEqual([RethinkDBValueDatum encodedLengthOfValue: document], [json length]);
+}
+
+- (void)testInsertAllocations {
+    RethinkDbClient *r = [[RethinkDbClient alloc] initWithConnection: nil];
+    NSDictionary *document = [self wideDocument];
+    
+    NSUInteger tree = RethinkDBCountAllocations(^{
+        @autoreleasepool {
+            NSMutableData *json = [NSMutableData new];
+            [[Datum datumFromNSObject: document] toJSON: json];
+        }
+    });
+    
+    NSUInteger direct = RethinkDBCountAllocations(^{
+        @autoreleasepool {
+            size_t length;
+            [[(RethinkDbClient*)[[r table: @"t"] insert: document] query] encodeJSON: &length];
+        }
+    });
+    
+    NSLog(@"allocations encoding an insert: datum tree %lu, direct %lu", (unsigned long)tree, (unsigned long)direct);
+    XCTAssertLessThan(direct * 2, tree);
+}
+
+- (void)testQueryTemplate {
+    RethinkDbClient *r = [[RethinkDbClient alloc] initWithConnection: nil];
+    RethinkDbClient *query = (RethinkDbClient*)[[[r table: @"users"] filter: [[[r row: @"age"] gt: [r placeholder: 1]] and: [[r row: @"name"] ne: [r placeholder: 0]]]] limit: 10];
+    RethinkDBQueryTemplate *template = [[RethinkDBQueryTemplate alloc] initWithQuery: [query query]];
+    XCTAssertEqual(template.placeholderCount, 2);
+    
+    size_t length;
+    const uint8_t *bytes = [template encodeWithValues: @[@"name", @42] length: &length];
+    NSString *str = [[NSString alloc] initWithBytes: bytes length: length encoding: NSUTF8StringEncoding];
+    
+    RethinkDbClient *expected = (RethinkDbClient*)[[[r table: @"users"] filter: [[[r row: @"age"] gt: @42] and: [[r row: @"name"] ne: @"name"]]] limit: 10];
+    NSString *expected_str = [[NSString alloc] initWithData: [[expected query] toJSON] encoding: NSUTF8StringEncoding];
+    XCTAssertEqualObjects(str, expected_str);
+    
+    XCTAssertThrows([template encodeWithValues: @[@"name"] length: &length]);
+}
+
+- (RethinkDbClient*) buildQuery:(RethinkDbClient*)r number:(int)i {
+    return (RethinkDbClient*)[[[[r table: @"users"] filter: [[r row: @"age"] gt: @(i)]] pluck: @[@"name", @"age"]] limit: 10];
+}
+
+- (void)testArenaMatchesTerms {
+    RethinkDbClient *r = [[RethinkDbClient alloc] initWithConnection: nil];
+    RethinkDbClient *normal = [self buildQuery: r number: 42];
+    RethinkDbClient *arena = [self buildQuery: [r arena] number: 42];
+    
+    size_t length;
+    const uint8_t *bytes = [arena encodeJSON: &length];
+    NSString *str = [[NSString alloc] initWithBytes: bytes length: length encoding: NSUTF8StringEncoding];
+    NSString *expected_str = [[NSString alloc] initWithData: [[normal query] toJSON] encoding: NSUTF8StringEncoding];
+    XCTAssertEqualObjects(str, expected_str);
+    
+    // terms taken out of the arena are the same as the ones built directly
+    XCTAssertEqualObjects([[arena query] toJSON], [[normal query] toJSON]);
+    
+    // arena queries can be used in normal queries and the other way round
+    RethinkDbClient *mixed = (RethinkDbClient*)[[[r arena] table: @"users"] getAll: @[[normal count], @1]];
+    RethinkDbClient *expected = (RethinkDbClient*)[[r table: @"users"] getAll: @[[normal count], @1]];
+    XCTAssertEqualObjects([[mixed query] toJSON], [[expected query] toJSON]);
+}
+
+- (RethinkDbClient*) buildLambdaQuery:(RethinkDbClient*)r {
+    id <RethinkDBSequence> users = [[[r table: @"users"] filterWith:^id<RethinkDBRunnable>(id<RethinkDBObject> row) {
+        return [[row field: @"age"] gt: @18];
+    }] map:^id<RethinkDBRunnable>(id<RethinkDBObject> row) {
+        return [row field: @"name"];
+    }];
+    
+    return (RethinkDbClient*)[r do:^id<RethinkDBRunnable>(NSArray *args) {
+        return [(id <RethinkDBSequence>)[args firstObject] count];
+    } withArguments: @[users]];
+}
+
+- (void)testArenaLambdas {
+    // separate roots so both queries number their variables the same way
+    RethinkDbClient *normal = [self buildLambdaQuery: [[RethinkDbClient alloc] initWithConnection: nil]];
+    RethinkDbClient *arena = [self buildLambdaQuery: [[[RethinkDbClient alloc] initWithConnection: nil] arena]];
+    
+    size_t length;
+    const uint8_t *bytes = [arena encodeJSON: &length];
+    NSString *str = [[NSString alloc] initWithBytes: bytes length: length encoding: NSUTF8StringEncoding];
+    NSString *expected_str = [[NSString alloc] initWithData: [[normal query] toJSON] encoding: NSUTF8StringEncoding];
+    XCTAssertEqualObjects(str, expected_str);
+    
+    // the functions were built in the arena too, rather than as Terms taken out of it
+    XCTAssertNil([arena valueForKey: @"_term"]);
+}
+
+- (void)testReusedArenaBase {
+    RethinkDbClient *r = [[RethinkDbClient alloc] initWithConnection: nil];
+    RethinkDbClient *base = (RethinkDbClient*)[[r arena] table: @"users"];
+    RethinkDBTermArena *base_arena = [base valueForKey: @"term_arena"];
+    
+    // a base kept for many queries stops growing once its queries start getting arenas of their own
+    size_t ignored;
+    for(int i = 0; i < BENCHMARK_QUERIES; i++) {
+        @autoreleasepool {
+            [(RethinkDbClient*)[base get: @(i)] encodeJSON: &ignored];
+        }
+    }
+    XCTAssertLessThan(base_arena.bytesUsed, 8192);
+    
+    // and queries built from it on several threads at once still come out right
+    dispatch_apply(8, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t thread) {
+        for(int i = 0; i < 500; i++) {
+            @autoreleasepool {
+                id key = @(thread * 1000 + i);
+                size_t length;
+                const uint8_t *bytes = [(RethinkDbClient*)[[base get: key] pluck: @[@"name"]] encodeJSON: &length];
+                NSString *str = [[NSString alloc] initWithBytes: bytes length: length encoding: NSUTF8StringEncoding];
+                NSString *expected_str = [[NSString alloc] initWithData: [[(RethinkDbClient*)[[[r table: @"users"] get: key] pluck: @[@"name"]] query] toJSON] encoding: NSUTF8StringEncoding];
+                XCTAssertEqualObjects(str, expected_str);
+            }
+        }
+    });
+}
+
+- (void)testArenaAllocations {
+    RethinkDbClient *r = [[RethinkDbClient alloc] initWithConnection: nil];
+    RethinkDbClient *arena = [r arena];
+    size_t length;
+    
+    // warm up this thread's buffer so it is big enough
+    [[self buildQuery: r number: 0] encodeJSON: &length];
+    
+    NSUInteger normal_allocations = RethinkDBCountAllocations(^{
+        size_t ignored;
+        for(int i = 0; i < BENCHMARK_QUERIES; i++) {
+            [[self buildQuery: r number: i] encodeJSON: &ignored];
+        }
+    });
+    NSUInteger arena_allocations = RethinkDBCountAllocations(^{
+        size_t ignored;
+        for(int i = 0; i < BENCHMARK_QUERIES; i++) {
+            @autoreleasepool {
+                [[self buildQuery: [arena arena] number: i] encodeJSON: &ignored];
+            }
+        }
+    });
+    
+    NSLog(@"allocations per query: %.2f with terms, %.2f with an arena", (double)normal_allocations / BENCHMARK_QUERIES, (double)arena_allocations / BENCHMARK_QUERIES);
+    XCTAssertLessThan(arena_allocations, normal_allocations);
+}
+
+- (void)testArenaQueriesPerSecond {
+    RethinkDbClient *r = [[RethinkDbClient alloc] initWithConnection: nil];
+    NSTimeInterval normal = 0;
+    NSTimeInterval arena = 0;
+    size_t length;
+    
+    for(int pass = 0; pass < 5; pass++) {
+        NSDate *start = [NSDate date];
+        for(int i = 0; i < BENCHMARK_QUERIES; i++) {
+            @autoreleasepool {
+                [[self buildQuery: r number: i] encodeJSON: &length];
+            }
+        }
+        normal += -[start timeIntervalSinceNow];
+        
+        start = [NSDate date];
+        for(int i = 0; i < BENCHMARK_QUERIES; i++) {
+            @autoreleasepool {
+                [[self buildQuery: [r arena] number: i] encodeJSON: &length];
+            }
+        }
+        arena += -[start timeIntervalSinceNow];
+    }
+    
+    NSLog(@"built and encoded %.0f queries/s with terms, %.0f queries/s with an arena", 5 * BENCHMARK_QUERIES / normal, 5 * BENCHMARK_QUERIES / arena);
+}
+
 @end
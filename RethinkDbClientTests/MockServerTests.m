@@ -0,0 +1,904 @@
+//
+//  MockServerTests.m
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright © 2026 Daniel Parnell. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "RethinkDbClient.h"
+#import "Ql2.pb.h"
+#import "RethinkDBMockServer.h"
+#import "RethinkDbClient-Private.h"
+
+#define BENCHMARK_QUERIES 10000
+
+@interface MockServerTests : XCTestCase {
+    RethinkDBMockServer* server;
+    RethinkDbClient* r;
+}
+
+@end
+
+@implementation MockServerTests
+
+- (void)setUp
+{
+    [super setUp];
+    
+    NSError* error = nil;
+    server = [[RethinkDBMockServer alloc] initWithError: &error];
+    XCTAssertNotNil(server, @"mock server failed to start: %@", error);
+    r = [RethinkDbClient clientWithURL: server.url andError: &error];
+    XCTAssertNotNil(r, @"connecting to the mock server failed: %@", error);
+}
+
+- (void)tearDown
+{
+    [r close: nil];
+    r = nil;
+    [server stop];
+    server = nil;
+    
+    [super tearDown];
+}
+
+- (NSArray*) tableTerm:(NSString*)name {
+    return @[@(Term_TermTypeTable), @[name]];
+}
+
+- (void)testHandshake {
+    XCTAssertEqual(server.connectionCount, 1);
+    
+    NSError* error = nil;
+    server.authKey = @"secret";
+    XCTAssertNil([RethinkDbClient clientWithURL: server.url andError: &error]);
+    XCTAssertEqualObjects([error localizedDescription], @"ERROR: Incorrect authorization key.");
+    
+    NSURL* url = [NSURL URLWithString: [NSString stringWithFormat: @"rethink://secret@127.0.0.1:%u", server.port]];
+    XCTAssertNotNil([RethinkDbClient clientWithURL: url andError: &error], @"connecting with the key failed: %@", error);
+}
+
+- (void)testAtom {
+    NSError* error = nil;
+    [server respondTo: [self tableTerm: @"items"] with: [RethinkDBMockResponse atom: @{@"answer": @42}]];
+    
+    id response = [[r table: @"items"] run: &error];
+    XCTAssertEqualObjects(response, @{@"answer": @42}, @"run failed: %@", error);
+    XCTAssertEqual(server.queryCount, 1);
+}
+
+- (void)testCursor {
+    NSError* error = nil;
+    [server respondTo: [self tableTerm: @"items"] with: [RethinkDBMockResponse cursorWithBatches: @[@[@1, @2, @3], @[@4, @5, @6], @[@7, @8, @9]]]];
+    
+    RethinkDBSequenceCursor* cursor = [[r table: @"items"] run: &error];
+    XCTAssert([cursor isKindOfClass: [RethinkDBSequenceCursor class]], @"expected a cursor: %@", error);
+    
+    NSMutableArray* rows = [NSMutableArray new];
+    id row;
+    while((row = [cursor nextRow: &error])) {
+        [rows addObject: row];
+    }
+    XCTAssertNil(error);
+    XCTAssertEqualObjects(rows, (@[@1, @2, @3, @4, @5, @6, @7, @8, @9]));
+}
+
+- (void)testNextCallsTakeTurns {
+    NSError* error = nil;
+    [server respondTo: [self tableTerm: @"items"] with: [RethinkDBMockResponse cursorWithBatches: @[@[@1, @2, @3], @[@4, @5, @6], @[@7, @8, @9]]]];
+    
+    RethinkDBSequenceCursor* cursor = [[r table: @"items"] run: &error];
+    XCTAssert([cursor isKindOfClass: [RethinkDBSequenceCursor class]], @"expected a cursor: %@", error);
+    
+    // asked for all at once, every row still comes out exactly once and in order
+    NSMutableArray* rows = [NSMutableArray new];
+    dispatch_group_t answered = dispatch_group_create();
+    for(int i=0; i<10; i++) {
+        dispatch_group_enter(answered);
+        [cursor next:^BOOL(id row) {
+            @synchronized(rows) {
+                [rows addObject: row ? row : [NSNull null]];
+            }
+            dispatch_group_leave(answered);
+            return YES;
+        } fail:^(NSError *err) {
+            XCTFail(@"next failed: %@", err);
+            dispatch_group_leave(answered);
+        }];
+    }
+    
+    XCTAssertEqual(dispatch_group_wait(answered, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)), 0);
+    XCTAssertEqualObjects(rows, (@[@1, @2, @3, @4, @5, @6, @7, @8, @9, [NSNull null]]));
+}
+
+- (void)testChangeFeed {
+    NSError* error = nil;
+    server.handler = ^RethinkDBMockResponse *(id term, NSDictionary *options) {
+        if([[term firstObject] intValue] == Term_TermTypeChanges) {
+            return [RethinkDBMockResponse changeFeedWithBatches: @[@[@{@"state": @"ready"}]] notes: @[@(Response_ResponseNoteIncludesStates)]];
+        }
+        return nil;
+    };
+    
+    RethinkDBChangeFeed* feed = [[[r table: @"items"] changes: nil] run: &error];
+    XCTAssert([feed isKindOfClass: [RethinkDBChangeFeed class]], @"expected a change feed: %@", error);
+    
+    NSMutableArray* changes = [NSMutableArray new];
+    dispatch_semaphore_t received = dispatch_semaphore_create(0);
+    [feed each:^BOOL(NSDictionary* change) {
+        [changes addObject: change];
+        dispatch_semaphore_signal(received);
+        return [changes count] < 2;
+    } fail:^(NSError *err) {
+        XCTFail(@"feed failed: %@", err);
+        dispatch_semaphore_signal(received);
+    }];
+    
+    for(int i=0; i<20 && ![feed.state isEqualToString: @"ready"]; i++) {
+        usleep(50000);
+    }
+    XCTAssertEqualObjects(feed.state, @"ready");
+    
+    [server pushChanges: @[@{@"old_val": [NSNull null], @"new_val": @{@"id": @1}}, @{@"old_val": @{@"id": @1}, @"new_val": [NSNull null]}]];
+    dispatch_semaphore_wait(received, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC));
+    dispatch_semaphore_wait(received, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC));
+    
+    XCTAssertEqual([changes count], 2);
+    XCTAssertEqualObjects([[changes firstObject] objectForKey: @"new_val"], @{@"id": @1});
+    XCTAssertEqualObjects([[changes lastObject] objectForKey: @"new_val"], [NSNull null]);
+}
+
+- (void)testChangeFeedStatesArriveInOrder {
+    NSError* error = nil;
+    server.handler = ^RethinkDBMockResponse *(id term, NSDictionary *options) {
+        return [RethinkDBMockResponse changeFeedWithBatches: @[@[@{@"state": @"initializing"}, @{@"new_val": @{@"id": @1}}, @{@"new_val": @{@"id": @2}}],
+                                                               @[@{@"new_val": @{@"id": @3}}, @{@"state": @"ready"}]] notes: @[@(Response_ResponseNoteIncludesStates)]];
+    };
+    
+    RethinkDBChangeFeed* feed = [[[r table: @"items"] changes: @{@"include_initial": @YES, @"include_states": @YES}] run: &error];
+    XCTAssert([feed isKindOfClass: [RethinkDBChangeFeed class]], @"expected a change feed: %@", error);
+    
+    // the states and the changes are delivered one at a time, so the log needs no lock
+    NSMutableArray* events = [NSMutableArray new];
+    dispatch_semaphore_t ready = dispatch_semaphore_create(0);
+    feed.stateChanged = ^(NSString *state) {
+        [events addObject: state];
+        if([state isEqualToString: @"ready"]) {
+            dispatch_semaphore_signal(ready);
+        }
+    };
+    [feed each:^BOOL(NSDictionary* change) {
+        [events addObject: [[change objectForKey: @"new_val"] objectForKey: @"id"]];
+        return YES;
+    } fail:^(NSError *err) {
+        XCTFail(@"feed failed: %@", err);
+    }];
+    
+    XCTAssertEqual(dispatch_semaphore_wait(ready, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)), 0);
+    XCTAssertEqualObjects(events, (@[@"initializing", @1, @2, @3, @"ready"]));
+    XCTAssertEqual(feed.pendingCount, 0);
+    [feed close];
+}
+
+- (void)testClosingChangeFeed {
+    NSError* error = nil;
+    server.handler = ^RethinkDBMockResponse *(id term, NSDictionary *options) {
+        return [RethinkDBMockResponse changeFeedWithBatches: @[@[@{@"state": @"ready"}]] notes: @[@(Response_ResponseNoteIncludesStates)]];
+    };
+    
+    RethinkDBChangeFeed* feed = [[[r table: @"items"] changes: nil] run: &error];
+    XCTAssert([feed isKindOfClass: [RethinkDBChangeFeed class]], @"expected a change feed: %@", error);
+    [feed each:^BOOL(id change) {
+        return YES;
+    } fail:^(NSError *err) {
+    }];
+    for(int i=0; i<20 && ![feed.state isEqualToString: @"ready"]; i++) {
+        usleep(50000);
+    }
+    // a feed always has a CONTINUE waiting for the next changes
+    XCTAssertEqual([r inFlightCount], 1);
+    
+    // the STOP shares that CONTINUE's operation, so nothing is left waiting for an answer that never comes
+    [feed close];
+    NSOperationQueue* queue = [r valueForKey: @"queue"];
+    for(int i=0; i<20 && ([r inFlightCount] || [queue operationCount]); i++) {
+        usleep(50000);
+    }
+    XCTAssertEqual([r inFlightCount], 0);
+    XCTAssertEqual([queue operationCount], 0);
+}
+
+- (void)testSharedFeedsLeaveOutIncludeInitial {
+    server.handler = ^RethinkDBMockResponse *(id term, NSDictionary *options) {
+        return [RethinkDBMockResponse changeFeedWithBatches: @[@[@{@"new_val": @{@"id": @1}}]] notes: nil];
+    };
+    
+    NSMutableArray* subscriptions = [NSMutableArray new];
+    dispatch_semaphore_t received = dispatch_semaphore_create(0);
+    RethinkDbCursorValueBlock each = ^BOOL(id change) {
+        dispatch_semaphore_signal(received);
+        return YES;
+    };
+    RethinkDbErrorBlock fail = ^(NSError *err) {
+        XCTFail(@"feed failed: %@", err);
+    };
+    
+    // every subscriber to an include_initial feed has its own, so each of them sees the initial values
+    for(int i=0; i<2; i++) {
+        [subscriptions addObject: [[[r table: @"items"] changes: @{@"include_initial": @YES}] subscribe: each fail: fail]];
+    }
+    for(int i=0; i<2; i++) {
+        XCTAssertEqual(dispatch_semaphore_wait(received, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)), 0);
+    }
+    XCTAssertEqual(server.queryCount, 2);
+    
+    for(int i=0; i<2; i++) {
+        [subscriptions addObject: [[[r table: @"items"] changes: nil] subscribe: each fail: fail]];
+    }
+    XCTAssertEqual(dispatch_semaphore_wait(received, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)), 0);
+    XCTAssertEqual(server.queryCount, 3);
+    
+    for(RethinkDBFeedSubscription* subscription in subscriptions) {
+        [subscription cancel];
+    }
+    for(int i=0; i<20 && [r inFlightCount]; i++) {
+        usleep(50000);
+    }
+    XCTAssertEqual([r inFlightCount], 0);
+}
+
+- (void)testWriteCoalescing {
+    server.handler = ^RethinkDBMockResponse *(id term, NSDictionary *options) {
+        return [RethinkDBMockResponse atom: @YES];
+    };
+    
+    // queries wait for the linger time to go out together
+    r.maxWriteBatchSize = 100;
+    r.writeLingerTime = 0.3;
+    dispatch_group_t group = dispatch_group_create();
+    NSDate* start = [NSDate date];
+    for(int i=0; i<3; i++) {
+        dispatch_group_enter(group);
+        [[[r table: @"items"] get: @(i)] runThen:^(id response) {
+            dispatch_group_leave(group);
+        } fail:^(NSError *err) {
+            XCTFail(@"query failed: %@", err);
+            dispatch_group_leave(group);
+        }];
+    }
+    usleep(100000);
+    XCTAssertEqual(server.queryCount, 0);
+    XCTAssertEqual(dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)), 0);
+    XCTAssertGreaterThanOrEqual(-[start timeIntervalSinceNow], 0.3);
+    XCTAssertEqual(server.queryCount, 3);
+    
+    // unless the batch fills up first
+    r.maxWriteBatchSize = 3;
+    r.writeLingerTime = 10;
+    start = [NSDate date];
+    for(int i=0; i<3; i++) {
+        dispatch_group_enter(group);
+        [[[r table: @"items"] get: @(i)] runThen:^(id response) {
+            dispatch_group_leave(group);
+        } fail:^(NSError *err) {
+            XCTFail(@"query failed: %@", err);
+            dispatch_group_leave(group);
+        }];
+    }
+    XCTAssertEqual(dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)), 0);
+    XCTAssertLessThan(-[start timeIntervalSinceNow], 5);
+    XCTAssertEqual(server.queryCount, 6);
+    
+    // and the buffers swapped between batches keep working
+    r.writeLingerTime = 0;
+    for(int i=0; i<50; i++) {
+        XCTAssertEqualObjects([[[r table: @"items"] get: @(i)] run: nil], @YES);
+    }
+    XCTAssertEqual(server.queryCount, 56);
+}
+
+- (void)testWriteFailureFailsQueries {
+    NSError* error = nil;
+    server.handler = ^RethinkDBMockResponse *(id term, NSDictionary *options) {
+        return [RethinkDBMockResponse atom: @YES];
+    };
+    XCTAssertEqualObjects([[r table: @"items"] run: &error], @YES);
+    
+    // a synchronous query on a connection that can't be written to fails rather than waiting forever
+    [(NSOutputStream*)[r valueForKey: @"output_stream"] close];
+    XCTAssertNil([[r table: @"items"] run: &error]);
+    XCTAssertEqual([error code], Response_ResponseTypeClientError);
+    XCTAssertEqual([r inFlightCount], 0);
+}
+
+- (void)testCloseFailsQueriesInFlight {
+    server.latency = 10;
+    server.handler = ^RethinkDBMockResponse *(id term, NSDictionary *options) {
+        return [RethinkDBMockResponse atom: @YES];
+    };
+    
+    dispatch_semaphore_t failed = dispatch_semaphore_create(0);
+    [[r table: @"items"] runThen:^(id response) {
+        XCTFail(@"the query should not have been answered");
+    } fail:^(NSError *err) {
+        XCTAssertEqualObjects([err localizedDescription], @"The connection was closed");
+        dispatch_semaphore_signal(failed);
+    }];
+    usleep(100000);
+    
+    [r close: nil];
+    XCTAssertEqual(dispatch_semaphore_wait(failed, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)), 0);
+    XCTAssertEqual([r inFlightCount], 0);
+}
+
+- (void)testServerGoingAwayFailsQueries {
+    server.latency = 10;
+    server.handler = ^RethinkDBMockResponse *(id term, NSDictionary *options) {
+        return [RethinkDBMockResponse atom: @YES];
+    };
+    
+    __block id result = nil;
+    __block NSError* failure = nil;
+    dispatch_semaphore_t returned = dispatch_semaphore_create(0);
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        NSError* error = nil;
+        result = [[self->r table: @"items"] run: &error];
+        failure = error;
+        dispatch_semaphore_signal(returned);
+    });
+    usleep(100000);
+    
+    // the synchronous run: returns with an error instead of waiting forever
+    [server stop];
+    XCTAssertEqual(dispatch_semaphore_wait(returned, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)), 0);
+    XCTAssertNil(result);
+    XCTAssertEqual([failure code], Response_ResponseTypeClientError);
+    XCTAssertEqualObjects([failure localizedDescription], @"The server closed the connection");
+    XCTAssertEqual([r inFlightCount], 0);
+    XCTAssertFalse([r isConnected]);
+}
+
+- (void)testCloseBeforeAFlush {
+    server.handler = ^RethinkDBMockResponse *(id term, NSDictionary *options) {
+        return [RethinkDBMockResponse atom: @YES];
+    };
+    
+    // the batch is still waiting for its flush when the connection goes away
+    r.maxWriteBatchSize = 1000;
+    r.writeLingerTime = 0.2;
+    dispatch_group_t group = dispatch_group_create();
+    __block int failures = 0;
+    for(int i=0; i<50; i++) {
+        dispatch_group_enter(group);
+        [[[r table: @"items"] get: @(i)] runThen:^(id response) {
+            XCTFail(@"the query should not have been answered");
+            dispatch_group_leave(group);
+        } fail:^(NSError *err) {
+            @synchronized(self) {
+                failures++;
+            }
+            dispatch_group_leave(group);
+        }];
+    }
+    
+    [r close: nil];
+    XCTAssertEqual(dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)), 0);
+    XCTAssertEqual(failures, 50);
+    
+    // the flush then finds no stream to write to rather than a released one
+    usleep(400000);
+    XCTAssertEqual(server.queryCount, 0);
+    XCTAssertEqual([r inFlightCount], 0);
+}
+
+- (void)testBulkInsertBatchBytes {
+    NSError* error = nil;
+    NSMutableArray* batch_sizes = [NSMutableArray new];
+    server.handler = ^RethinkDBMockResponse *(id term, NSDictionary *options) {
+        // [INSERT, [[TABLE, ["items"]], [MAKE_ARRAY, [documents]]]]
+        NSArray* documents = [[[term objectAtIndex: 1] objectAtIndex: 1] objectAtIndex: 1];
+        @synchronized(batch_sizes) {
+            [batch_sizes addObject: @([documents count])];
+        }
+        return [RethinkDBMockResponse atom: @{@"inserted": @([documents count])}];
+    };
+    
+    // two of these documents fit in the byte limit but three would not
+    NSMutableArray* documents = [NSMutableArray new];
+    for(int i=0; i<20; i++) {
+        [documents addObject: @{@"id": @(i), @"name": @"a name that takes up some room"}];
+    }
+    r.bulkInsertBatchSize = 1000;
+    r.bulkInsertBatchBytes = 130;
+    
+    NSDictionary* result = [[r table: @"items"] insertAll: [documents objectEnumerator] options: nil error: &error];
+    XCTAssertEqualObjects([result objectForKey: @"inserted"], @20, @"insert failed: %@", error);
+    XCTAssertEqual([batch_sizes count], 10);
+    for(NSNumber* size in batch_sizes) {
+        XCTAssertEqual([size intValue], 2);
+    }
+    
+    // a document bigger than the limit still goes out, by itself
+    [batch_sizes removeAllObjects];
+    r.bulkInsertBatchBytes = 10;
+    result = [[r table: @"items"] insertAll: [[documents subarrayWithRange: NSMakeRange(0, 3)] objectEnumerator] options: nil error: &error];
+    XCTAssertEqualObjects([result objectForKey: @"inserted"], @3, @"insert failed: %@", error);
+    XCTAssertEqualObjects(batch_sizes, (@[@1, @1, @1]));
+}
+
+- (void)testErrors {
+    NSError* error = nil;
+    [server respondTo: [self tableTerm: @"missing"] with: [RethinkDBMockResponse runtimeError: @"Table `test.missing` does not exist."]];
+    
+    XCTAssertNil([[r table: @"missing"] run: &error]);
+    XCTAssertEqual([error code], Response_ResponseTypeRuntimeError);
+    XCTAssertEqualObjects([error localizedDescription], @"Table `test.missing` does not exist.");
+    
+    // anything that was not scripted fails too
+    error = nil;
+    XCTAssertNil([[r table: @"other"] run: &error]);
+    XCTAssertNotNil(error);
+}
+
+- (void)testLatency {
+    NSError* error = nil;
+    server.latency = 0.1;
+    server.handler = ^RethinkDBMockResponse *(id term, NSDictionary *options) {
+        return [RethinkDBMockResponse atom: @YES];
+    };
+    
+    NSDate* start = [NSDate date];
+    XCTAssertNotNil([[r table: @"items"] run: &error]);
+    XCTAssertGreaterThanOrEqual(-[start timeIntervalSinceNow], 0.1);
+    
+    // queries in flight together wait out their latency together
+    dispatch_group_t group = dispatch_group_create();
+    start = [NSDate date];
+    for(int i=0; i<20; i++) {
+        dispatch_group_enter(group);
+        [[r table: @"items"] runThen:^(id response) {
+            dispatch_group_leave(group);
+        } fail:^(NSError *err) {
+            XCTFail(@"query failed: %@", err);
+            dispatch_group_leave(group);
+        }];
+    }
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    XCTAssertLessThan(-[start timeIntervalSinceNow], 1.0);
+}
+
+- (void)testBandwidth {
+    NSError* error = nil;
+    NSString* large = [@"" stringByPaddingToLength: 50000 withString: @"x" startingAtIndex: 0];
+    server.bandwidth = 100000;
+    [server respondTo: [self tableTerm: @"items"] with: [RethinkDBMockResponse atom: large]];
+    
+    NSDate* start = [NSDate date];
+    XCTAssertEqualObjects([[r table: @"items"] run: &error], large);
+    XCTAssertGreaterThanOrEqual(-[start timeIntervalSinceNow], 0.5);
+}
+
+- (void)testQueriesPerSecond {
+    server.handler = ^RethinkDBMockResponse *(id term, NSDictionary *options) {
+        return [RethinkDBMockResponse atom: @YES];
+    };
+    
+    dispatch_group_t group = dispatch_group_create();
+    NSDate* start = [NSDate date];
+    for(int i=0; i<BENCHMARK_QUERIES; i++) {
+        @autoreleasepool {
+            dispatch_group_enter(group);
+            [[[r arena] table: @"items"] runThen:^(id response) {
+                dispatch_group_leave(group);
+            } fail:^(NSError *err) {
+                dispatch_group_leave(group);
+            }];
+        }
+    }
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    NSTimeInterval elapsed = -[start timeIntervalSinceNow];
+    
+    XCTAssertEqual(server.queryCount, BENCHMARK_QUERIES);
+    NSLog(@"ran %.0f queries/s against the mock server", BENCHMARK_QUERIES / elapsed);
+}
+
+- (void)testMetrics {
+    XCTAssertNil([r metrics], @"metrics should be off by default");
+    
+    server.latency = 0.01;
+    server.handler = ^RethinkDBMockResponse *(id term, NSDictionary *options) {
+        return [RethinkDBMockResponse atom: @YES];
+    };
+    r.collectsMetrics = YES;
+    
+    NSError* error = nil;
+    for(int i=0; i<50; i++) {
+        XCTAssertNotNil([[r table: @"items"] run: &error], @"query failed: %@", error);
+    }
+    
+    RethinkDBMetrics* metrics = [r metrics];
+    XCTAssertEqual(metrics.queriesSent, 50);
+    XCTAssertEqual(metrics.responsesReceived, 50);
+    XCTAssertGreaterThan(metrics.bytesSent, 0);
+    XCTAssertGreaterThan(metrics.bytesReceived, 0);
+    XCTAssertEqual(metrics.inFlightCount, 0);
+    
+    RethinkDBLatencyHistogram* round_trip = [metrics histogramForPhase: RethinkDBLatencyRoundTrip];
+    XCTAssertEqual(round_trip.count, 50);
+    XCTAssertGreaterThanOrEqual([round_trip valueAtPercentile: 50], 10000000);
+    XCTAssertLessThanOrEqual(round_trip.minimum, [round_trip valueAtPercentile: 50]);
+    XCTAssertLessThanOrEqual([round_trip valueAtPercentile: 99], round_trip.maximum);
+    XCTAssertEqual([metrics histogramForPhase: RethinkDBLatencyDecode].count, 50);
+    XCTAssertEqual([metrics histogramForPhase: RethinkDBLatencyCallback].count, 50);
+    
+    [r resetMetrics];
+    XCTAssertEqual([r metrics].queriesSent, 0);
+    
+    dispatch_semaphore_t reported = dispatch_semaphore_create(0);
+    [r reportMetricsEvery: 0.1 to:^(RethinkDBMetrics *snapshot) {
+        dispatch_semaphore_signal(reported);
+    }];
+    XCTAssertEqual(dispatch_semaphore_wait(reported, dispatch_time(DISPATCH_TIME_NOW, 2 * NSEC_PER_SEC)), 0);
+    [r reportMetricsEvery: 0 to: nil];
+}
+
+- (void)testBufferedBatchBytes {
+    NSError* error = nil;
+    server.handler = ^RethinkDBMockResponse *(id term, NSDictionary *options) {
+        return [RethinkDBMockResponse cursorWithBatches: @[@[@"a", @"b"], @[@"c", @"d"], @[@"e"]]];
+    };
+    r.collectsMetrics = YES;
+    r.cursorReadAhead = 2;
+    
+    RethinkDBSequenceCursor* cursor = [[r table: @"items"] run: &error];
+    XCTAssertNotNil([cursor nextRow: &error]);
+    for(int i=0; i<20 && [r metrics].bufferedBatchBytes == 0; i++) {
+        usleep(50000);
+    }
+    
+    RethinkDBMetrics* metrics = [r metrics];
+    XCTAssertEqual(metrics.openCursorCount, 1);
+    XCTAssertGreaterThan(metrics.bufferedBatchBytes, 0);
+    
+    [cursor close];
+    XCTAssertEqual([r metrics].bufferedBatchBytes, 0);
+}
+
+- (void)testCaptureAndReplay {
+    NSError* error = nil;
+    NSString* path = [NSTemporaryDirectory() stringByAppendingPathComponent: @"capture-test.rdbwire"];
+    server.handler = ^RethinkDBMockResponse *(id term, NSDictionary *options) {
+        return [RethinkDBMockResponse atom: @YES];
+    };
+    
+    XCTAssert([r startCaptureToFile: path bufferSize: 64 * 1024 error: &error], @"capture failed to start: %@", error);
+    for(int i=0; i<10; i++) {
+        XCTAssertNotNil([[r table: @"items"] run: &error]);
+        usleep(20000);
+    }
+    [r stopCapture];
+    
+    RethinkDBCaptureReplay* replay = [[RethinkDBCaptureReplay alloc] initWithContentsOfFile: path error: &error];
+    XCTAssertNotNil(replay, @"could not read the capture: %@", error);
+    XCTAssertEqual(replay.queryCount, 10);
+    XCTAssertGreaterThanOrEqual(replay.duration, 0.15);
+    
+    // replayed twice as fast the gaps between the queries are kept, as fast as possible they are not
+    NSDate* start = [NSDate date];
+    XCTAssert([replay replayTo: r speed: 2 error: &error], @"replay failed: %@", error);
+    XCTAssertGreaterThanOrEqual(-[start timeIntervalSinceNow], replay.duration / 2);
+    XCTAssertEqual(server.queryCount, 20);
+    
+    start = [NSDate date];
+    XCTAssert([replay replayTo: r speed: 0 error: &error], @"replay failed: %@", error);
+    XCTAssertLessThan(-[start timeIntervalSinceNow], replay.duration / 2);
+    XCTAssertEqual(server.queryCount, 30);
+    
+    [[NSFileManager defaultManager] removeItemAtPath: path error: nil];
+}
+
+- (void)testReplayWithNoReplyQueries {
+    NSError* error = nil;
+    NSString* path = [NSTemporaryDirectory() stringByAppendingPathComponent: @"capture-noreply.rdbwire"];
+    server.handler = ^RethinkDBMockResponse *(id term, NSDictionary *options) {
+        return [RethinkDBMockResponse atom: @YES];
+    };
+    
+    XCTAssert([r startCaptureToFile: path bufferSize: 64 * 1024 error: &error], @"capture failed to start: %@", error);
+    for(int i=0; i<3; i++) {
+        XCTAssertNotNil([[r table: @"items"] run: &error]);
+        XCTAssert([[r table: @"items"] runNoReply: &error]);
+    }
+    XCTAssert([r noreplyWait: &error]);
+    [r stopCapture];
+    
+    RethinkDBCaptureReplay* replay = [[RethinkDBCaptureReplay alloc] initWithContentsOfFile: path error: &error];
+    XCTAssertNotNil(replay, @"could not read the capture: %@", error);
+    XCTAssertEqual(replay.queryCount, 6);
+    
+    // the server never answers the noreply queries, so waiting on them would hang the replay
+    uint64_t before = server.queryCount;
+    __block BOOL replayed = NO;
+    dispatch_semaphore_t done = dispatch_semaphore_create(0);
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        replayed = [replay replayTo: self->r speed: 0 error: nil];
+        dispatch_semaphore_signal(done);
+    });
+    XCTAssertEqual(dispatch_semaphore_wait(done, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)), 0, @"the replay never finished");
+    XCTAssert(replayed);
+    XCTAssertEqual(replay.failedCount, 0);
+    XCTAssertEqual(server.queryCount, before + 6);
+    
+    [[NSFileManager defaultManager] removeItemAtPath: path error: nil];
+}
+
+- (void)testCaptureDropsWhenFull {
+    NSError* error = nil;
+    NSString* path = [NSTemporaryDirectory() stringByAppendingPathComponent: @"capture-full.rdbwire"];
+    NSString* large = [@"" stringByPaddingToLength: 8000 withString: @"x" startingAtIndex: 0];
+    server.handler = ^RethinkDBMockResponse *(id term, NSDictionary *options) {
+        return [RethinkDBMockResponse atom: @YES];
+    };
+    
+    // a frame bigger than the ring can never be captured, but the query still goes through
+    XCTAssert([r startCaptureToFile: path bufferSize: 0 error: &error]);
+    XCTAssertNotNil([[[r table: @"items"] get: large] run: &error]);
+    XCTAssertGreaterThan(r.droppedCaptureFrameCount, 0);
+    XCTAssertGreaterThan(r.capturedFrameCount, 0);
+    [r stopCapture];
+    
+    [[NSFileManager defaultManager] removeItemAtPath: path error: nil];
+}
+
+- (void)testDocumentCache {
+    NSError* error = nil;
+    server.handler = ^RethinkDBMockResponse *(id term, NSDictionary *options) {
+        id key = [[term objectAtIndex: 1] objectAtIndex: 1];
+        if([key isEqual: @"missing"]) {
+            return [RethinkDBMockResponse atom: [NSNull null]];
+        }
+        return [RethinkDBMockResponse atom: @{@"id": key, @"name": [NSString stringWithFormat: @"user %@", key]}];
+    };
+    
+    RethinkDBDocumentCache* cache = [r cacheTable: @"users" maximumBytes: 0 timeToLive: 0.5];
+    XCTAssertEqual([r cacheTable: @"users" maximumBytes: 0 timeToLive: 0], cache);
+    
+    XCTAssertEqualObjects([[[r table: @"users"] get: @"a"] run: &error], (@{@"id": @"a", @"name": @"user a"}), @"get failed: %@", error);
+    XCTAssertEqualObjects([[[r table: @"users"] get: @"a"] run: &error], (@{@"id": @"a", @"name": @"user a"}));
+    XCTAssertEqualObjects([[[r table: @"users"] get: @"missing"] run: &error], [NSNull null]);
+    XCTAssertEqualObjects([[[r table: @"users"] get: @"missing"] run: &error], [NSNull null]);
+    XCTAssertEqual(server.queryCount, 2);
+    XCTAssertEqual(cache.hits, 2);
+    XCTAssertEqual(cache.misses, 2);
+    XCTAssertEqualWithAccuracy(cache.hitRatio, 0.5, 0.001);
+    XCTAssertEqual(cache.count, 2);
+    XCTAssertGreaterThan(cache.bytesUsed, 0);
+    
+    // other tables, and anything built on the get:, still go to the server
+    [[[r table: @"accounts"] get: @"a"] run: &error];
+    [[[[r table: @"users"] get: @"a"] pluck: @[@"name"]] run: &error];
+    XCTAssertEqual(server.queryCount, 4);
+    
+    // a change to a document drops it
+    [cache applyChange: @{@"old_val": @{@"id": @"a"}, @"new_val": @{@"id": @"a", @"name": @"renamed"}}];
+    XCTAssertEqual(cache.count, 1);
+    [[[r table: @"users"] get: @"a"] run: &error];
+    XCTAssertEqual(server.queryCount, 5);
+    
+    // and so does age
+    usleep(600000);
+    [[[r table: @"users"] get: @"a"] run: &error];
+    XCTAssertEqual(server.queryCount, 6);
+    
+    // misses for the same key while it is being loaded share the query
+    server.latency = 0.1;
+    [cache invalidateAll];
+    XCTAssertEqual(cache.bytesUsed, 0);
+    dispatch_group_t group = dispatch_group_create();
+    for(int i=0; i<10; i++) {
+        dispatch_group_enter(group);
+        [[[r table: @"users"] get: @"b"] runThen:^(id response) {
+            XCTAssertEqualObjects([response objectForKey: @"id"], @"b");
+            dispatch_group_leave(group);
+        } fail:^(NSError *err) {
+            XCTFail(@"get failed: %@", err);
+            dispatch_group_leave(group);
+        }];
+    }
+    XCTAssertEqual(dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)), 0);
+    XCTAssertEqual(server.queryCount, 7);
+    
+    [r stopCachingTable: @"users"];
+    [[[r table: @"users"] get: @"b"] run: &error];
+    XCTAssertEqual(server.queryCount, 8);
+}
+
+- (void)testDocumentCacheKeepsToTheDefaultDatabase {
+    NSError* error = nil;
+    server.handler = ^RethinkDBMockResponse *(id term, NSDictionary *options) {
+        NSString* db = [options objectForKey: @"db"] ? @"other" : @"default";
+        return [RethinkDBMockResponse atom: @{@"id": @"a", @"db": db}];
+    };
+    
+    RethinkDBDocumentCache* cache = [r cacheTable: @"users" maximumBytes: 0 timeToLive: 0];
+    XCTAssertEqualObjects([[[[r table: @"users"] get: @"a"] run: &error] objectForKey: @"db"], @"default", @"get failed: %@", error);
+    
+    // the same table name in another database, or read with other options, is a different table
+    XCTAssertEqualObjects([[[[[r db: @"other"] table: @"users"] get: @"a"] run: &error] objectForKey: @"db"], @"other");
+    XCTAssertEqualObjects([[[[[r db: @"other"] table: @"users"] get: @"a"] run: &error] objectForKey: @"db"], @"other");
+    [[[r table: @"users" options: @{@"read_mode": @"outdated"}] get: @"a"] run: &error];
+    XCTAssertEqual(server.queryCount, 4);
+    XCTAssertEqual(cache.count, 1);
+    
+    // keys the server works out are never cached
+    XCTAssertNotNil([[[r table: @"users"] get: [r expr: @"a"]] run: &error]);
+    XCTAssertNotNil([[[r table: @"users"] get: [r placeholder: 0]] prepare]);
+    XCTAssertEqual(server.queryCount, 5);
+    XCTAssertEqual(cache.misses, 1);
+}
+
+- (void)testDocumentCacheEviction {
+    NSError* error = nil;
+    NSString* padding = [@"" stringByPaddingToLength: 1000 withString: @"x" startingAtIndex: 0];
+    server.handler = ^RethinkDBMockResponse *(id term, NSDictionary *options) {
+        return [RethinkDBMockResponse atom: @{@"id": [[term objectAtIndex: 1] objectAtIndex: 1], @"padding": padding}];
+    };
+    
+    // room for a few documents of about 2k each
+    RethinkDBDocumentCache* cache = [r cacheTable: @"users" maximumBytes: 8000 timeToLive: 0];
+    for(int i=0; i<10; i++) {
+        [[[r table: @"users"] get: @(i)] run: &error];
+    }
+    XCTAssertLessThanOrEqual(cache.bytesUsed, 8000);
+    XCTAssertGreaterThan(cache.evictions, 0);
+    XCTAssertEqual(cache.count + cache.evictions, 10);
+    
+    // the most recently used documents are the ones kept
+    NSUInteger queries = server.queryCount;
+    [[[r table: @"users"] get: @9] run: &error];
+    XCTAssertEqual(server.queryCount, queries);
+    [[[r table: @"users"] get: @0] run: &error];
+    XCTAssertEqual(server.queryCount, queries + 1);
+}
+
+- (void)testGetBatching {
+    NSError* error = nil;
+    NSMutableArray* batches = [NSMutableArray new];
+    server.handler = ^RethinkDBMockResponse *(id term, NSDictionary *options) {
+        XCTAssertEqual([[term firstObject] intValue], Term_TermTypeGetAll);
+        NSArray* keys = [[term objectAtIndex: 1] subarrayWithRange: NSMakeRange(1, [[term objectAtIndex: 1] count] - 1)];
+        @synchronized(batches) {
+            [batches addObject: keys];
+        }
+        
+        NSMutableArray* rows = [NSMutableArray new];
+        for(id key in [keys reverseObjectEnumerator]) {
+            if(![key isEqual: @"missing"]) {
+                [rows addObject: @{@"id": key, @"name": [NSString stringWithFormat: @"user %@", key]}];
+            }
+        }
+        return [RethinkDBMockResponse sequence: rows];
+    };
+    
+    [r batchGetsOnTable: @"users" primaryKey: nil window: 0.05 maximumBatchSize: 100];
+    
+    // everything asked for within the window goes in one getAll:, and each caller gets its own document back
+    NSArray* keys = @[@1, @2, @3, @"missing", @2, @4];
+    NSMutableArray* results = [NSMutableArray new];
+    dispatch_group_t group = dispatch_group_create();
+    for(id key in keys) {
+        dispatch_group_enter(group);
+        RethinkDBOperation* op = [[[r table: @"users"] get: key] runThen:^(id response) {
+            @synchronized(results) {
+                [results addObject: @[key, response]];
+            }
+            dispatch_group_leave(group);
+        } fail:^(NSError *err) {
+            XCTFail(@"get failed: %@", err);
+            dispatch_group_leave(group);
+        }];
+        XCTAssertNotNil(op);
+    }
+    XCTAssertEqual(dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)), 0);
+    XCTAssertEqual(server.queryCount, 1);
+    XCTAssertEqualObjects([batches firstObject], (@[@1, @2, @3, @"missing", @4]));
+    XCTAssertEqual([results count], [keys count]);
+    for(NSArray* result in results) {
+        id key = [result firstObject];
+        id document = [result lastObject];
+        if([key isEqual: @"missing"]) {
+            XCTAssertEqualObjects(document, [NSNull null]);
+        } else {
+            XCTAssertEqualObjects([document objectForKey: @"id"], key);
+        }
+    }
+    
+    // synchronous gets wait out the window
+    XCTAssertEqualObjects([[[[r table: @"users"] get: @5] run: &error] objectForKey: @"name"], @"user 5", @"get failed: %@", error);
+    XCTAssertEqual(server.queryCount, 2);
+    
+    // a full batch goes straight away rather than waiting for its window
+    [r batchGetsOnTable: @"users" primaryKey: nil window: 10 maximumBatchSize: 3];
+    group = dispatch_group_create();
+    for(int i=0; i<6; i++) {
+        dispatch_group_enter(group);
+        [[[r table: @"users"] get: @(i)] runThen:^(id response) {
+            dispatch_group_leave(group);
+        } fail:^(NSError *err) {
+            XCTFail(@"get failed: %@", err);
+            dispatch_group_leave(group);
+        }];
+    }
+    XCTAssertEqual(dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)), 0);
+    XCTAssertEqual(server.queryCount, 4);
+    
+    // misses in a cached table share batches, hits never reach the server
+    [r batchGetsOnTable: @"users" primaryKey: nil window: 0.05 maximumBatchSize: 100];
+    RethinkDBDocumentCache* cache = [r cacheTable: @"users" maximumBytes: 0 timeToLive: 0];
+    group = dispatch_group_create();
+    for(int i=0; i<10; i++) {
+        dispatch_group_enter(group);
+        [[[r table: @"users"] get: @(i % 5)] runThen:^(id response) {
+            dispatch_group_leave(group);
+        } fail:^(NSError *err) {
+            XCTFail(@"get failed: %@", err);
+            dispatch_group_leave(group);
+        }];
+    }
+    XCTAssertEqual(dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)), 0);
+    XCTAssertEqual(server.queryCount, 5);
+    XCTAssertEqual(cache.count, 5);
+    XCTAssertEqualObjects([[[[r table: @"users"] get: @3] run: &error] objectForKey: @"id"], @3);
+    XCTAssertEqual(server.queryCount, 5);
+    
+    [r stopCachingTable: @"users"];
+    [r stopBatchingGetsOnTable: @"users"];
+    server.handler = ^RethinkDBMockResponse *(id term, NSDictionary *options) {
+        return [RethinkDBMockResponse atom: @{@"id": @7}];
+    };
+    XCTAssertEqualObjects([[[r table: @"users"] get: @7] run: &error], @{@"id": @7});
+    XCTAssertEqual(server.queryCount, 6);
+}
+
+- (void)testGetBatchingKeepsToTheDefaultDatabase {
+    NSError* error = nil;
+    server.handler = ^RethinkDBMockResponse *(id term, NSDictionary *options) {
+        NSString* db = [options objectForKey: @"db"] ? @"other" : @"default";
+        if([[term firstObject] intValue] == Term_TermTypeGetAll) {
+            XCTAssertEqualObjects(db, @"default");
+            return [RethinkDBMockResponse sequence: @[@{@"id": @"a", @"db": db}]];
+        }
+        XCTAssertEqual([[term firstObject] intValue], Term_TermTypeGet);
+        return [RethinkDBMockResponse atom: @{@"id": @"a", @"db": db}];
+    };
+    
+    [r batchGetsOnTable: @"users" primaryKey: nil window: 0.05 maximumBatchSize: 100];
+    
+    // a get: on the same table name in another database is sent on its own, with its database
+    dispatch_group_t group = dispatch_group_create();
+    NSMutableDictionary* results = [NSMutableDictionary new];
+    for(NSString* db in @[@"default", @"other"]) {
+        id <RethinkDBTable> table = [db isEqualToString: @"other"] ? [[r db: @"other"] table: @"users"] : [r table: @"users"];
+        dispatch_group_enter(group);
+        [[table get: @"a"] runThen:^(id response) {
+            @synchronized(results) {
+                [results setObject: [response objectForKey: @"db"] forKey: db];
+            }
+            dispatch_group_leave(group);
+        } fail:^(NSError *err) {
+            XCTFail(@"get failed: %@", err);
+            dispatch_group_leave(group);
+        }];
+    }
+    XCTAssertEqual(dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)), 0);
+    XCTAssertEqualObjects(results, (@{@"default": @"default", @"other": @"other"}));
+    XCTAssertEqual(server.queryCount, 2);
+    
+    // as are keys only the server can work out
+    XCTAssertEqualObjects([[[[r table: @"users"] get: [r expr: @"a"]] run: &error] objectForKey: @"db"], @"default", @"get failed: %@", error);
+    XCTAssertEqual(server.queryCount, 3);
+}
+
+@end
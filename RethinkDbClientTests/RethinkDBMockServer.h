@@ -0,0 +1,58 @@
+//
+//  RethinkDBMockServer.h
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright © 2026 Daniel Parnell. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+// A canned answer to a query. Cursors and feeds send one batch per START or CONTINUE, so each query that
+// receives one gets its own copy of the batches.
+@interface RethinkDBMockResponse : NSObject
+
++ (instancetype) atom:(id)value;
++ (instancetype) sequence:(NSArray*)rows;
+// SUCCESS_PARTIAL for every batch but the last, which is sent as SUCCESS_SEQUENCE
++ (instancetype) cursorWithBatches:(NSArray*)batches;
+// SUCCESS_PARTIAL with the SEQUENCE_FEED note (plus any others given) that never ends by itself. Once its
+// batches have been sent the CONTINUE is held until -[RethinkDBMockServer pushChanges:] or a STOP.
++ (instancetype) changeFeedWithBatches:(NSArray*)batches notes:(NSArray*)notes;
++ (instancetype) clientError:(NSString*)message;
++ (instancetype) compileError:(NSString*)message;
++ (instancetype) runtimeError:(NSString*)message;
+
+@end
+
+// Gets the term of each START that was not scripted with respondTo:with:, decoded from JSON as
+// [type, [args], {options}], and the query's global options. nil answers with a runtime error.
+typedef RethinkDBMockResponse* (^RethinkDBMockHandler)(id term, NSDictionary *options);
+
+// A stand-in RethinkDB server listening on a free loopback port, speaking the V0.4 handshake and the JSON
+// protocol. Every connection is served by its own thread, and responses are written latency seconds after
+// their query arrives through a link of at most bandwidth bytes per second, so client performance can be
+// measured repeatably without a real server.
+@interface RethinkDBMockServer : NSObject
+
+- (instancetype) initWithError:(NSError**)error;
+- (void) stop;
+
+// Answers every START whose term equals the given one, which is in the form the handler receives.
+- (void) respondTo:(id)term with:(RethinkDBMockResponse*)response;
+// Sends changes to every open change feed on every connection.
+- (void) pushChanges:(NSArray*)changes;
+
+@property (copy) RethinkDBMockHandler handler;
+// nil accepts any key
+@property (copy) NSString *authKey;
+@property (assign) NSTimeInterval latency;
+// bytes per second for each connection, 0 for no limit
+@property (assign) NSUInteger bandwidth;
+
+@property (readonly) uint16_t port;
+@property (readonly) NSURL *url;
+@property (readonly) uint64_t queryCount;
+@property (readonly) NSUInteger connectionCount;
+
+@end
@@ -0,0 +1,571 @@
+//
+//  RethinkDBMockServer.m
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright © 2026 Daniel Parnell. All rights reserved.
+//
+
+#import "RethinkDBMockServer.h"
+#import "Ql2.pb.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define MAX_AUTH_KEY_LENGTH 4096
+#define MAX_QUERY_LENGTH (64 * 1024 * 1024)
+
+static NSString* mock_error = @"RethinkDB Mock Server Error";
+
+static BOOL read_fully(int fd, void* buffer, size_t length) {
+    uint8_t* p = buffer;
+    while(length) {
+        ssize_t n = recv(fd, p, length, 0);
+        if(n < 0 && errno == EINTR) {
+            continue;
+        }
+        if(n <= 0) {
+            return NO;
+        }
+        p += n;
+        length -= n;
+    }
+    
+    return YES;
+}
+
+static BOOL write_fully(int fd, const void* buffer, size_t length) {
+    const uint8_t* p = buffer;
+    while(length) {
+        ssize_t n = send(fd, p, length, 0);
+        if(n < 0 && errno == EINTR) {
+            continue;
+        }
+        if(n <= 0) {
+            return NO;
+        }
+        p += n;
+        length -= n;
+    }
+    
+    return YES;
+}
+
+#pragma mark -
+#pragma mark Responses
+
+@interface RethinkDBMockResponse ()
+
+@property (assign) Response_ResponseType type;
+@property (strong) NSArray *results;
+// set for cursors and feeds, which are answered a batch at a time
+@property (strong) NSArray *batches;
+@property (strong) NSArray *notes;
+@property (assign) BOOL feed;
+
+@end
+
+@implementation RethinkDBMockResponse
+
++ (instancetype) responseWithType:(Response_ResponseType)type results:(NSArray*)results {
+    RethinkDBMockResponse* response = [RethinkDBMockResponse new];
+    response.type = type;
+    response.results = results;
+    
+    return response;
+}
+
++ (instancetype) atom:(id)value {
+    return [self responseWithType: Response_ResponseTypeSuccessAtom results: [NSArray arrayWithObject: value ? value : [NSNull null]]];
+}
+
++ (instancetype) sequence:(NSArray*)rows {
+    return [self responseWithType: Response_ResponseTypeSuccessSequence results: rows];
+}
+
++ (instancetype) cursorWithBatches:(NSArray*)batches {
+    RethinkDBMockResponse* response = [self responseWithType: Response_ResponseTypeSuccessPartial results: nil];
+    response.batches = batches;
+    
+    return response;
+}
+
++ (instancetype) changeFeedWithBatches:(NSArray*)batches notes:(NSArray*)notes {
+    RethinkDBMockResponse* response = [self cursorWithBatches: batches ? batches : [NSArray array]];
+    NSMutableArray* all_notes = [NSMutableArray arrayWithObject: [NSNumber numberWithInt: Response_ResponseNoteSequenceFeed]];
+    for(NSNumber* note in notes) {
+        if(![all_notes containsObject: note]) {
+            [all_notes addObject: note];
+        }
+    }
+    response.notes = all_notes;
+    response.feed = YES;
+    
+    return response;
+}
+
++ (instancetype) clientError:(NSString*)message {
+    return [self responseWithType: Response_ResponseTypeClientError results: [NSArray arrayWithObject: message]];
+}
+
++ (instancetype) compileError:(NSString*)message {
+    return [self responseWithType: Response_ResponseTypeCompileError results: [NSArray arrayWithObject: message]];
+}
+
++ (instancetype) runtimeError:(NSString*)message {
+    return [self responseWithType: Response_ResponseTypeRuntimeError results: [NSArray arrayWithObject: message]];
+}
+
+@end
+
+// The state of one query that is answered a batch at a time.
+@interface RethinkDBMockCursor : NSObject
+
+@property (strong) RethinkDBMockResponse *response;
+@property (assign) NSUInteger next;
+// a feed has run out of batches and has a CONTINUE to answer
+@property (assign) BOOL waiting;
+@property (strong) NSMutableArray *pushed;
+
+@end
+
+@implementation RethinkDBMockCursor
+@end
+
+#pragma mark -
+#pragma mark Connections
+
+@interface RethinkDBMockServer (Connections)
+
+- (RethinkDBMockResponse*) responseForTerm:(id)term options:(NSDictionary*)options;
+- (void) countQuery;
+- (void) connectionClosed:(id)connection;
+
+@end
+
+@interface RethinkDBMockConnection : NSObject
+
+- (instancetype) initWithServer:(RethinkDBMockServer*)server socket:(int)fd;
+- (void) serve;
+- (void) pushChanges:(NSArray*)changes;
+- (void) close;
+
+@end
+
+@implementation RethinkDBMockConnection {
+    __weak RethinkDBMockServer *server;
+    int fd;
+    __strong NSLock *lock;
+    __strong NSMutableDictionary *cursors;
+    // responses are written here, in the order their delay runs out
+    __strong dispatch_queue_t write_queue;
+    BOOL closed;
+}
+
+- (instancetype) initWithServer:(RethinkDBMockServer*)aServer socket:(int)socket {
+    self = [super init];
+    if (self) {
+        server = aServer;
+        fd = socket;
+        lock = [NSLock new];
+        cursors = [NSMutableDictionary new];
+        write_queue = dispatch_queue_create("RethinkDB mock server write queue", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+- (void) writeBytes:(NSData*)data afterDelay:(NSTimeInterval)delay {
+    NSUInteger bandwidth = server.bandwidth;
+    
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), write_queue, ^{
+        if(closed) {
+            return;
+        }
+        // the link is busy for as long as the frame takes to send
+        if(bandwidth) {
+            usleep((useconds_t)((double)[data length] * 1000000.0 / bandwidth));
+        }
+        write_fully(fd, [data bytes], [data length]);
+    });
+}
+
+- (void) sendType:(Response_ResponseType)type results:(NSArray*)results notes:(NSArray*)notes token:(int64_t)token {
+    NSMutableDictionary* response = [NSMutableDictionary dictionaryWithObjectsAndKeys:
+                                     [NSNumber numberWithInt: type], @"t",
+                                     results ? results : [NSArray array], @"r",
+                                     nil];
+    if([notes count]) {
+        [response setObject: notes forKey: @"n"];
+    }
+    if(type == Response_ResponseTypeClientError || type == Response_ResponseTypeCompileError || type == Response_ResponseTypeRuntimeError) {
+        [response setObject: [NSArray array] forKey: @"b"];
+    }
+    
+    NSData* json = [NSJSONSerialization dataWithJSONObject: response options: 0 error: nil];
+    uint64_t wire_token = CFSwapInt64HostToLittle((uint64_t)token);
+    uint32_t size = CFSwapInt32HostToLittle((uint32_t)[json length]);
+    NSMutableData* frame = [NSMutableData dataWithCapacity: [json length] + 12];
+    [frame appendBytes: &wire_token length: 8];
+    [frame appendBytes: &size length: 4];
+    [frame appendData: json];
+    
+    [self writeBytes: frame afterDelay: server.latency];
+}
+
+// must be called with the lock held
+- (void) sendNextBatch:(RethinkDBMockCursor*)cursor token:(int64_t)token {
+    RethinkDBMockResponse* response = cursor.response;
+    NSUInteger count = [response.batches count];
+    
+    if(cursor.next < count) {
+        NSArray* batch = [response.batches objectAtIndex: cursor.next];
+        cursor.next++;
+        BOOL last = !response.feed && cursor.next == count;
+        if(last) {
+            [cursors removeObjectForKey: [NSNumber numberWithLongLong: token]];
+        }
+        [self sendType: last ? Response_ResponseTypeSuccessSequence : Response_ResponseTypeSuccessPartial results: batch notes: response.notes token: token];
+    } else if(response.feed && [cursor.pushed count]) {
+        [self sendType: Response_ResponseTypeSuccessPartial results: [cursor.pushed copy] notes: response.notes token: token];
+        [cursor.pushed removeAllObjects];
+    } else if(response.feed) {
+        cursor.waiting = YES;
+    } else {
+        // a cursor without any batches
+        [cursors removeObjectForKey: [NSNumber numberWithLongLong: token]];
+        [self sendType: Response_ResponseTypeSuccessSequence results: nil notes: nil token: token];
+    }
+}
+
+- (void) pushChanges:(NSArray*)changes {
+    [lock lock];
+    [cursors enumerateKeysAndObjectsUsingBlock:^(NSNumber* token, RethinkDBMockCursor* cursor, BOOL *stop) {
+        if(!cursor.response.feed) {
+            return;
+        }
+        
+        [cursor.pushed addObjectsFromArray: changes];
+        if(cursor.waiting) {
+            cursor.waiting = NO;
+            [self sendNextBatch: cursor token: [token longLongValue]];
+        }
+    }];
+    [lock unlock];
+}
+
+- (void) handleQuery:(NSArray*)query token:(int64_t)token {
+    Query_QueryType type = [[query firstObject] intValue];
+    NSNumber* key = [NSNumber numberWithLongLong: token];
+    
+    switch(type) {
+        case Query_QueryTypeStart: {
+            [server countQuery];
+            id term = [query count] > 1 ? [query objectAtIndex: 1] : [NSNull null];
+            NSDictionary* options = [query count] > 2 ? [query objectAtIndex: 2] : nil;
+            if(![options isKindOfClass: [NSDictionary class]]) {
+                options = nil;
+            }
+            
+            RethinkDBMockResponse* response = [server responseForTerm: term options: options];
+            if([[options objectForKey: @"noreply"] boolValue]) {
+                break;
+            }
+            
+            if(response.batches) {
+                RethinkDBMockCursor* cursor = [RethinkDBMockCursor new];
+                cursor.response = response;
+                cursor.pushed = [NSMutableArray new];
+                
+                [lock lock];
+                [cursors setObject: cursor forKey: key];
+                [self sendNextBatch: cursor token: token];
+                [lock unlock];
+            } else {
+                [self sendType: response.type results: response.results notes: nil token: token];
+            }
+            break;
+        }
+            
+        case Query_QueryTypeContinue: {
+            [lock lock];
+            RethinkDBMockCursor* cursor = [cursors objectForKey: key];
+            if(cursor) {
+                [self sendNextBatch: cursor token: token];
+            } else {
+                [self sendType: Response_ResponseTypeClientError results: [NSArray arrayWithObject: @"Token not in stream cache."] notes: nil token: token];
+            }
+            [lock unlock];
+            break;
+        }
+            
+        case Query_QueryTypeStop:
+            [lock lock];
+            [cursors removeObjectForKey: key];
+            [lock unlock];
+            [self sendType: Response_ResponseTypeSuccessSequence results: nil notes: nil token: token];
+            break;
+            
+        case Query_QueryTypeNoreplyWait:
+            [self sendType: Response_ResponseTypeWaitComplete results: nil notes: nil token: token];
+            break;
+            
+        default:
+            [self sendType: Response_ResponseTypeClientError results: [NSArray arrayWithObject: @"Unsupported query type"] notes: nil token: token];
+            break;
+    }
+}
+
+- (void) failHandshake:(NSString*)message {
+    NSData* data = [message dataUsingEncoding: NSUTF8StringEncoding];
+    write_fully(fd, [data bytes], [data length]);
+    write_fully(fd, "", 1);
+}
+
+// V0.4: the magic number, the length of the auth key and the key itself, then the protocol. The server
+// answers with a null terminated SUCCESS or error message.
+- (BOOL) handshake {
+    uint32_t version, key_length, protocol;
+    
+    if(!read_fully(fd, &version, 4) || CFSwapInt32LittleToHost(version) != VersionDummy_VersionV04) {
+        [self failHandshake: @"ERROR: Received an unsupported protocol version. This mock server only speaks V0_4."];
+        return NO;
+    }
+    if(!read_fully(fd, &key_length, 4)) {
+        return NO;
+    }
+    key_length = CFSwapInt32LittleToHost(key_length);
+    if(key_length > MAX_AUTH_KEY_LENGTH) {
+        [self failHandshake: @"ERROR: Client provided an authorization key that is too long."];
+        return NO;
+    }
+    NSMutableData* key_data = [NSMutableData dataWithLength: key_length];
+    if(!read_fully(fd, [key_data mutableBytes], key_length) || !read_fully(fd, &protocol, 4)) {
+        return NO;
+    }
+    
+    NSString* expected = server.authKey;
+    NSString* key = [[NSString alloc] initWithData: key_data encoding: NSUTF8StringEncoding];
+    if(expected && ![expected isEqualToString: key]) {
+        [self failHandshake: @"ERROR: Incorrect authorization key."];
+        return NO;
+    }
+    if(CFSwapInt32LittleToHost(protocol) != VersionDummy_ProtocolJson) {
+        [self failHandshake: @"ERROR: This mock server only speaks the JSON protocol."];
+        return NO;
+    }
+    
+    return write_fully(fd, "SUCCESS", 8);
+}
+
+// Runs on the connection's own thread until the client goes away or the server stops.
+- (void) serve {
+    @autoreleasepool {
+        if([self handshake]) {
+            uint8_t header[12];
+            
+            while(read_fully(fd, header, sizeof(header))) {
+                @autoreleasepool {
+                    int64_t token = (int64_t)CFSwapInt64LittleToHost(*(uint64_t*)header);
+                    uint32_t length = CFSwapInt32LittleToHost(*(uint32_t*)(header + 8));
+                    if(length > MAX_QUERY_LENGTH) {
+                        break;
+                    }
+                    
+                    NSMutableData* body = [NSMutableData dataWithLength: length];
+                    if(!read_fully(fd, [body mutableBytes], length)) {
+                        break;
+                    }
+                    
+                    NSArray* query = [NSJSONSerialization JSONObjectWithData: body options: 0 error: nil];
+                    if(![query isKindOfClass: [NSArray class]] || [query count] == 0) {
+                        [self sendType: Response_ResponseTypeClientError results: [NSArray arrayWithObject: @"Query is not a JSON array"] notes: nil token: token];
+                        continue;
+                    }
+                    
+                    [self handleQuery: query token: token];
+                }
+            }
+        }
+        
+        // the socket is closed behind any responses that are still waiting to be written
+        dispatch_async(write_queue, ^{
+            closed = YES;
+            close(fd);
+        });
+        [server connectionClosed: self];
+    }
+}
+
+- (void) close {
+    shutdown(fd, SHUT_RDWR);
+}
+
+@end
+
+#pragma mark -
+#pragma mark Server
+
+@implementation RethinkDBMockServer {
+    int listen_fd;
+    __strong dispatch_source_t accept_source;
+    __strong NSLock *lock;
+    __strong NSMutableArray *connections;
+    __strong NSMutableDictionary *scripted;
+    uint64_t query_count;
+}
+
+- (instancetype) initWithError:(NSError**)error {
+    self = [super init];
+    if (self) {
+        lock = [NSLock new];
+        connections = [NSMutableArray new];
+        scripted = [NSMutableDictionary new];
+        
+        listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+        if(listen_fd < 0) {
+            if(error) *error = [NSError errorWithDomain: NSPOSIXErrorDomain code: errno userInfo: nil];
+            return nil;
+        }
+        
+        int on = 1;
+        setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = 0;
+        socklen_t address_length = sizeof(address);
+        
+        if(bind(listen_fd, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(listen_fd, 64) < 0 ||
+           getsockname(listen_fd, (struct sockaddr*)&address, &address_length) < 0) {
+            if(error) *error = [NSError errorWithDomain: NSPOSIXErrorDomain code: errno userInfo: [NSDictionary dictionaryWithObject: @"Could not start the mock server" forKey: NSLocalizedDescriptionKey]];
+            close(listen_fd);
+            return nil;
+        }
+        _port = ntohs(address.sin_port);
+        _url = [NSURL URLWithString: [NSString stringWithFormat: @"rethink://127.0.0.1:%u", _port]];
+        fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK);
+        
+        int fd = listen_fd;
+        __weak RethinkDBMockServer* weak_self = self;
+        accept_source = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, fd, 0, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0));
+        dispatch_source_set_event_handler(accept_source, ^{
+            [weak_self acceptConnections];
+        });
+        dispatch_source_set_cancel_handler(accept_source, ^{
+            close(fd);
+        });
+        dispatch_resume(accept_source);
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [self stop];
+}
+
+- (void) acceptConnections {
+    int fd;
+    
+    while((fd = accept(listen_fd, NULL, NULL)) >= 0) {
+        int on = 1;
+        // the connection is blocking even though the listening socket is not
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+#ifdef SO_NOSIGPIPE
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+        
+        RethinkDBMockConnection* connection = [[RethinkDBMockConnection alloc] initWithServer: self socket: fd];
+        [lock lock];
+        [connections addObject: connection];
+        [lock unlock];
+        
+        [NSThread detachNewThreadSelector: @selector(serve) toTarget: connection withObject: nil];
+    }
+}
+
+- (void) stop {
+    NSArray* current;
+    
+    [lock lock];
+    dispatch_source_t source = accept_source;
+    accept_source = nil;
+    current = [connections copy];
+    [lock unlock];
+    
+    if(source) {
+        dispatch_source_cancel(source);
+    }
+    for(RethinkDBMockConnection* connection in current) {
+        [connection close];
+    }
+}
+
+- (void) respondTo:(id)term with:(RethinkDBMockResponse*)response {
+    [lock lock];
+    [scripted setObject: response forKey: term];
+    [lock unlock];
+}
+
+- (void) pushChanges:(NSArray*)changes {
+    [lock lock];
+    NSArray* current = [connections copy];
+    [lock unlock];
+    
+    for(RethinkDBMockConnection* connection in current) {
+        [connection pushChanges: changes];
+    }
+}
+
+- (RethinkDBMockResponse*) responseForTerm:(id)term options:(NSDictionary*)options {
+    [lock lock];
+    RethinkDBMockResponse* response = [scripted objectForKey: term];
+    [lock unlock];
+    
+    if(response == nil && self.handler) {
+        response = self.handler(term, options);
+    }
+    if(response == nil) {
+        response = [RethinkDBMockResponse runtimeError: [NSString stringWithFormat: @"No response scripted for %@", term]];
+    }
+    
+    return response;
+}
+
+- (void) countQuery {
+    [lock lock];
+    query_count++;
+    [lock unlock];
+}
+
+- (void) connectionClosed:(id)connection {
+    [lock lock];
+    [connections removeObjectIdenticalTo: connection];
+    [lock unlock];
+}
+
+- (uint64_t) queryCount {
+    [lock lock];
+    uint64_t result = query_count;
+    [lock unlock];
+    
+    return result;
+}
+
+- (NSUInteger) connectionCount {
+    [lock lock];
+    NSUInteger result = [connections count];
+    [lock unlock];
+    
+    return result;
+}
+
+@end
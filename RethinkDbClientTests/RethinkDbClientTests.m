@@ -206,4 +206,361 @@
     XCTAssertNil(table_list, @"dbList should have failed failed");
 }
 
+- (void) testNoReply {
+    NSError* error = nil;
+    XCTAssertNotNil(r, @"Connection failed");
+    
+    id response = [[r tableCreate: @"noreplyTest"] run: &error];
+    XCTAssertNotNil(response, @"createTable failed: %@", error);
+    
+    id <RethinkDBTable> table = [r table: @"noreplyTest"];
+    for(int i=0; i<100; i++) {
+        XCTAssert([[table insert: [NSDictionary dictionaryWithObject: [NSNumber numberWithInt: i] forKey: @"number"]] runNoReply: &error], @"insert failed: %@", error);
+    }
+    
+    XCTAssert([r noreplyWait: &error], @"noreplyWait failed: %@", error);
+    
+    NSNumber* count = [[table count] run: &error];
+    XCTAssertEqualObjects(count, [NSNumber numberWithInt: 100], @"all noreply inserts should be visible after noreplyWait");
+    
+    response = [[r tableDrop: @"noreplyTest"] run: &error];
+    XCTAssertNotNil(response, @"tableDrop failed: %@", error);
+}
+
+- (void) testBulkInsert {
+    NSError* error = nil;
+    XCTAssertNotNil(r, @"Connection failed");
+    
+    id response = [[r tableCreate: @"bulkTest"] run: &error];
+    XCTAssertNotNil(response, @"createTable failed: %@", error);
+    
+    r.bulkInsertBatchSize = 100;
+    r.bulkInsertMaxInFlight = 3;
+    
+    __block int produced = 0;
+    NSDictionary* result = [[r table: @"bulkTest"] insertFrom:^id{
+        if(produced == 1050) {
+            return nil;
+        }
+        return [NSDictionary dictionaryWithObject: [NSNumber numberWithInt: produced++] forKey: @"number"];
+    } options: nil error: &error];
+    
+    XCTAssertNotNil(result, @"bulk insert failed: %@", error);
+    XCTAssertEqualObjects([result objectForKey: @"inserted"], [NSNumber numberWithInt: 1050], @"every document should have been inserted: %@", result);
+    XCTAssertEqual((int)[[result objectForKey: @"generated_keys"] count], 1050, @"there should be a generated key per document");
+    
+    NSNumber* count = [[[r table: @"bulkTest"] count] run: &error];
+    XCTAssertEqualObjects(count, [NSNumber numberWithInt: 1050]);
+    
+    response = [[r tableDrop: @"bulkTest"] run: &error];
+    XCTAssertNotNil(response, @"tableDrop failed: %@", error);
+}
+
+- (void) testCursorReadAhead {
+    NSError* error = nil;
+    XCTAssertNotNil(r, @"Connection failed");
+    
+    id response = [[r tableCreate: @"readAheadTest"] run: &error];
+    XCTAssertNotNil(response, @"createTable failed: %@", error);
+    
+    NSMutableArray* documents = [NSMutableArray new];
+    for(int i=0; i<5000; i++) {
+        [documents addObject: [NSDictionary dictionaryWithObject: [NSNumber numberWithInt: i] forKey: @"number"]];
+    }
+    response = [[r table: @"readAheadTest"] insertAll: [documents objectEnumerator] options: nil error: &error];
+    XCTAssertNotNil(response, @"bulk insert failed: %@", error);
+    
+    for(NSUInteger read_ahead = 0; read_ahead < 4; read_ahead++) {
+        r.cursorReadAhead = read_ahead;
+        
+        RethinkDBSequenceCursor* cursor = [[r table: @"readAheadTest"] run: &error];
+        XCTAssertNotNil(cursor, @"table scan failed: %@", error);
+        XCTAssertEqual(cursor.readAhead, read_ahead);
+        
+        __block int rows = 0;
+        dispatch_semaphore_t done = dispatch_semaphore_create(0);
+        [cursor each:^BOOL(id row) {
+            rows++;
+            return YES;
+        } done:^{
+            dispatch_semaphore_signal(done);
+        } fail:^(NSError *err) {
+            XCTFail(@"cursor failed: %@", err);
+            dispatch_semaphore_signal(done);
+        }];
+        dispatch_semaphore_wait(done, DISPATCH_TIME_FOREVER);
+        
+        XCTAssertEqual(rows, 5000, @"every row should be seen exactly once with a read ahead of %lu", (unsigned long)read_ahead);
+    }
+    
+    response = [[r tableDrop: @"readAheadTest"] run: &error];
+    XCTAssertNotNil(response, @"tableDrop failed: %@", error);
+}
+
+- (void) testPreparedQueries {
+    NSError* error = nil;
+    XCTAssertNotNil(r, @"Connection failed");
+    
+    id response = [[r tableCreate: @"preparedTest"] run: &error];
+    XCTAssertNotNil(response, @"createTable failed: %@", error);
+    
+    NSMutableArray* documents = [NSMutableArray new];
+    for(int i=0; i<100; i++) {
+        [documents addObject: @{@"id": @(i), @"name": [NSString stringWithFormat: @"User %d", i]}];
+    }
+    response = [[r table: @"preparedTest"] insertAll: [documents objectEnumerator] options: nil error: &error];
+    XCTAssertNotNil(response, @"insert failed: %@", error);
+    
+    RethinkDBPreparedQuery* get = [[[r table: @"preparedTest"] get: [r placeholder: 0]] prepare];
+    for(int i=0; i<100; i++) {
+        NSDictionary* row = [get runWithValues: @[@(i)] error: &error];
+        XCTAssertEqualObjects([row objectForKey: @"name"], ([NSString stringWithFormat: @"User %d", i]), @"get failed: %@", error);
+    }
+    
+    response = [[r tableDrop: @"preparedTest"] run: &error];
+    XCTAssertNotNil(response, @"tableDrop failed: %@", error);
+}
+
+- (void) testPullCursor {
+    NSError* error = nil;
+    XCTAssertNotNil(r, @"Connection failed");
+    
+    id response = [[r tableCreate: @"pullTest"] run: &error];
+    XCTAssertNotNil(response, @"createTable failed: %@", error);
+    
+    NSMutableArray* documents = [NSMutableArray new];
+    for(int i=0; i<5000; i++) {
+        [documents addObject: [NSDictionary dictionaryWithObject: [NSNumber numberWithInt: i] forKey: @"number"]];
+    }
+    response = [[r table: @"pullTest"] insertAll: [documents objectEnumerator] options: nil error: &error];
+    XCTAssertNotNil(response, @"bulk insert failed: %@", error);
+    
+    r.cursorReadAhead = 0;
+    
+    RethinkDBSequenceCursor* cursor = [[r table: @"pullTest"] run: &error];
+    NSMutableSet* seen = [NSMutableSet new];
+    for(NSDictionary* row in cursor) {
+        [seen addObject: [row objectForKey: @"number"]];
+    }
+    XCTAssertNil(cursor.enumerationError);
+    XCTAssertEqual([seen count], 5000);
+    
+    cursor = [[r table: @"pullTest"] run: &error];
+    NSUInteger rows = 0;
+    NSUInteger batches = 0;
+    NSArray* batch;
+    while((batch = [cursor nextBatch: &error])) {
+        rows += [batch count];
+        batches++;
+    }
+    XCTAssertNil(error);
+    XCTAssertEqual(rows, 5000);
+    XCTAssertGreaterThan(batches, 1);
+    
+    cursor = [[r table: @"pullTest"] run: &error];
+    rows = 0;
+    while([cursor nextRow: &error]) {
+        rows++;
+    }
+    XCTAssertNil(error);
+    XCTAssertEqual(rows, 5000);
+    
+    // stopping part way through leaves the connection usable
+    cursor = [[r table: @"pullTest"] run: &error];
+    XCTAssertNotNil([cursor nextRow: &error]);
+    [cursor close];
+    XCTAssertEqualObjects([[[r table: @"pullTest"] count] run: &error], @5000);
+    
+    response = [[r tableDrop: @"pullTest"] run: &error];
+    XCTAssertNotNil(response, @"tableDrop failed: %@", error);
+}
+
+- (void) testParallelCursor {
+    NSError* error = nil;
+    XCTAssertNotNil(r, @"Connection failed");
+    
+    id response = [[r tableCreate: @"parallelTest"] run: &error];
+    XCTAssertNotNil(response, @"createTable failed: %@", error);
+    
+    NSMutableArray* documents = [NSMutableArray new];
+    for(int i=0; i<5000; i++) {
+        [documents addObject: [NSDictionary dictionaryWithObject: [NSNumber numberWithInt: i] forKey: @"number"]];
+    }
+    response = [[r table: @"parallelTest"] insertAll: [documents objectEnumerator] options: nil error: &error];
+    XCTAssertNotNil(response, @"bulk insert failed: %@", error);
+    
+    // a scan of a table that is not changing returns its rows in the same order every time
+    RethinkDBSequenceCursor* cursor = [[r table: @"parallelTest"] run: &error];
+    NSArray* expected = [[cursor toArray: &error] valueForKey: @"number"];
+    
+    // rows are worked on out of order, but come back in the order the query gives them
+    cursor = [[r table: @"parallelTest"] run: &error];
+    NSMutableArray* numbers = [NSMutableArray new];
+    dispatch_semaphore_t done = dispatch_semaphore_create(0);
+    [cursor map:^id(NSDictionary* row) {
+        usleep(arc4random_uniform(100));
+        return [row objectForKey: @"number"];
+    } concurrency: 8 ordered: YES each:^BOOL(NSNumber* number) {
+        [numbers addObject: number];
+        return YES;
+    } done:^{
+        dispatch_semaphore_signal(done);
+    } fail:^(NSError *err) {
+        XCTFail(@"cursor failed: %@", err);
+        dispatch_semaphore_signal(done);
+    }];
+    dispatch_semaphore_wait(done, DISPATCH_TIME_FOREVER);
+    
+    XCTAssertEqual([numbers count], 5000);
+    XCTAssertEqualObjects(numbers, expected);
+    
+    cursor = [[r table: @"parallelTest"] run: &error];
+    NSLock* lock = [NSLock new];
+    __block int rows = 0;
+    [cursor each:^BOOL(id row) {
+        [lock lock];
+        rows++;
+        [lock unlock];
+        return YES;
+    } concurrency: 4 ordered: NO done:^{
+        dispatch_semaphore_signal(done);
+    } fail:^(NSError *err) {
+        XCTFail(@"cursor failed: %@", err);
+        dispatch_semaphore_signal(done);
+    }];
+    dispatch_semaphore_wait(done, DISPATCH_TIME_FOREVER);
+    XCTAssertEqual(rows, 5000);
+    
+    response = [[r tableDrop: @"parallelTest"] run: &error];
+    XCTAssertNotNil(response, @"tableDrop failed: %@", error);
+}
+
+- (void) testChangeFeed {
+    NSError* error = nil;
+    XCTAssertNotNil(r, @"Connection failed");
+    
+    id response = [[r tableCreate: @"feedTest"] run: &error];
+    XCTAssertNotNil(response, @"createTable failed: %@", error);
+    
+    RethinkDBChangeFeed* feed = [[[r table: @"feedTest"] changes: @{@"include_states": @YES}] run: &error];
+    XCTAssert([feed isKindOfClass: [RethinkDBChangeFeed class]], @"changes should return a feed: %@", error);
+    feed.squash = YES;
+    [feed pause];
+    
+    for(int i=0; i<20 && ![feed.state isEqualToString: @"ready"]; i++) {
+        usleep(50000);
+    }
+    XCTAssertEqualObjects(feed.state, @"ready");
+    
+    // one document changed ten times and one created and deleted again squash into a single change
+    [[[r table: @"feedTest"] insert: @{@"id": @"a", @"count": @0}] run: &error];
+    for(int i=1; i<=10; i++) {
+        [[[[r table: @"feedTest"] get: @"a"] update: @{@"count": @(i)}] run: &error];
+    }
+    [[[r table: @"feedTest"] insert: @{@"id": @"b"}] run: &error];
+    [[[[r table: @"feedTest"] get: @"b"] delete] run: &error];
+    for(int i=0; i<20 && feed.pendingCount == 0; i++) {
+        usleep(50000);
+    }
+    usleep(200000);
+    XCTAssertEqual(feed.pendingCount, 1);
+    
+    NSMutableArray* changes = [NSMutableArray new];
+    dispatch_semaphore_t received = dispatch_semaphore_create(0);
+    [feed each:^BOOL(NSDictionary* change) {
+        [changes addObject: change];
+        dispatch_semaphore_signal(received);
+        return NO;
+    } fail:^(NSError *err) {
+        XCTFail(@"feed failed: %@", err);
+        dispatch_semaphore_signal(received);
+    }];
+    [feed resume];
+    dispatch_semaphore_wait(received, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC));
+    
+    XCTAssertEqual([changes count], 1);
+    XCTAssertEqualObjects([[changes firstObject] objectForKey: @"old_val"], [NSNull null]);
+    XCTAssertEqualObjects([[[changes firstObject] objectForKey: @"new_val"] objectForKey: @"count"], @10);
+    
+    // a bounded feed that nobody reads keeps the newest changes
+    feed = [[[r table: @"feedTest"] changes: nil] run: &error];
+    feed.maximumPending = 5;
+    feed.overflow = RethinkDBChangeFeedDropOldest;
+    for(int i=0; i<20; i++) {
+        [[[r table: @"feedTest"] insert: @{@"id": @(i)}] run: &error];
+    }
+    for(int i=0; i<20 && feed.droppedCount < 15; i++) {
+        usleep(50000);
+    }
+    XCTAssertEqual(feed.pendingCount, 5);
+    XCTAssertEqual(feed.droppedCount, 15);
+    [feed close];
+    
+    response = [[r tableDrop: @"feedTest"] run: &error];
+    XCTAssertNotNil(response, @"tableDrop failed: %@", error);
+}
+
+- (void) testSharedFeed {
+    NSError* error = nil;
+    XCTAssertNotNil(r, @"Connection failed");
+    
+    id response = [[r tableCreate: @"sharedFeedTest"] run: &error];
+    XCTAssertNotNil(response, @"createTable failed: %@", error);
+    
+    NSLock* lock = [NSLock new];
+    NSMutableArray* fast = [NSMutableArray new];
+    dispatch_semaphore_t slow_started = dispatch_semaphore_create(0);
+    dispatch_semaphore_t release_slow = dispatch_semaphore_create(0);
+    __block NSUInteger slow_count = 0;
+    
+    r.sharedFeedBufferSize = 4;
+    RethinkDBFeedSubscription* first = [[[r table: @"sharedFeedTest"] changes: nil] subscribe:^BOOL(NSDictionary* change) {
+        [lock lock];
+        [fast addObject: change];
+        [lock unlock];
+        return YES;
+    } fail:^(NSError *err) {
+        XCTFail(@"feed failed: %@", err);
+    }];
+    // the same query from a different builder joins the first feed, and blocks on its first change
+    RethinkDBFeedSubscription* second = [[[r table: @"sharedFeedTest"] changes: nil] subscribe:^BOOL(NSDictionary* change) {
+        if(slow_count++ == 0) {
+            dispatch_semaphore_signal(slow_started);
+            dispatch_semaphore_wait(release_slow, DISPATCH_TIME_FOREVER);
+        }
+        return YES;
+    } fail:^(NSError *err) {
+        XCTFail(@"feed failed: %@", err);
+    }];
+    usleep(500000);
+    
+    for(int i=0; i<20; i++) {
+        [[[r table: @"sharedFeedTest"] insert: @{@"id": @(i)}] run: &error];
+    }
+    XCTAssertEqual(dispatch_semaphore_wait(slow_started, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)), 0);
+    for(int i=0; i<40; i++) {
+        [lock lock];
+        NSUInteger count = [fast count];
+        [lock unlock];
+        if(count == 20) {
+            break;
+        }
+        usleep(50000);
+    }
+    
+    // the fast subscriber saw everything while the stalled one only kept the newest changes
+    [lock lock];
+    XCTAssertEqual([fast count], 20);
+    [lock unlock];
+    XCTAssertEqual(first.droppedCount, 0);
+    XCTAssertEqual(second.droppedCount, 15);
+    
+    dispatch_semaphore_signal(release_slow);
+    [first cancel];
+    [second cancel];
+    
+    response = [[r tableDrop: @"sharedFeedTest"] run: &error];
+    XCTAssertNotNil(response, @"tableDrop failed: %@", error);
+}
+
 @end
@@ -0,0 +1,140 @@
+//
+//  TokenTableTests.m
+//  RethinkDbClient
+//
+//  Created by Daniel Parnell on 17/10/2026.
+//  Copyright © 2026 Daniel Parnell. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "RethinkDBTokenTable.h"
+
+@interface TokenTableTests : XCTestCase {
+    RethinkDBTokenTable* table;
+}
+
+@end
+
+@implementation TokenTableTests
+
+- (void)setUp
+{
+    [super setUp];
+    
+    table = [RethinkDBTokenTable new];
+}
+
+- (void)testSetAndRemove {
+    XCTAssertNil([table objectForToken: 1]);
+    [table setObject: @"one" forToken: 1];
+    [table setObject: @"two" forToken: 2];
+    XCTAssertEqualObjects([table objectForToken: 1], @"one");
+    XCTAssertEqualObjects([table objectForToken: 2], @"two");
+    XCTAssertEqual(table.count, 2);
+    
+    // setting a token again replaces its object
+    [table setObject: @"uno" forToken: 1];
+    XCTAssertEqualObjects([table objectForToken: 1], @"uno");
+    XCTAssertEqual(table.count, 2);
+    
+    XCTAssertEqualObjects([table removeObjectForToken: 1], @"uno");
+    XCTAssertNil([table objectForToken: 1]);
+    XCTAssertNil([table removeObjectForToken: 1]);
+    XCTAssertEqual(table.count, 1);
+    
+    // tokens start at 1, so 0 and below are never found
+    XCTAssertNil([table objectForToken: 0]);
+    XCTAssertNil([table removeObjectForToken: -1]);
+}
+
+- (void)testAddKeepsTheExistingObject {
+    XCTAssertEqualObjects([table addObject: @"first" forToken: 7], @"first");
+    XCTAssertEqualObjects([table addObject: @"second" forToken: 7], @"first");
+    XCTAssertEqualObjects([table objectForToken: 7], @"first");
+    XCTAssertEqual(table.count, 1);
+}
+
+- (void)testResize {
+    // well past the initial capacity of every shard
+    const int64_t count = 10000;
+    for(int64_t token=1; token<=count; token++) {
+        [table setObject: @(token) forToken: token];
+    }
+    XCTAssertEqual(table.count, count);
+    XCTAssertEqual([[table allObjects] count], count);
+    for(int64_t token=1; token<=count; token++) {
+        XCTAssertEqualObjects([table objectForToken: token], @(token));
+    }
+    XCTAssertNil([table objectForToken: count + 1]);
+    
+    // and everything is still found once the tables are full of deleted slots
+    for(int64_t token=1; token<=count; token+=2) {
+        XCTAssertEqualObjects([table removeObjectForToken: token], @(token));
+    }
+    XCTAssertEqual(table.count, count / 2);
+    for(int64_t token=1; token<=count; token++) {
+        XCTAssertEqualObjects([table objectForToken: token], token % 2 ? nil : @(token));
+    }
+}
+
+- (void)testTombstoneReuse {
+    // the way a connection uses the table: a few queries in flight at a time, with tokens always increasing
+    const int64_t in_flight = 50;
+    for(int64_t token=1; token<=100000; token++) {
+        [table setObject: @(token) forToken: token];
+        if(token > in_flight) {
+            XCTAssertEqualObjects([table removeObjectForToken: token - in_flight], @(token - in_flight));
+        }
+    }
+    XCTAssertEqual(table.count, in_flight);
+    for(int64_t token=100000 - in_flight + 1; token<=100000; token++) {
+        XCTAssertEqualObjects([table objectForToken: token], @(token));
+    }
+    
+    // a removed token can be stored again
+    [table removeObjectForToken: 100000];
+    XCTAssertNil([table objectForToken: 100000]);
+    [table setObject: @"again" forToken: 100000];
+    XCTAssertEqualObjects([table objectForToken: 100000], @"again");
+    XCTAssertEqual(table.count, in_flight);
+}
+
+- (void)testObjectsAreReleased {
+    __weak id removed = nil;
+    __weak id kept = nil;
+    @autoreleasepool {
+        NSObject* first = [NSObject new];
+        NSObject* second = [NSObject new];
+        removed = first;
+        kept = second;
+        [table setObject: first forToken: 1];
+        [table setObject: second forToken: 2];
+        [table removeObjectForToken: 1];
+    }
+    @autoreleasepool {
+        XCTAssertNil(removed);
+        XCTAssertNotNil(kept);
+    }
+    
+    // the table lets go of whatever it still holds when it goes away
+    @autoreleasepool {
+        table = nil;
+    }
+    XCTAssertNil(kept);
+}
+
+- (void)testConcurrentAccess {
+    dispatch_apply(8, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t thread) {
+        for(int64_t i=0; i<5000; i++) {
+            int64_t token = i * 8 + (int64_t)thread + 1;
+            [self->table setObject: @(token) forToken: token];
+            XCTAssertEqualObjects([self->table objectForToken: token], @(token));
+            if(i % 2) {
+                [self->table removeObjectForToken: token];
+            }
+        }
+    });
+    XCTAssertEqual(table.count, 8 * 2500);
+}
+
+@end